@@ -1,6 +1,8 @@
 function(BuildParser target input_file)
-    if (DEFINED ARGV2)
-        set(language ${ARGV2})
+    # OPTIONS key=value... override the %option's in the grammar
+    cmake_parse_arguments(BUILD_PARSER "" "" "OPTIONS" ${ARGN})
+    if (BUILD_PARSER_UNPARSED_ARGUMENTS)
+        list(GET BUILD_PARSER_UNPARSED_ARGUMENTS 0 language)
     else()
         set(language "C")
     endif()
@@ -20,7 +22,7 @@ function(BuildParser target input_file)
 
     add_custom_command(OUTPUT ${neoast_OUTPUT}
             COMMAND $<TARGET_FILE:neoast-exec>
-            ARGS ${input_file} ${neoast_OUTPUT} ${neoast_HEADER}
+            ARGS ${input_file} ${neoast_OUTPUT} ${neoast_HEADER} ${BUILD_PARSER_OPTIONS}
             DEPENDS ${input_file} neoast-exec
             WORKING_DIRECTORY ${CMAKE_CURRENT_SOURCE_DIR}
             )
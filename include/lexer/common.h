@@ -38,6 +38,7 @@ typedef struct NeoastInput_prv NeoastInput;
 
 // pattern.h
 typedef void (*NeoastPatternFSM)(NeoastMatcher*); ///< function pointer to FSM code
+typedef struct NeoastPatternTable_prv NeoastPatternTable; ///< transition table run by FSM_TABLE()
 
 typedef uint16_t NeoastPatternLookahead;
 typedef uint32_t NeosastPatternAccept; ///< group capture index
@@ -109,6 +109,11 @@ struct NeoastInput_prv
             neoast_input_get get;
         } custom_;
     } impl_;
+
+    // Resources opened by input_new_from_path_mmap(), released by input_free()
+    void* map_;         ///< read-only mapping of the file the buffer points into, NULL if none
+    size_t map_len_;    ///< length of the mapping
+    bool_t own_file_;   ///< file_ was opened by the input and is closed with it
 };
 
 /**
@@ -128,6 +133,15 @@ size_t input_get(NeoastInput* self, char* s, size_t n);
  */
 NeoastInput* input_new_from_buffer(const char* str, size_t len);
 
+/**
+ * Point a buffer input at a new chunk of memory.
+ * Any data left from the previous chunk is dropped.
+ * @param self input created with input_new_from_buffer()
+ * @param str pointer to string
+ * @param len length of string
+ */
+void input_set_buffer(NeoastInput* self, const char* str, size_t len);
+
 /**
  * Create an input given a POSIX file pointer
  * @param fp POSIX file pointer
@@ -143,6 +157,18 @@ NeoastInput* input_new_from_file_and_encoding(FILE* fp, file_encoding_type_t enc
  */
 NeoastInput* input_new_from_file(FILE* fp);
 
+/**
+ * Open a file and map it into memory read-only. The mapping is
+ * scanned in place as a buffer input, without copying it into the
+ * lexer. Pipes, devices and files that can't be mapped or need
+ * an encoding conversion (UTF-16/32) are streamed instead, as with
+ * input_new_from_file(). The file must not be truncated while the
+ * input is in use.
+ * @param path path of the file to open
+ * @return input owning the mapping or file, NULL if the file can't be opened
+ */
+NeoastInput* input_new_from_path_mmap(const char* path);
+
 NeoastInput* input_new_from_custom(void* ptr, neoast_input_get get);
 
 void input_free(NeoastInput* self);
@@ -24,6 +24,9 @@
 extern "C" {
 #endif
 
+///< returned by the lexer when a partial input ran out in the middle of a token
+#define NEOAST_LEX_NEED_MORE (-2)
+
 /**
  * Create a new lexer matching engine
  * @param input input to scan over
@@ -31,6 +34,15 @@ extern "C" {
  */
 NeoastMatcher* matcher_new(NeoastInput* input);
 
+/**
+ * Restart a matcher on a new input. The buffers of the matcher
+ * are kept so that it can be reused without allocating. The
+ * lexing state stack is emptied.
+ * @param self matcher to restart
+ * @param input input to scan over
+ */
+void matcher_set_input(NeoastMatcher* self, NeoastInput* input);
+
 /**
  * Destroy a lexer matching engine
  * @param self matcher to destroy
@@ -46,6 +58,50 @@ void matcher_free(NeoastMatcher* self);
  */
 size_t matcher_scan(NeoastMatcher* self, NeoastPatternFSM pattern_fsm);
 
+/**
+ * Mark the input as partial, the input may be refilled with
+ * more data after it runs out. This clears the end of input
+ * so that scanning can resume after a refill.
+ * @param self matcher to update
+ * @param partial TRUE if more input may follow, FALSE for the last chunk
+ */
+void matcher_set_partial(NeoastMatcher* self, bool_t partial);
+
+/**
+ * Check if the last scan ran into the end of a partial input.
+ * A longer match might be possible once more data arrives so
+ * the scan is undone to be retried after the next refill.
+ * @param self matcher that just ran matcher_scan()
+ * @return TRUE if more input is needed before the match is known
+ */
+bool_t matcher_need_more(NeoastMatcher* self);
+
+/**
+ * Restart a matcher in the middle of an in-memory buffer. Lexing
+ * starts at offset in the default lexing state. Offsets reported
+ * by the matcher still count from the start of the buffer.
+ * @param self matcher created on an input from input_new_from_buffer()
+ * @param str whole buffer
+ * @param len length of the buffer
+ * @param offset offset to start lexing at
+ */
+void matcher_set_buffer_at(NeoastMatcher* self, const char* str, size_t len, size_t offset);
+
+/**
+ * Get the input offset right after the last match
+ * @param self matcher to query
+ * @return offset the next scan starts at
+ */
+size_t matcher_offset(const NeoastMatcher* self);
+
+/**
+ * Get how far the scans looked into the input. The matches so far
+ * only depend on the input before this offset.
+ * @param self matcher to query
+ * @return offset right after the last character that was looked at
+ */
+size_t matcher_lookahead(const NeoastMatcher* self);
+
 size_t matcher_lineno(NeoastMatcher* self);
 size_t matcher_columno(NeoastMatcher* self);
 size_t matcher_size(NeoastMatcher* self);
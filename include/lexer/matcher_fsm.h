@@ -167,16 +167,23 @@ static inline bool_t FSM_META_BWE(NeoastMatcher* m, int c0, int c1)
     return !isword(c0) && isword(c1);
 }
 
+/// Character right after the matched text, '\0' past the end of the buffered input.
+static inline int fsm_next_char(const NeoastMatcher* m)
+{
+    size_t i = (size_t) (m->txt_ - m->buf_) + m->len_;
+    return i < m->end_ ? (unsigned char) m->buf_[i] : '\0';
+}
+
 /// FSM code META EWB.
 static inline bool_t FSM_META_EWB(NeoastMatcher* m)
 {
-    return isword(m->got_) && !isword((unsigned char) (m->txt_[m->len_]));
+    return isword(m->got_) && !isword(fsm_next_char(m));
 }
 
 /// FSM code META BWB.
 static inline bool_t FSM_META_BWB(NeoastMatcher* m)
 {
-    return !isword(m->got_) && (m->opt_.W || isword((unsigned char) (m->txt_[m->len_])));
+    return !isword(m->got_) && (m->opt_.W || isword(fsm_next_char(m)));
 }
 
 /// FSM code META NWE.
@@ -188,7 +195,67 @@ static inline bool_t FSM_META_NWE(NeoastMatcher* m, int c0, int c1)
 /// FSM code META NWB.
 static inline bool_t FSM_META_NWB(NeoastMatcher* m)
 {
-    return isword(m->got_) == isword((unsigned char) (m->txt_[m->len_]));
+    return isword(m->got_) == isword(fsm_next_char(m));
+}
+
+///< base of a state that accepts or halts without reading the next character
+#define FSM_TABLE_NO_READ 0xFFFFFFFF
+
+/**
+ * A DFA stored as a row displacement (comb) table. Bytes that
+ * lead to the same state from every state share a class and
+ * each state keeps its most common target as the default.
+ * State 0 is the start state, target states are stored + 1
+ * so that 0 halts the DFA.
+ */
+struct NeoastPatternTable_prv
+{
+    const uint8_t* classes;     ///< byte class of every byte, 256 entries
+    const uint32_t* accept;     ///< accepted group of each state, CONST_REDO to redo, 0 for none
+    const uint32_t* base;       ///< offset of each state's row in next/check or FSM_TABLE_NO_READ
+    const uint16_t* defaults;   ///< target of each state for classes not found in its row
+    const uint16_t* next;       ///< target of base[state] + class if check matches the state
+    const uint16_t* check;      ///< state owning each entry of next
+};
+
+/// FSM code TABLE, runs a DFA the same way as its generated goto code.
+static inline void FSM_TABLE(NeoastMatcher* m, const NeoastPatternTable* t)
+{
+    int c1 = 0;
+    uint32_t state = 0;
+    FSM_INIT(m, &c1);
+
+    for (;;)
+    {
+        if (state == 0)
+            FSM_FIND(m);
+        if (t->accept[state])
+            FSM_TAKE(m, t->accept[state], EOF);
+
+        uint32_t base = t->base[state];
+        if (base == FSM_TABLE_NO_READ)
+        {
+            FSM_HALT(m, CONST_UNK);
+            return;
+        }
+
+        c1 = FSM_CHAR(m);
+        if (c1 == EOF)
+        {
+            FSM_HALT(m, c1);
+            return;
+        }
+
+        uint32_t i = base + t->classes[c1];
+        uint32_t target = t->check[i] == state ? t->next[i] : t->defaults[state];
+        if (!target)
+        {
+            FSM_HALT(m, c1);
+            return;
+        }
+
+        state = target - 1;
+    }
 }
 
 #ifdef __cplusplus
@@ -50,6 +50,10 @@ struct NeoastMatcher_prv
     NeoastMatcherContext context_;
     NeoastInput* in;
     ParsingStack* lexing_state;
+#ifdef NEOAST_STATS
+    ParserStats* stats;     ///< statistics of the parse using this matcher, may be NULL
+#endif
+    NeoastLines* lines;     ///< index of the parsed text passed to the lexing error callback, may be NULL
 
     struct Option
     {
@@ -59,11 +63,12 @@ struct NeoastMatcher_prv
         char T; ///< tab size, must be a power of 2, default is 8, for column count and indent \i, \j, and \k
     } opt_;
 
-    char* buf_;      ///< input character sequence buffer
+    char* buf_;      ///< input character sequence buffer, aliases in-memory inputs scanned in place
+    char* own_;      ///< buffer owned by the matcher that inputs are copied into, NULL until one is
     char* txt_;      ///< points to the matched text in buffer AbstractMatcher::buf_
     size_t len_;     ///< size of the matched text
     size_t cap_;     ///< nonzero capture index of an accepted match or zero
-    size_t max_;     ///< total buffer size and max position + 1 to fill
+    size_t max_;     ///< total size of own_ and max position + 1 to fill
     size_t cur_;     ///< next position in AbstractMatcher::buf_ to assign to AbstractMatcher::txt_
     size_t pos_;     ///< position in AbstractMatcher::buf_ after AbstractMatcher::txt_
     size_t end_;     ///< ending position of the input buffered in AbstractMatcher::buf_
@@ -72,23 +77,19 @@ struct NeoastMatcher_prv
     int got_;        ///< last unsigned character we looked at (to determine anchors and boundaries)
     int chr_;        ///< the character located at AbstractMatcher::txt_[AbstractMatcher::len_]
 
-//#define WITH_SPAN
-#if defined(WITH_SPAN)
-    char     *bol_;  ///< begin of line pointer in buffer
-    Handler  *evh_;    ///< event handler functor to invoke when buffer contents are shifted out
-#endif
     char* lpb_;      ///< line pointer in buffer, updated when counting line numbers with lineno()
     size_t lno_;     ///< line number count (cached)
-#if !defined(WITH_SPAN)
     size_t cno_;     ///< column number count (cached)
-#endif
-    size_t num_;     ///< character count of the input till bol_
+    size_t num_;     ///< character count of the input till buf_
+    size_t lah_;     ///< input offset + 1 of the furthest character looked at by any scan
     bool_t eof_;     ///< input has reached EOF
+    bool_t partial_; ///< more input may arrive after EOF is reached (push parsing)
 
     size_t ded_;      ///< dedent count
     size_t col_;      ///< column counter for indent matching, updated by newline(), indent(), and dedent()
     NeoastVector tab_;      ///< tab stops set by detecting indent margins
     NeoastVector lap_;      ///< lookahead position in input that heads a lookahead match (indexed by lookahead number)
+    NeoastVector text_;     ///< NUL terminated copy of the matched text when the input is scanned in place
     NeoastMatcherFSM fsm_;  ///< local state for FSM code
     uint16_t lcp_;    ///< primary least common character position in the pattern prefix or 0xffff for pure Boyer-Moore
     uint16_t lcs_;    ///< secondary least common character position in the pattern prefix or 0xffff for pure Boyer-Moore
@@ -97,6 +98,35 @@ struct NeoastMatcher_prv
 
 void matcher_reset(NeoastMatcher* self);
 
+/**
+ * Count the newlines in a span of text with the
+ * widest vector unit the CPU supports
+ * @param s start of the text
+ * @param e end of the text
+ * @return number of '\n' bytes
+ */
+size_t matcher_count_lines(const char* s, const char* e);
+
+/**
+ * Count the UTF-8 characters in a span of text, every
+ * byte that is not a continuation byte starts one
+ * @param s start of the text
+ * @param e end of the text
+ * @return number of characters
+ */
+size_t matcher_count_chars(const char* s, const char* e);
+
+/**
+ * Advance a column over a span of text without newlines.
+ * Tabs move the column to the next tab stop.
+ * @param s start of the text
+ * @param e end of the text
+ * @param col column at the start of the text
+ * @param tab tab size, a power of 2
+ * @return column at the end of the text
+ */
+size_t matcher_count_columns(const char* s, const char* e, size_t col, size_t tab);
+
 int matcher_get_more(NeoastMatcher* self);
 
 static inline int matcher_get(NeoastMatcher* self);
@@ -152,7 +182,7 @@ static inline bool_t matcher_nodent(NeoastMatcher* self)
 
 static inline int matcher_get(NeoastMatcher* self)
 {
-    return self->pos_ < self->end_ ? (self->buf_[self->pos_++]) : matcher_get_more(self);
+    return self->pos_ < self->end_ ? (unsigned char) (self->buf_[self->pos_++]) : matcher_get_more(self);
 }
 
 /// Peek at the next character available for reading from the current input source.
@@ -162,6 +192,13 @@ static inline int matcher_peek(NeoastMatcher* self)
     return self->pos_ < self->end_ ? (unsigned char) (self->buf_[self->pos_]) : matcher_peek_more(self);
 }
 
+/// Returns true if the buffer aliases the input instead of holding a copy of it.
+static inline bool_t matcher_in_place(const NeoastMatcher* self)
+/// @returns true if buf_ points into a caller-owned buffer, which may never be written to
+{
+    return self->buf_ != self->own_;
+}
+
 /// Returns true if this matcher has no more input to read from the input character sequence.
 static inline bool_t matcher_at_end(NeoastMatcher* self)
 /// @returns true if at end of input and a read attempt will produce EOF
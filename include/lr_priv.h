@@ -0,0 +1,651 @@
+/* 
+ * This file is part of the Neoast framework
+ * Copyright (c) 2021 Andrei Tumbar.
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef NEOAST_LR_PRIV_H
+#define NEOAST_LR_PRIV_H
+
+#include <neoast.h>
+#include <string.h>
+#include <assert.h>
+
+/*
+ * LR drivers shared by the runtime and by the generated parsers.
+ * Generated parsers include this header to instantiate the driver
+ * with their own table format and lexer so that every lookup and
+ * lexer call is resolved at compile time.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define OFFSET_VOID_PTR(ptr, s, i) (void*)(((char*)(ptr)) + ((s) * (i)))
+#define NEOAST_FORCE_INLINE inline __attribute__((always_inline))
+
+static inline
+const void* g_table_from_matrix(const void* table,
+                                size_t row, size_t col,
+                                size_t col_n)
+{
+    size_t off = sizeof(uint32_t) * ((row * col_n) + (col));
+    return ((const char*) table) + off;
+}
+
+static inline
+uint32_t g_table_from_compressed(const CompressedTable* table,
+                                 uint32_t state, uint32_t tok)
+{
+    uint32_t i = table->base[state] + tok;
+    if (table->check[i] == state)
+    {
+        return table->next[i];
+    }
+
+    return table->defaults[state];
+}
+
+static NEOAST_FORCE_INLINE
+uint32_t g_split_entry(const void* table, table_format_t format, size_t i)
+{
+    switch (format)
+    {
+        case TABLE_FORMAT_SPLIT_8:
+            return ((const uint8_t*) table)[i];
+        case TABLE_FORMAT_SPLIT_16:
+            return ((const uint16_t*) table)[i];
+        default:
+            return ((const uint32_t*) table)[i];
+    }
+}
+
+static NEOAST_FORCE_INLINE
+uint32_t g_table_from_split(const SplitTable* table,
+                            table_format_t format,
+                            uint32_t state, uint32_t tok,
+                            const GrammarParser* parser)
+{
+    if (tok >= parser->action_token_n)
+    {
+        uint32_t goto_n = parser->token_n - parser->action_token_n;
+        uint32_t next_state = g_split_entry(table->gotos, format,
+                                            state * goto_n + tok - parser->action_token_n);
+        return next_state ? next_state | TOK_SHIFT_MASK : TOK_SYNTAX_ERROR;
+    }
+
+    // Decode the narrow entry back into an action
+    uint32_t entry = g_split_entry(table->actions, format,
+                                   state * parser->action_token_n + tok);
+    if (entry == 0)
+    {
+        return TOK_SYNTAX_ERROR;
+    }
+    else if (entry < table->state_n)
+    {
+        return entry | TOK_SHIFT_MASK;
+    }
+    else if (entry == table->state_n)
+    {
+        return TOK_ACCEPT_MASK;
+    }
+
+    return (entry - table->state_n) | TOK_REDUCE_MASK;
+}
+
+/**
+ * Look up the action of a state on a token
+ * Callers pass a constant format so that each
+ * driver is specialised for a single table layout
+ */
+static NEOAST_FORCE_INLINE
+uint32_t g_table_lookup(const void* parsing_table,
+                        table_format_t format,
+                        uint32_t state, uint32_t tok,
+                        const GrammarParser* parser)
+{
+    switch (format)
+    {
+        case TABLE_FORMAT_COMPRESSED:
+            return g_table_from_compressed((const CompressedTable*) parsing_table, state, tok);
+        case TABLE_FORMAT_SPLIT_8:
+        case TABLE_FORMAT_SPLIT_16:
+        case TABLE_FORMAT_SPLIT_32:
+            return g_table_from_split((const SplitTable*) parsing_table, format, state, tok, parser);
+        case TABLE_FORMAT_DENSE:
+        default:
+            return *(const uint32_t*) g_table_from_matrix(parsing_table, state, tok, parser->token_n);
+    }
+}
+
+/**
+ * Position stored after the value in a slot
+ * @return NULL if the grammar does not track positions
+ */
+static inline
+const TokenPosition* g_lr_position(const ParserBuffers* buffers, const char* value)
+{
+    return buffers->union_s < buffers->val_s
+           ? (const TokenPosition*) (value + buffers->union_s)
+           : NULL;
+}
+
+static inline
+char* g_lr_move_lookahead(const ParserBuffers* buffers,
+                          char* lex_val,
+                          uint32_t from, uint32_t to)
+{
+    char* dest_val = (char*) OFFSET_VOID_PTR(buffers->value_table, buffers->val_s, to);
+    memcpy(dest_val, lex_val, buffers->val_s);
+    buffers->token_table[to] = buffers->token_table[from];
+    return dest_val;
+}
+
+static NEOAST_FORCE_INLINE
+uint32_t g_lr_reduce(
+        const GrammarParser* parser,
+        void* context,
+        const void* parsing_table,
+        table_format_t format,
+        uint32_t reduce_token,
+        const ParserBuffers* buffers,
+        uint32_t* dest_idx)
+{
+    // Find how many tokens to pop
+    // due to this rule
+    const GrammarRule* reduce_rule = &parser->grammar_rules[reduce_token & TOK_MASK];
+    uint32_t arg_count = reduce_rule->tok_n;
+
+    // Values on the stack are contiguous, the arguments
+    // are passed to the action in place. The result will be
+    // placed in the slot of the first argument or in the first
+    // free slot for an empty rule.
+    assert(buffers->parsing_stack->pos % 2 == 1 && buffers->parsing_stack->pos > (arg_count << 1));
+    buffers->parsing_stack->pos -= arg_count << 1;
+    uint32_t idx = buffers->parsing_stack->pos >> 1;
+    assert(!arg_count || buffers->parsing_stack->data[buffers->parsing_stack->pos] == idx);
+
+    char* args = (char*) OFFSET_VOID_PTR(buffers->value_table, buffers->val_s, idx);
+
+    int32_t result_token = (int32_t) reduce_rule->token - NEOAST_ASCII_MAX;
+    assert(result_token > 0);
+
+    if (arg_count > 0)
+    {
+        // Actions may still read the arguments after
+        // writing the result, don't let them alias
+        parser->parser_reduce(reduce_token & TOK_MASK, buffers->reduce_dest, (void**) args,
+                              context, buffers->arena, buffers->lines);
+
+        // The positional data of the first argument
+        // is already in place, only copy the value
+        memcpy(args, buffers->reduce_dest, buffers->union_s);
+    }
+    else
+    {
+        parser->parser_reduce(reduce_token & TOK_MASK, args, (void**) args,
+                              context, buffers->arena, buffers->lines);
+
+        // No argument (empty rule), no positional data available
+        if (buffers->union_s < buffers->val_s)
+        {
+            memset(args + buffers->union_s, 0, buffers->val_s - buffers->union_s);
+        }
+    }
+
+    // Fill the result
+    buffers->token_table[idx] = result_token;
+
+    // Check the goto
+    uint32_t next_state = g_table_lookup(
+            parsing_table, format,
+            NEOAST_STACK_PEEK(buffers->parsing_stack), // Top of stack is current state
+            result_token,
+            parser);
+
+    next_state &= TOK_MASK;
+
+    NEOAST_STACK_PUSH(buffers->parsing_stack, idx);
+    NEOAST_STACK_PUSH(buffers->parsing_stack, next_state);
+
+    *dest_idx = idx;
+    return next_state;
+}
+
+static inline
+void run_destructor(const GrammarParser* parser,
+                    const ParserBuffers* buffers,
+                    uint32_t index)
+{
+    uint32_t current_token = buffers->token_table[index];
+
+    if (current_token < parser->token_n         // Don't free invalid tokens
+        && parser->destructors[current_token])  // Only free tokens that have a destructor
+    {
+        void* self_ptr = OFFSET_VOID_PTR(buffers->value_table,
+                                         buffers->val_s, index);
+
+        // A destructor is defined for this token
+        // Call the destructor on this object
+        parser->destructors[current_token](self_ptr);
+        memset(self_ptr, 0, buffers->val_s);
+    }
+}
+
+static inline
+void parser_run_destructors(
+        const GrammarParser* parser,
+        const ParserBuffers* buffers,
+        int32_t invalid_tok_i)
+{
+    if (!parser->destructors)
+    {
+        // Destructors have not been defined
+        return;
+    }
+
+    // Free the current invalid token
+    if (invalid_tok_i >= 0)
+    {
+        run_destructor(parser, buffers, invalid_tok_i);
+    }
+
+    // Free the reduced tokens
+    assert(buffers->parsing_stack->pos % 2 == 1);
+    while (buffers->parsing_stack->pos > 1) // lastly, hold the initialized state '0'
+    {
+        (void) NEOAST_STACK_POP(buffers->parsing_stack); // state
+        uint32_t index = NEOAST_STACK_POP(buffers->parsing_stack);
+        run_destructor(parser, buffers, index);
+    }
+}
+
+/**
+ * Make room for a push onto the parsing stack
+ * and the lookahead slot above the new value
+ * @return 0 on success, -1 if the buffers are exhausted
+ */
+static inline
+int g_lr_reserve(ParserBuffers* buffers, uint32_t i)
+{
+    if (buffers->parsing_stack->pos + 2 <= buffers->stack_n
+        && i + 2 <= buffers->table_n)
+    {
+        return 0;
+    }
+
+    if (parser_grow_buffers(buffers, i + 2, buffers->parsing_stack->pos + 2) == 0)
+    {
+        return 0;
+    }
+
+    fprintf(stderr, "Parser buffers exhausted: %u tokens, %u stack entries\n",
+            buffers->table_n, buffers->stack_n);
+    return -1;
+}
+
+// Returned by the LR driver when it needs a lookahead
+// that has not been pushed yet
+#define LR_NEED_MORE (-2)
+
+/**
+ * LR driver shared by the pull and push interfaces
+ * The driver is resumable, every bit of state lives on the parsing stack:
+ * the current state is on top and the lookahead goes in the
+ * first free slot of the value table.
+ *
+ * Pull: ll_next is called whenever a lookahead is needed
+ * Push: ll_next is NULL, tok is the lookahead already written
+ *       to the value table. LR_NEED_MORE is returned once the
+ *       next lookahead is needed.
+ *
+ * With max_steps, NEOAST_PARSE_SUSPENDED is returned after that many
+ * shifts and reductions. A suspended pull parse that already read its
+ * lookahead flags it in the buffers so that it is not read again.
+ */
+static NEOAST_FORCE_INLINE
+int32_t parser_parse_lr_impl(const GrammarParser* parser,
+                             void* context,
+                             const void* parsing_table,
+                             table_format_t format,
+                             ParserBuffers* buffers,
+                             void* lexer,
+                             int ll_next(void*, void*, void*),
+                             int32_t tok,
+                             uint32_t max_steps)
+{
+    ParsingStack* stack = buffers->parsing_stack;
+
+    // Push the initial state to the stack
+    if (stack->pos == 0)
+    {
+        NEOAST_STACK_PUSH(stack, 0);
+
+        // Values of the last parse are gone
+        neoast_arena_reset(buffers->arena);
+        buffers->has_lookahead = 0;
+    }
+
+    uint32_t current_state = NEOAST_STACK_PEEK(stack);
+    uint32_t i = stack->pos >> 1; // slot of the lookahead, right above the value stack
+    uint32_t prev_tok = stack->pos > 1 ? buffers->token_table[stack->data[stack->pos - 2]] : 0;
+    int has_lookahead = 0;
+    uint32_t steps = 0;
+
+    // Lexer states
+    char* lex_val = (char*) OFFSET_VOID_PTR(buffers->value_table, buffers->val_s, i);
+
+    if (!ll_next)
+    {
+        buffers->token_table[i] = tok;
+        has_lookahead = 1;
+
+        // Check for lexing error
+        if (tok < 0)
+        {
+            parser_run_destructors(parser, buffers, -1);
+            return -1;
+        }
+
+        NEOAST_STAT(buffers->stats.tokens++);
+        NEOAST_STAT(parser_stats_max(&buffers->stats.max_token_index, i));
+    }
+    else if (buffers->has_lookahead)
+    {
+        // Suspended right after reading this token
+        tok = buffers->token_table[i];
+        has_lookahead = 1;
+        buffers->has_lookahead = 0;
+    }
+
+    uint32_t dest_idx = 0; // index of the last reduction
+    while (1)
+    {
+        uint32_t reduce_value;
+        if (parser->default_reductions && parser->default_reductions[current_state])
+        {
+            // Consistent state, reduce without
+            // looking at (or reading) the lookahead
+            reduce_value = parser->default_reductions[current_state];
+        }
+        else
+        {
+            if (!has_lookahead)
+            {
+                if (!ll_next)
+                {
+                    // Wait for the caller to push the next token
+                    return LR_NEED_MORE;
+                }
+
+                tok = ll_next(lexer, lex_val, context);
+                buffers->token_table[i] = tok;
+                has_lookahead = 1;
+
+                // Check for lexing error
+                if (tok < 0)
+                {
+                    parser_run_destructors(parser, buffers, -1);
+                    return -1;
+                }
+
+                NEOAST_STAT(buffers->stats.tokens++);
+                NEOAST_STAT(parser_stats_max(&buffers->stats.max_token_index, i));
+            }
+
+            uint32_t table_value = g_table_lookup(
+                    parsing_table, format,
+                    current_state,
+                    tok,
+                    parser);
+
+            if (table_value == TOK_SYNTAX_ERROR)
+            {
+                parser_syntax_error(parser,
+                                    context,
+                                    parsing_table,
+                                    g_lr_position(buffers, lex_val), buffers->lines,
+                                    buffers->parsing_stack->data,
+                                    (buffers->parsing_stack->pos + 1) >> 1, 2,
+                                    tok, prev_tok);
+
+                // We need to free the remaining objects in this map
+                parser_run_destructors(parser, buffers, (int32_t) i);
+                return -1;
+            }
+            else if (table_value & TOK_SHIFT_MASK)
+            {
+                if (g_lr_reserve(buffers, i) != 0)
+                {
+                    parser_run_destructors(parser, buffers, (int32_t) i);
+                    return -1;
+                }
+
+                stack = buffers->parsing_stack;
+                current_state = table_value & TOK_MASK;
+                NEOAST_STACK_PUSH(stack, i);
+                NEOAST_STACK_PUSH(stack, current_state);
+                prev_tok = tok;
+                NEOAST_STAT(buffers->stats.shifts++);
+                NEOAST_STAT(parser_stats_max(&buffers->stats.max_depth, stack->pos >> 1));
+
+                i++;
+                lex_val = (char*) OFFSET_VOID_PTR(buffers->value_table, buffers->val_s, i);
+                has_lookahead = 0;
+
+                if (max_steps && ++steps >= max_steps)
+                {
+                    return NEOAST_PARSE_SUSPENDED;
+                }
+                continue;
+            }
+            else if (table_value & TOK_ACCEPT_MASK)
+            {
+                // The start symbol is the only value left on the stack
+                return (int32_t) stack->data[stack->pos - 2];
+            }
+
+            // Goto rules cannot occur here
+            assert(table_value & TOK_REDUCE_MASK);
+            assert(tok < parser->action_token_n);
+            assert(buffers->token_table[i] == tok);
+
+            reduce_value = table_value;
+            prev_tok = parser->grammar_rules[table_value & TOK_MASK].token - NEOAST_ASCII_MAX;
+        }
+
+        if (parser->grammar_rules[reduce_value & TOK_MASK].tok_n == 0)
+        {
+            // Empty rules grow the stack
+            if (g_lr_reserve(buffers, i) != 0)
+            {
+                parser_run_destructors(parser, buffers, has_lookahead ? (int32_t) i : -1);
+                return -1;
+            }
+
+            stack = buffers->parsing_stack;
+            lex_val = (char*) OFFSET_VOID_PTR(buffers->value_table, buffers->val_s, i);
+
+            if (has_lookahead)
+            {
+                // The result of an empty rule goes in the lookahead's slot
+                lex_val = g_lr_move_lookahead(buffers, lex_val, i, i + 1);
+                i++;
+                NEOAST_STAT(parser_stats_max(&buffers->stats.max_token_index, i));
+            }
+        }
+
+        // Reduce this rule
+        current_state = g_lr_reduce(parser, context, parsing_table, format,
+                                    reduce_value, buffers,
+                                    &dest_idx);
+        NEOAST_STAT(parser_stats_reduce(&buffers->stats, reduce_value & TOK_MASK));
+        NEOAST_STAT(parser_stats_max(&buffers->stats.max_depth, buffers->parsing_stack->pos >> 1));
+
+        if (!has_lookahead)
+        {
+            i = dest_idx + 1;
+            lex_val = (char*) OFFSET_VOID_PTR(buffers->value_table, buffers->val_s, i);
+        }
+        else if (i != dest_idx + 1)
+        {
+            // Move the lookahead to the slot in front of the
+            // result. We should do this so that we don't fill up the
+            // buffer tables. As rules reduce we reduce our footprint
+            // on the buffers.
+            lex_val = g_lr_move_lookahead(buffers, lex_val, i, dest_idx + 1);
+            i = dest_idx + 1;
+        }
+
+        if (max_steps && ++steps >= max_steps)
+        {
+            // The lookahead is kept in the slot above the stack
+            buffers->has_lookahead = has_lookahead;
+            return NEOAST_PARSE_SUSPENDED;
+        }
+    }
+}
+
+/**
+ * Recognizer driver, only the states are tracked
+ * Every token is lexed into the first slot of the value
+ * table and dropped right away. Nothing is reduced.
+ */
+static NEOAST_FORCE_INLINE
+int32_t parser_validate_lr_impl(const GrammarParser* parser,
+                                void* context,
+                                const void* parsing_table,
+                                table_format_t format,
+                                ParserBuffers* buffers,
+                                void* lexer,
+                                int ll_next(void*, void*, void*),
+                                TokenPosition* error_position)
+{
+    ParsingStack* stack = buffers->parsing_stack;
+    char* lex_val = (char*) buffers->value_table;
+
+    stack->pos = 0;
+    NEOAST_STACK_PUSH(stack, 0);
+
+    uint32_t current_state = 0;
+    int32_t tok = 0;
+    int has_lookahead = 0;
+    while (1)
+    {
+        uint32_t reduce_value;
+        if (parser->default_reductions && parser->default_reductions[current_state])
+        {
+            reduce_value = parser->default_reductions[current_state];
+        }
+        else
+        {
+            if (!has_lookahead)
+            {
+                tok = ll_next(lexer, lex_val, context);
+                if (tok < 0)
+                {
+                    break;
+                }
+
+                NEOAST_STAT(buffers->stats.tokens++);
+
+                // The value is never used
+                if (parser->destructors && parser->destructors[tok])
+                {
+                    parser->destructors[tok](lex_val);
+                }
+
+                has_lookahead = 1;
+            }
+
+            uint32_t table_value = g_table_lookup(
+                    parsing_table, format,
+                    current_state,
+                    tok,
+                    parser);
+
+            if (table_value == TOK_SYNTAX_ERROR)
+            {
+                break;
+            }
+            else if (table_value & TOK_SHIFT_MASK)
+            {
+                if (stack->pos + 1 > buffers->stack_n
+                    && parser_grow_buffers(buffers, buffers->table_n, stack->pos + 1) != 0)
+                {
+                    break;
+                }
+
+                stack = buffers->parsing_stack;
+                lex_val = (char*) buffers->value_table;
+                current_state = table_value & TOK_MASK;
+                NEOAST_STACK_PUSH(stack, current_state);
+                has_lookahead = 0;
+                NEOAST_STAT(buffers->stats.shifts++);
+                NEOAST_STAT(parser_stats_max(&buffers->stats.max_depth, stack->pos - 1));
+                continue;
+            }
+            else if (table_value & TOK_ACCEPT_MASK)
+            {
+                return 0;
+            }
+
+            reduce_value = table_value;
+        }
+
+        const GrammarRule* rule = &parser->grammar_rules[reduce_value & TOK_MASK];
+        if (rule->tok_n == 0
+            && stack->pos + 1 > buffers->stack_n
+            && parser_grow_buffers(buffers, buffers->table_n, stack->pos + 1) != 0)
+        {
+            break;
+        }
+
+        stack = buffers->parsing_stack;
+        lex_val = (char*) buffers->value_table;
+        stack->pos -= rule->tok_n;
+        current_state = g_table_lookup(
+                parsing_table, format,
+                NEOAST_STACK_PEEK(stack),
+                rule->token - NEOAST_ASCII_MAX,
+                parser) & TOK_MASK;
+        NEOAST_STACK_PUSH(stack, current_state);
+        NEOAST_STAT(parser_stats_reduce(&buffers->stats, reduce_value & TOK_MASK));
+        NEOAST_STAT(parser_stats_max(&buffers->stats.max_depth, stack->pos - 1));
+    }
+
+    if (error_position)
+    {
+        // Position of the token that was rejected
+        const TokenPosition* p = g_lr_position(buffers, lex_val);
+        if (p)
+        {
+            memcpy(error_position, p, sizeof(TokenPosition));
+        }
+        else
+        {
+            memset(error_position, 0, sizeof(TokenPosition));
+        }
+    }
+
+    stack->pos = 0;
+    return -1;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //NEOAST_LR_PRIV_H
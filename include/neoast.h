@@ -35,17 +35,40 @@ extern "C" {
 #define NEOAST_STACK_POP(stack) (stack)->data[--((stack)->pos)]
 #define NEOAST_STACK_PEEK(stack) (stack)->data[(stack)->pos - 1]
 
+// Returned by a budgeted parse that ran out of steps, see parser_parse_lr_budget()
+#define NEOAST_PARSE_SUSPENDED (-3)
+
+// Parse statistics are only collected when built with NEOAST_STATS
+#ifdef NEOAST_STATS
+#define NEOAST_STAT(expr) expr
+#else
+#define NEOAST_STAT(expr)
+#endif
+
 typedef struct GrammarParser_prv GrammarParser;
 typedef struct GrammarRule_prv GrammarRule;
 typedef struct ParsingStack_prv ParsingStack;
 typedef struct ParserBuffers_prv ParserBuffers;
 typedef struct TokenPosition_prv TokenPosition;
+typedef struct TokenLocation_prv TokenLocation;
+typedef struct NeoastLines_prv NeoastLines;
+typedef struct CompressedTable_prv CompressedTable;
+typedef struct SplitTable_prv SplitTable;
+typedef struct ParserStats_prv ParserStats;
+typedef struct NeoastArena_prv NeoastArena;
+typedef struct NeoastTree_prv NeoastTree;
 
 typedef uint32_t tok_t;
 
-typedef void (*parser_reduce) (tok_t reduce_rule, void* dest, void** values, void* context);
+typedef void (*parser_reduce) (tok_t reduce_rule, void* dest, void** values, void* context, NeoastArena* arena,
+                               NeoastLines* lines);
 typedef void (*parser_destructor) (void* self);
 
+// Batch parsing, see parser_run_batch()
+typedef void* (*parser_worker_new) (void* shared);
+typedef void (*parser_worker_free) (void* worker);
+typedef void (*parser_worker_job) (void* shared, void* worker, uint32_t i);
+
 
 // User defined error callbacks
 
@@ -54,12 +77,14 @@ typedef void (*ll_error_cb)(
         void* error_ctx,                 //!< Arbitrary pointer passed to error
         const char* input,               //!< NeoastInput passed in with parse()
         const TokenPosition* position,   //!< Position of unmatched token
+        NeoastLines* lines,              //!< Index of the parsed text to locate position in (may be NULL)
         const char* lexer_state);
 
 typedef void (*yy_error_cb)(
         void* error_ctx,                 //!< Arbitrary pointer passed to error
         const char* const* token_names,  //!< List of token names
-        const TokenPosition* position,   //!< Position of syntax error
+        const TokenPosition* position,   //!< Position of syntax error (NULL if not tracked)
+        NeoastLines* lines,              //!< Index of the parsed text to locate position in (may be NULL)
         tok_t last_token,                //!< Token before
         tok_t current_token,             //!< Error token
         const tok_t expected_tokens[],   //!< Excepted next tokens
@@ -93,6 +118,32 @@ enum
     ),
 };
 
+typedef enum
+{
+    // Full state x token matrix
+    TABLE_FORMAT_DENSE,
+
+    // Row displacement (comb) table, see CompressedTable
+    TABLE_FORMAT_COMPRESSED,
+
+    // Separate action and goto matrices with narrow entries, see SplitTable
+    TABLE_FORMAT_SPLIT_8,
+    TABLE_FORMAT_SPLIT_16,
+    TABLE_FORMAT_SPLIT_32,
+} table_format_t;
+
+typedef enum
+{
+    // Token was consumed, push the next one
+    NEOAST_PUSH_NEED_MORE,
+
+    // Input was accepted, the result is in slot 0 of the value table
+    NEOAST_PUSH_ACCEPT,
+
+    // Syntax or lexing error, the destructors have been run
+    NEOAST_PUSH_ERROR,
+} push_status_t;
+
 enum
 {
     PRECEDENCE_NONE,
@@ -120,6 +171,54 @@ struct GrammarParser_prv
     tok_t grammar_n;
     tok_t token_n;
     tok_t action_token_n;
+
+    // Layout of the parsing table passed to parser_parse_lr()
+    table_format_t table_format;
+
+    // Reduction to perform in each state without reading the
+    // lookahead token, TOK_SYNTAX_ERROR (0) if the state needs a lookahead
+    // May be NULL to always read the lookahead
+    const uint32_t* default_reductions;
+
+    // Terminals each state has an action for, a bitset row of
+    // (action_token_n + 31) / 32 words per state
+    // May be NULL to scan the parsing table on syntax errors
+    const uint32_t* expected_tokens;
+};
+
+/**
+ * Row displacement compressed parsing table.
+ * Every state owns a row starting at base[state] in the next/check
+ * vectors. A slot only belongs to a state if check[] holds that state,
+ * otherwise the state's default action is used:
+ *
+ *   i = base[state] + tok
+ *   action = check[i] == state ? next[i] : defaults[state]
+ */
+struct CompressedTable_prv
+{
+    const uint32_t* base;               //!< Row offset of each state into next/check
+    const uint32_t* defaults;           //!< Most common action in each row
+    const uint32_t* next;               //!< Packed non-default actions
+    const uint32_t* check;              //!< Owning state of each slot in next
+};
+
+/**
+ * Parsing table split into an action matrix over the terminals
+ * (state_n x action_token_n) and a goto matrix over the nonterminals
+ * (state_n x (token_n - action_token_n)). Entries are uint8_t, uint16_t
+ * or uint32_t depending on the table format and encode actions as:
+ *
+ *   0                  syntax error (no goto)
+ *   1 .. state_n - 1   shift/goto this state
+ *   state_n            accept
+ *   state_n + rule     reduce this rule
+ */
+struct SplitTable_prv
+{
+    const void* actions;                //!< Actions on terminals
+    const void* gotos;                  //!< Gotos on nonterminals
+    uint32_t state_n;                   //!< Number of states (rows)
 };
 
 struct ParsingStack_prv
@@ -128,21 +227,54 @@ struct ParsingStack_prv
     uint32_t data[];
 };
 
+struct ParserStats_prv
+{
+    uint64_t tokens;                    //!< Tokens read from the lexer
+    uint64_t shifts;                    //!< Tokens shifted onto the parsing stack
+    uint64_t reduces;                   //!< Rules reduced
+    uint64_t* rule_reduces;             //!< Reductions of each rule id
+    uint32_t rule_n;                    //!< Number of entries in rule_reduces
+    uint32_t max_depth;                 //!< Most values on the parsing stack at once
+    uint32_t max_token_index;           //!< Highest slot of the token/value table used
+    uint64_t bytes;                     //!< Input bytes read by the lexer
+    uint64_t lexer_grows;               //!< Times the lexer had to enlarge its buffer
+};
+
 struct ParserBuffers_prv
 {
     void* value_table;                  //!< Value table
     int32_t* token_table;               //!< Token table
     ParsingStack* parsing_stack;        //!< LR parsing stack
+    void* reduce_dest;                  //!< Destination value of reductions ($$)
     uint32_t val_s;                     //!< Size of each value in bytes
     uint32_t union_s;                   //!< If no token position data, this is the same as val_s
     uint32_t table_n;                   //!< Number of tokens/values in the tables
+    uint32_t stack_n;                   //!< Number of entries in the parsing stack
+    uint32_t max_table_n;               //!< Hard limit of table_n, 0 for no limit
+    uint32_t max_stack_n;               //!< Hard limit of stack_n, 0 for no limit
+    NeoastArena* arena;                 //!< Memory for values built by the actions, reset on every parse
+    NeoastLines* lines;                 //!< Text being parsed, used to locate syntax errors reported to stderr
+    uint32_t has_lookahead;             //!< The suspended parse already read the token above its stack
+#ifdef NEOAST_STATS
+    ParserStats stats;                  //!< Counters of every parse run with these buffers
+#endif
 };
 
+/**
+ * Tokens only keep where they are in the input. Lines
+ * and columns are worked out when they are asked for,
+ * see neoast_lines_locate()
+ */
 struct TokenPosition_prv
 {
-    uint32_t line;
-    uint16_t col;
-    uint16_t len;
+    uint64_t offset;                    //!< Byte offset of the token in the input
+    uint32_t len;                       //!< Length of the token in bytes, 0 if there is no token
+};
+
+struct TokenLocation_prv
+{
+    uint32_t line;                      //!< Line number starting at 1
+    uint32_t col;                       //!< Column starting at 0 in UTF-8 characters, tabs stop every 8 columns
 };
 
 #ifndef NEOAST_PARSER_H
@@ -150,6 +282,16 @@ struct TokenPosition_prv
 
 ParsingStack* parser_allocate_stack(size_t stack_n);
 void parser_free_stack(ParsingStack* self);
+
+/**
+ * Allocate the buffers used by the LR parser.
+ * The buffers start out small and grow as the parse gets deeper.
+ * @param max_tokens maximum number of tokens/values in the tables, 0 for no limit
+ * @param parsing_stack_n maximum depth of the parsing stack, 0 for no limit
+ * @param val_s size of each value (union + position) in bytes
+ * @param union_s offset of the position in each value
+ * @return buffers to free with parser_free_buffers()
+ */
 ParserBuffers* parser_allocate_buffers(int max_tokens,
                                        int parsing_stack_n,
                                        size_t val_s,
@@ -157,23 +299,348 @@ ParserBuffers* parser_allocate_buffers(int max_tokens,
 void parser_free_buffers(ParserBuffers* self);
 void parser_reset_buffers(const ParserBuffers* self);
 
+/**
+ * Grow the buffers to fit at least table_n tokens/values
+ * and stack_n parsing stack entries. Pointers into the
+ * tables and the parsing stack are invalidated.
+ * @param self buffers to grow
+ * @param table_n required number of tokens/values
+ * @param stack_n required number of parsing stack entries
+ * @return 0 on success, -1 if a limit was hit or memory ran out
+ */
+int parser_grow_buffers(ParserBuffers* self, uint32_t table_n, uint32_t stack_n);
+
+/**
+ * Create an arena. Memory is handed out from large blocks
+ * and released all at once, there is no way to free a single
+ * allocation.
+ * @return arena to free with neoast_arena_free()
+ */
+NeoastArena* neoast_arena_new(void);
+
+/**
+ * Allocate memory that lives until the arena is reset or freed
+ * @param self arena to allocate from
+ * @param size number of bytes to allocate
+ * @return memory aligned for any type, NULL if memory ran out
+ */
+void* neoast_arena_alloc(NeoastArena* self, size_t size);
+
+/**
+ * Release every allocation at once. The blocks
+ * are kept to be reused by the next allocations.
+ * @param self arena to reset
+ */
+void neoast_arena_reset(NeoastArena* self);
+void neoast_arena_free(NeoastArena* self);
+
+/**
+ * Count the bytes handed out since the last reset
+ * @param self arena to measure
+ * @return bytes allocated, including the alignment padding
+ */
+size_t neoast_arena_used(const NeoastArena* self);
+
+/**
+ * Create an index of where the lines of a text start. Nothing
+ * is indexed until a position is looked up, only the text up
+ * to the furthest offset asked for is ever searched.
+ * @return index to free with neoast_lines_free()
+ */
+NeoastLines* neoast_lines_new(void);
+
+/**
+ * Point the index at a new text. The text is not copied,
+ * it must outlive every lookup.
+ * @param self index to reset
+ * @param text text the positions are offsets into (may be NULL)
+ * @param len length of the text in bytes
+ */
+void neoast_lines_reset(NeoastLines* self, const char* text, uint64_t len);
+void neoast_lines_free(NeoastLines* self);
+
+/**
+ * Get the line and column of an offset into the text
+ * @param self index of the text (may be NULL)
+ * @param offset byte offset, usually TokenPosition.offset
+ * @param location set to the line and column of the offset
+ * @return 0 on success, -1 if there is no text or the offset is past its end
+ */
+int neoast_lines_locate(NeoastLines* self, uint64_t offset, TokenLocation* location);
+
+#ifdef NEOAST_STATS
+/**
+ * Get the counters of every parse that ran with these
+ * buffers since they were allocated or last reset
+ * @param self buffers to get the statistics of
+ * @return statistics owned by the buffers
+ */
+const ParserStats* parser_get_stats(const ParserBuffers* self);
+
+/**
+ * Clear the parse statistics
+ * @param self buffers to clear the statistics of
+ */
+void parser_reset_stats(ParserBuffers* self);
+
+/**
+ * Count the reduction of a rule
+ * @param self statistics to update
+ * @param rule_id rule that was reduced
+ */
+void parser_stats_reduce(ParserStats* self, uint32_t rule_id);
+
+static inline void parser_stats_max(uint32_t* stat, uint32_t value)
+{
+    if (value > *stat)
+    {
+        *stat = value;
+    }
+}
+#endif
+
 /**
  * Run the LR parsing algorithm
  * given a parser with the parsing
  * table filled.
  * @param parser target parser (kept constant)
- * @param stack used for parsing
- * @param token_table tokens from lexer
- * @param val_table values from lexer
- * @param val_s sizeof each value
+ * @param context arbitrary pointer passed to the lexer, actions and error callback
+ * @param parsing_table uint32_t matrix, CompressedTable or SplitTable depending on parser->table_format
+ * @param buffers token, value and stack buffers used during parsing
+ * @param lexer lexer instance passed to ll_next
+ * @param ll_next get the next token from the lexer
  * @return index in token/value table where the parsed value resides
  */
 int32_t parser_parse_lr(const GrammarParser* parser,
                         void* context,
-                        const uint32_t* parsing_table,
-                        const ParserBuffers* buffers,
+                        const void* parsing_table,
+                        ParserBuffers* buffers,
                         void* lexer,
                         int ll_next(void*, void*, void*));
+
+/**
+ * Start an LR parse that stops after a number of shifts and reductions.
+ * A parse that runs out of steps keeps its state in the buffers and the
+ * lexer, continue it with parser_resume_lr(). Use this to split a long
+ * parse into slices of bounded latency.
+ *
+ * Once the parse is accepted or fails, the buffers are reset. The
+ * result stays in the value table until the next parse starts.
+ * @param parser target parser (kept constant)
+ * @param context arbitrary pointer passed to the lexer, actions and error callback
+ * @param parsing_table uint32_t matrix, CompressedTable or SplitTable depending on parser->table_format
+ * @param buffers token, value and stack buffers holding the parse state
+ * @param lexer lexer instance passed to ll_next
+ * @param ll_next get the next token from the lexer
+ * @param max_steps shifts and reductions to run before suspending, 0 for no limit
+ * @return index in token/value table where the parsed value resides,
+ *         -1 on error or NEOAST_PARSE_SUSPENDED if the steps ran out
+ */
+int32_t parser_parse_lr_budget(const GrammarParser* parser,
+                               void* context,
+                               const void* parsing_table,
+                               ParserBuffers* buffers,
+                               void* lexer,
+                               int ll_next(void*, void*, void*),
+                               uint32_t max_steps);
+
+/**
+ * Continue a parse suspended by parser_parse_lr_budget() or by
+ * an earlier call to this with the same buffers and lexer
+ * See parser_parse_lr_budget()
+ */
+int32_t parser_resume_lr(const GrammarParser* parser,
+                         void* context,
+                         const void* parsing_table,
+                         ParserBuffers* buffers,
+                         void* lexer,
+                         int ll_next(void*, void*, void*),
+                         uint32_t max_steps);
+
+/**
+ * Drop a suspended parse instead of resuming it. The destructors
+ * are run on every value it holds and the buffers are reset.
+ * @param parser parser of the suspended parse
+ * @param buffers buffers holding the suspended parse
+ */
+void parser_abort_lr(const GrammarParser* parser, ParserBuffers* buffers);
+
+/**
+ * Check if an input is accepted by the parser without building
+ * any values. Only the LR states are tracked, actions and the error
+ * callback are not run. The lexer still runs its actions, every token
+ * value is dropped through its destructor right after it is read.
+ * @param parser target parser (kept constant)
+ * @param context arbitrary pointer passed to the lexer
+ * @param parsing_table uint32_t matrix, CompressedTable or SplitTable depending on parser->table_format
+ * @param buffers only the parsing stack and a single value slot are used
+ * @param lexer lexer instance passed to ll_next
+ * @param ll_next get the next token from the lexer
+ * @param error_position set to the position of the rejected token, zeroed
+ *                       if positions are not tracked (may be NULL)
+ * @return 0 if the input is accepted, -1 if it is rejected
+ */
+int32_t parser_validate_lr(const GrammarParser* parser,
+                           void* context,
+                           const void* parsing_table,
+                           ParserBuffers* buffers,
+                           void* lexer,
+                           int ll_next(void*, void*, void*),
+                           TokenPosition* error_position);
+
+/**
+ * Run the LR parsing algorithm with the lexer on a helper thread.
+ * Tokens are handed to the parser through a ring buffer so that
+ * lexing overlaps with parsing and the grammar actions.
+ *
+ * The lexer runs concurrently with the actions and the error callback.
+ * It must not depend on anything they change, including the context.
+ * Falls back to parser_parse_lr() if no thread can be started.
+ * @param parser target parser (kept constant)
+ * @param context arbitrary pointer passed to the lexer, actions and error callback
+ * @param parsing_table uint32_t matrix, CompressedTable or SplitTable depending on parser->table_format
+ * @param buffers token, value and stack buffers used during parsing
+ * @param lexer lexer instance passed to ll_next, only used by the helper thread
+ * @param ll_next get the next token from the lexer
+ * @return index in token/value table where the parsed value resides
+ */
+int32_t parser_parse_lr_pipelined(const GrammarParser* parser,
+                                  void* context,
+                                  const void* parsing_table,
+                                  ParserBuffers* buffers,
+                                  void* lexer,
+                                  int ll_next(void*, void*, void*));
+
+/**
+ * Run a batch of independent jobs on a pool of threads. Every worker
+ * starts with an even share of the jobs and steals half of the largest
+ * share left once it is through with its own.
+ * The calling thread is one of the workers.
+ * @param n number of jobs, job is called once for every index in [0, n)
+ * @param thread_n number of workers, 0 for one per online CPU
+ * @param shared arbitrary pointer passed to every callback
+ * @param worker_new create the state owned by a single worker (buffers, lexer)
+ * @param worker_free free the state of a worker once the batch is done
+ * @param job run a single job with the state of the worker running it
+ */
+void parser_run_batch(uint32_t n,
+                      uint32_t thread_n,
+                      void* shared,
+                      parser_worker_new worker_new,
+                      parser_worker_free worker_free,
+                      parser_worker_job job);
+
+/**
+ * Create the tree kept between the parses of an incremental parse
+ * @return tree to free with parser_tree_free()
+ */
+NeoastTree* parser_tree_new(void);
+void parser_tree_free(NeoastTree* self);
+
+/**
+ * Record an edit of the text the tree was parsed from. Edits
+ * may be stacked up, each one is in offsets of the text after
+ * the edits before it.
+ * @param self tree of the last parse
+ * @param offset offset of the edit
+ * @param old_len bytes that were replaced
+ * @param new_len bytes that replaced them
+ */
+void parser_tree_edit(NeoastTree* self, uint32_t offset, uint32_t old_len, uint32_t new_len);
+
+/**
+ * Count the tokens the last parse had to lex, the
+ * rest of the text was covered by reused subtrees
+ * @param self tree of the last parse
+ * @return number of tokens lexed, including the end of the input
+ */
+uint32_t parser_tree_lexed(const NeoastTree* self);
+
+/**
+ * Run the LR parsing algorithm on a text the tree was parsed from
+ * before the edits recorded since. Subtrees that don't depend on
+ * the edits are shifted whole if the parser is in the state they
+ * were shifted in last time, only the edited region is lexed again.
+ *
+ * Reused values are shared with the last parse: actions must not
+ * change the values of their arguments and every value has to stay
+ * valid as long as the tree. The arena is only reset by a parse from
+ * scratch, the tree is dropped for one once the edits allocated as
+ * much again as the last one did. The lexer must not have lexing states.
+ * If the parse fails, the tree and the edits are kept.
+ * @param parser target parser (kept constant)
+ * @param context arbitrary pointer passed to the lexer, actions and error callback
+ * @param parsing_table uint32_t matrix, CompressedTable or SplitTable depending on parser->table_format
+ * @param buffers token, value and stack buffers used during parsing
+ * @param tree tree of the last parse, updated on success
+ * @param input whole text to parse
+ * @param input_len length of the text
+ * @param lexer NeoastMatcher on an input from input_new_from_buffer()
+ * @param ll_next get the next token from the lexer
+ * @return index in token/value table where the parsed value resides
+ */
+int32_t parser_parse_lr_incremental(const GrammarParser* parser,
+                                    void* context,
+                                    const void* parsing_table,
+                                    ParserBuffers* buffers,
+                                    NeoastTree* tree,
+                                    const char* input,
+                                    uint32_t input_len,
+                                    void* lexer,
+                                    int ll_next(void*, void*, void*));
+
+/**
+ * Report a syntax error through the parser's error callback
+ * or to stderr if the parser has none
+ * @param self parser that ran into the error
+ * @param err_ctx arbitrary pointer passed to the error callback
+ * @param parsing_table table used to list the expected tokens
+ * @param p position of the unexpected token, NULL if positions are not tracked
+ * @param lines index of the text to locate p in (may be NULL)
+ * @param states states on the parsing stack, the current one last
+ * @param state_n number of states on the stack
+ * @param stride distance between two states in the states array
+ * @param error_tok unexpected token
+ * @param prev_tok token right before the unexpected one
+ */
+void parser_syntax_error(const GrammarParser* self,
+                         void* err_ctx,
+                         const void* parsing_table,
+                         const TokenPosition* p,
+                         NeoastLines* lines,
+                         const uint32_t* states,
+                         uint32_t state_n,
+                         uint32_t stride,
+                         uint32_t error_tok,
+                         uint32_t prev_tok);
+
+/**
+ * Get the value slot the next pushed token should be written to
+ * @param buffers buffers of the push parse
+ * @return pointer to a value of size buffers->val_s
+ */
+void* parser_push_value(const ParserBuffers* buffers);
+
+/**
+ * Push a single token into an LR parse. The parse is resumed
+ * from the state stored in the buffers and runs until the next
+ * token is needed. Write the token's value to parser_push_value()
+ * before calling this.
+ *
+ * Once the parse is accepted or fails, the buffers are reset
+ * so that the next push starts a new parse.
+ * @param parser target parser (kept constant)
+ * @param context arbitrary pointer passed to the actions and error callback
+ * @param parsing_table uint32_t matrix, CompressedTable or SplitTable depending on parser->table_format
+ * @param buffers token, value and stack buffers holding the parse state
+ * @param tok token to push, 0 for end of input and negative for a lexing error
+ * @return NEOAST_PUSH_NEED_MORE, NEOAST_PUSH_ACCEPT or NEOAST_PUSH_ERROR
+ */
+push_status_t parser_push_token(const GrammarParser* parser,
+                                void* context,
+                                const void* parsing_table,
+                                ParserBuffers* buffers,
+                                int32_t tok);
 #endif
 
 #ifdef __cplusplus
@@ -0,0 +1,146 @@
+/*
+ * This file is part of the Neoast framework
+ * Copyright (c) 2021 Andrei Tumbar.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <stdlib.h>
+#include <neoast.h>
+
+// Every allocation is aligned for any type
+#define NEOAST_ARENA_ALIGN (16)
+#define NEOAST_ARENA_BLOCK_S (64 * 1024)
+
+typedef struct NeoastArenaBlock_prv NeoastArenaBlock;
+
+struct NeoastArenaBlock_prv
+{
+    NeoastArenaBlock* next;
+    size_t size;
+    size_t used;
+    char data[] __attribute__((aligned(NEOAST_ARENA_ALIGN)));
+};
+
+struct NeoastArena_prv
+{
+    NeoastArenaBlock* head;
+    NeoastArenaBlock* current;
+};
+
+NeoastArena* neoast_arena_new(void)
+{
+    NeoastArena* self = malloc(sizeof(NeoastArena));
+    self->head = NULL;
+    self->current = NULL;
+    return self;
+}
+
+static NeoastArenaBlock* arena_block_new(size_t size)
+{
+    NeoastArenaBlock* block = malloc(sizeof(NeoastArenaBlock) + size);
+    if (!block)
+    {
+        return NULL;
+    }
+
+    block->next = NULL;
+    block->size = size;
+    block->used = 0;
+    return block;
+}
+
+void* neoast_arena_alloc(NeoastArena* self, size_t size)
+{
+    size = (size + NEOAST_ARENA_ALIGN - 1) & ~(size_t) (NEOAST_ARENA_ALIGN - 1);
+
+    NeoastArenaBlock* block = self->current;
+    if (block && block->used + size <= block->size)
+    {
+        void* out = block->data + block->used;
+        block->used += size;
+        return out;
+    }
+
+    // Blocks kept from before the last reset are used first
+    if (block && block->next && size <= block->next->size)
+    {
+        block = block->next;
+        block->used = 0;
+    }
+    else
+    {
+        NeoastArenaBlock* next = arena_block_new(size > NEOAST_ARENA_BLOCK_S ? size : NEOAST_ARENA_BLOCK_S);
+        if (!next)
+        {
+            return NULL;
+        }
+
+        if (block)
+        {
+            next->next = block->next;
+            block->next = next;
+        }
+        else
+        {
+            next->next = self->head;
+            self->head = next;
+        }
+
+        block = next;
+    }
+
+    self->current = block;
+    block->used = size;
+    return block->data;
+}
+
+void neoast_arena_reset(NeoastArena* self)
+{
+    // Keep the blocks around for the next parse
+    self->current = self->head;
+    if (self->head)
+    {
+        self->head->used = 0;
+    }
+}
+
+size_t neoast_arena_used(const NeoastArena* self)
+{
+    // Blocks past the current one are left from before the last reset
+    size_t used = 0;
+    for (const NeoastArenaBlock* block = self->head; block; block = block->next)
+    {
+        used += block->used;
+        if (block == self->current)
+        {
+            break;
+        }
+    }
+
+    return used;
+}
+
+void neoast_arena_free(NeoastArena* self)
+{
+    NeoastArenaBlock* block = self->head;
+    while (block)
+    {
+        NeoastArenaBlock* next = block->next;
+        free(block);
+        block = next;
+    }
+
+    free(self);
+}
@@ -0,0 +1,204 @@
+/*
+ * This file is part of the Neoast framework
+ * Copyright (c) 2021 Andrei Tumbar.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <stdlib.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <neoast.h>
+
+#define NEOAST_CACHE_LINE (64)
+
+// A range of jobs packed as (end << 32 | next) so that
+// the owner and thieves can update it with a single CAS
+#define RANGE(next, end) (((uint64_t) (end) << 32) | (uint32_t) (next))
+#define RANGE_NEXT(r) ((uint32_t) (r))
+#define RANGE_END(r) ((uint32_t) ((r) >> 32))
+
+typedef struct NeoastBatchWorker_prv NeoastBatchWorker;
+typedef struct NeoastBatch_prv NeoastBatch;
+
+struct NeoastBatchWorker_prv
+{
+    uint64_t range __attribute__((aligned(NEOAST_CACHE_LINE)));
+    NeoastBatch* batch;
+};
+
+struct NeoastBatch_prv
+{
+    void* shared;
+    parser_worker_new worker_new;
+    parser_worker_free worker_free;
+    parser_worker_job job;
+    uint32_t worker_n;
+    NeoastBatchWorker* workers;
+};
+
+/**
+ * Take the next job from the front of our own range
+ * @return 0 if a job was taken, -1 if the range is empty
+ */
+static int batch_pop(NeoastBatchWorker* self, uint32_t* i)
+{
+    uint64_t range = __atomic_load_n(&self->range, __ATOMIC_ACQUIRE);
+    while (RANGE_NEXT(range) < RANGE_END(range))
+    {
+        if (__atomic_compare_exchange_n(&self->range, &range,
+                                        RANGE(RANGE_NEXT(range) + 1, RANGE_END(range)),
+                                        1, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+        {
+            *i = RANGE_NEXT(range);
+            return 0;
+        }
+    }
+
+    return -1;
+}
+
+/**
+ * Steal the back half of the largest range left in the pool
+ * @return 0 if our range was refilled, -1 if there is no work left
+ */
+static int batch_steal(NeoastBatchWorker* self)
+{
+    NeoastBatch* batch = self->batch;
+    while (1)
+    {
+        NeoastBatchWorker* victim = NULL;
+        uint64_t victim_range = 0;
+        uint32_t victim_left = 0;
+        for (uint32_t k = 0; k < batch->worker_n; k++)
+        {
+            uint64_t range = __atomic_load_n(&batch->workers[k].range, __ATOMIC_ACQUIRE);
+            uint32_t left = RANGE_END(range) - RANGE_NEXT(range);
+            if (RANGE_NEXT(range) < RANGE_END(range) && left > victim_left)
+            {
+                victim = &batch->workers[k];
+                victim_range = range;
+                victim_left = left;
+            }
+        }
+
+        if (!victim)
+        {
+            return -1;
+        }
+
+        uint32_t split = RANGE_END(victim_range) - (victim_left + 1) / 2;
+        if (__atomic_compare_exchange_n(&victim->range, &victim_range,
+                                        RANGE(RANGE_NEXT(victim_range), split),
+                                        0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+        {
+            __atomic_store_n(&self->range, RANGE(split, RANGE_END(victim_range)), __ATOMIC_RELEASE);
+            return 0;
+        }
+    }
+}
+
+static void* batch_run(void* self_)
+{
+    NeoastBatchWorker* self = self_;
+    NeoastBatch* batch = self->batch;
+    void* worker = batch->worker_new(batch->shared);
+
+    do
+    {
+        uint32_t i;
+        while (batch_pop(self, &i) == 0)
+        {
+            batch->job(batch->shared, worker, i);
+        }
+    } while (batch_steal(self) == 0);
+
+    batch->worker_free(worker);
+    return NULL;
+}
+
+void parser_run_batch(uint32_t n,
+                      uint32_t thread_n,
+                      void* shared,
+                      parser_worker_new worker_new,
+                      parser_worker_free worker_free,
+                      parser_worker_job job)
+{
+    if (thread_n == 0)
+    {
+        long cpu_n = sysconf(_SC_NPROCESSORS_ONLN);
+        thread_n = cpu_n > 0 ? (uint32_t) cpu_n : 1;
+    }
+
+    if (thread_n > n)
+    {
+        thread_n = n ? n : 1;
+    }
+
+    NeoastBatch batch = {
+            .shared = shared,
+            .worker_new = worker_new,
+            .worker_free = worker_free,
+            .job = job,
+            .worker_n = thread_n,
+    };
+
+    NeoastBatchWorker* workers = NULL;
+    if (posix_memalign((void**) &workers, NEOAST_CACHE_LINE, sizeof(NeoastBatchWorker) * thread_n) != 0)
+    {
+        workers = NULL;
+    }
+
+    pthread_t* threads = malloc(sizeof(pthread_t) * thread_n);
+    if (!workers || !threads)
+    {
+        // Run everything on this thread
+        NeoastBatchWorker single = {.range = RANGE(0, n), .batch = &batch};
+        batch.worker_n = 1;
+        batch.workers = &single;
+        batch_run(&single);
+        free(workers);
+        free(threads);
+        return;
+    }
+
+    // Split the jobs evenly, workers steal from
+    // each other once they are through their share
+    batch.workers = workers;
+    for (uint32_t k = 0; k < thread_n; k++)
+    {
+        workers[k].range = RANGE((uint64_t) n * k / thread_n, (uint64_t) n * (k + 1) / thread_n);
+        workers[k].batch = &batch;
+    }
+
+    // The calling thread is the first worker. The share of a
+    // thread that fails to start is stolen by the others.
+    uint32_t started = 0;
+    for (uint32_t k = 1; k < thread_n; k++)
+    {
+        if (pthread_create(&threads[started], NULL, batch_run, &workers[k]) == 0)
+        {
+            started++;
+        }
+    }
+
+    batch_run(&workers[0]);
+    for (uint32_t k = 0; k < started; k++)
+    {
+        pthread_join(threads[k], NULL);
+    }
+
+    free(workers);
+    free(threads);
+}
@@ -1176,15 +1176,14 @@ static int neoast_lexer_next(NeoastMatcher* self__, NeoastValue* destination__,
         {
             size_t neoast_tok___ = matcher_scan(self__, LEX_STATE_DEFAULT_FSM);
             const char* yytext = matcher_text(self__);
-            yyposition->line = matcher_lineno(self__);
-            yyposition->col = matcher_columno(self__);
+            yyposition->offset = matcher_offset(self__) - matcher_size(self__);
             yyposition->len = matcher_size(self__);
 
             switch(neoast_tok___)
             {
             default:
             case 0:
-                if (!matcher_at_end(self__)) { lexing_error_cb(yycontext, yytext, yyposition, "LEX_STATE_DEFAULT"); return -1; }
+                if (!matcher_at_end(self__)) { lexing_error_cb(yycontext, yytext, yyposition, self__->lines, "LEX_STATE_DEFAULT"); return -1; }
                 else return 0;
             case 1:
  {  }
@@ -1279,15 +1278,14 @@ static int neoast_lexer_next(NeoastMatcher* self__, NeoastValue* destination__,
         {
             size_t neoast_tok___ = matcher_scan(self__, S_LL_RULES_FSM);
             const char* yytext = matcher_text(self__);
-            yyposition->line = matcher_lineno(self__);
-            yyposition->col = matcher_columno(self__);
+            yyposition->offset = matcher_offset(self__) - matcher_size(self__);
             yyposition->len = matcher_size(self__);
 
             switch(neoast_tok___)
             {
             default:
             case 0:
-                if (!matcher_at_end(self__)) { lexing_error_cb(yycontext, yytext, yyposition, "S_LL_RULES"); return -1; }
+                if (!matcher_at_end(self__)) { lexing_error_cb(yycontext, yytext, yyposition, self__->lines, "S_LL_RULES"); return -1; }
                 else return 0;
             case 1:
  {  }
@@ -1328,15 +1326,14 @@ static int neoast_lexer_next(NeoastMatcher* self__, NeoastValue* destination__,
         {
             size_t neoast_tok___ = matcher_scan(self__, S_LL_STATE_FSM);
             const char* yytext = matcher_text(self__);
-            yyposition->line = matcher_lineno(self__);
-            yyposition->col = matcher_columno(self__);
+            yyposition->offset = matcher_offset(self__) - matcher_size(self__);
             yyposition->len = matcher_size(self__);
 
             switch(neoast_tok___)
             {
             default:
             case 0:
-                if (!matcher_at_end(self__)) { lexing_error_cb(yycontext, yytext, yyposition, "S_LL_STATE"); return -1; }
+                if (!matcher_at_end(self__)) { lexing_error_cb(yycontext, yytext, yyposition, self__->lines, "S_LL_STATE"); return -1; }
                 else return 0;
             case 1:
  {  }
@@ -1364,15 +1361,14 @@ static int neoast_lexer_next(NeoastMatcher* self__, NeoastValue* destination__,
         {
             size_t neoast_tok___ = matcher_scan(self__, S_GG_RULES_FSM);
             const char* yytext = matcher_text(self__);
-            yyposition->line = matcher_lineno(self__);
-            yyposition->col = matcher_columno(self__);
+            yyposition->offset = matcher_offset(self__) - matcher_size(self__);
             yyposition->len = matcher_size(self__);
 
             switch(neoast_tok___)
             {
             default:
             case 0:
-                if (!matcher_at_end(self__)) { lexing_error_cb(yycontext, yytext, yyposition, "S_GG_RULES"); return -1; }
+                if (!matcher_at_end(self__)) { lexing_error_cb(yycontext, yytext, yyposition, self__->lines, "S_GG_RULES"); return -1; }
                 else return 0;
             case 1:
  {  }
@@ -1412,15 +1408,14 @@ static int neoast_lexer_next(NeoastMatcher* self__, NeoastValue* destination__,
         {
             size_t neoast_tok___ = matcher_scan(self__, S_MATCH_BRACE_FSM);
             const char* yytext = matcher_text(self__);
-            yyposition->line = matcher_lineno(self__);
-            yyposition->col = matcher_columno(self__);
+            yyposition->offset = matcher_offset(self__) - matcher_size(self__);
             yyposition->len = matcher_size(self__);
 
             switch(neoast_tok___)
             {
             default:
             case 0:
-                if (!matcher_at_end(self__)) { lexing_error_cb(yycontext, yytext, yyposition, "S_MATCH_BRACE"); return -1; }
+                if (!matcher_at_end(self__)) { lexing_error_cb(yycontext, yytext, yyposition, self__->lines, "S_MATCH_BRACE"); return -1; }
                 else return 0;
             case 1:
  { yypush(S_COMMENT); }
@@ -1471,15 +1466,14 @@ static int neoast_lexer_next(NeoastMatcher* self__, NeoastValue* destination__,
         {
             size_t neoast_tok___ = matcher_scan(self__, S_COMMENT_FSM);
             const char* yytext = matcher_text(self__);
-            yyposition->line = matcher_lineno(self__);
-            yyposition->col = matcher_columno(self__);
+            yyposition->offset = matcher_offset(self__) - matcher_size(self__);
             yyposition->len = matcher_size(self__);
 
             switch(neoast_tok___)
             {
             default:
             case 0:
-                if (!matcher_at_end(self__)) { lexing_error_cb(yycontext, yytext, yyposition, "S_COMMENT"); return -1; }
+                if (!matcher_at_end(self__)) { lexing_error_cb(yycontext, yytext, yyposition, self__->lines, "S_COMMENT"); return -1; }
                 else return 0;
             case 1:
  {  }
@@ -0,0 +1,342 @@
+/*
+ * This file is part of the Neoast framework
+ * Copyright (c) 2021 Andrei Tumbar.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cassert>
+#include <map>
+#include <set>
+#include <util/util.h>
+#include "cg_direct.h"
+
+static std::string token_comment(const GrammarParser* parser, uint32_t tok)
+{
+    if (!parser->token_names || !parser->token_names[tok])
+    {
+        return "";
+    }
+
+    // Token names may hold any ascii character, don't
+    // let them close the comment early
+    std::string name = parser->token_names[tok];
+    for (size_t i = name.find("*/"); i != std::string::npos; i = name.find("*/", i))
+    {
+        name.replace(i, 2, "* /");
+    }
+
+    return " /* " + name + " */";
+}
+
+static void put_state(std::ostream &os,
+                      const GrammarParser* parser,
+                      const uint32_t* row,
+                      uint32_t state,
+                      uint32_t default_reduction,
+                      std::set<uint32_t> &reduced_rules)
+{
+    os << variadic_string("neoast_S%d:\n", state)
+       << variadic_string("    if (sp__ + 2 > capacity__) { resume__ = &&neoast_S%d; goto neoast_grow__; }\n", state)
+       << variadic_string("    states__[sp__] = %d;\n", state)
+       << "    NEOAST_STAT(parser_stats_max(&buffers__->stats.max_depth, sp__));\n";
+
+    if (default_reduction & TOK_REDUCE_MASK)
+    {
+        // Consistent state, the lookahead is not needed
+        reduced_rules.insert(default_reduction & TOK_MASK);
+        os << variadic_string("    goto neoast_R%d;\n\n", default_reduction & TOK_MASK);
+        return;
+    }
+
+    // Group the tokens with the same action
+    std::map<uint32_t, std::vector<uint32_t>> actions;
+    for (uint32_t tok = 0; tok < parser->action_token_n; tok++)
+    {
+        if (row[tok] != TOK_SYNTAX_ERROR)
+        {
+            actions[row[tok]].push_back(tok);
+        }
+    }
+
+    os << "    NEOAST_LOOKAHEAD__();\n"
+          "    switch (tok__)\n"
+          "    {\n";
+    for (const auto &action : actions)
+    {
+        for (uint32_t tok : action.second)
+        {
+            os << variadic_string("        case %d:", tok) << token_comment(parser, tok) << "\n";
+        }
+
+        if (action.first & TOK_SHIFT_MASK)
+        {
+            os << "            sp__++;\n"
+                  "            has_lookahead__ = 0;\n"
+                  "            NEOAST_STAT(buffers__->stats.shifts++);\n"
+               << variadic_string("            goto neoast_S%d;\n", action.first & TOK_MASK);
+        }
+        else if (action.first & TOK_ACCEPT_MASK)
+        {
+            os << "            goto neoast_accept__;\n";
+        }
+        else
+        {
+            assert(action.first & TOK_REDUCE_MASK);
+            reduced_rules.insert(action.first & TOK_MASK);
+            os << variadic_string("            goto neoast_R%d;\n", action.first & TOK_MASK);
+        }
+    }
+
+    os << "        default:\n"
+       << variadic_string("            state__ = %d;\n", state)
+       << "            goto neoast_syntax_error__;\n"
+          "    }\n\n";
+}
+
+static void put_reduction(std::ostream &os,
+                          const std::string &struct_name,
+                          const GrammarParser* parser,
+                          uint32_t rule_id,
+                          const std::string &action,
+                          const std::map<uint32_t, uint32_t> &goto_targets,
+                          bool track_position)
+{
+    const GrammarRule* rule = &parser->grammar_rules[rule_id];
+    uint32_t result_token = rule->token - NEOAST_ASCII_MAX;
+    uint32_t n = rule->tok_n;
+
+    os << variadic_string("neoast_R%d:", rule_id) << token_comment(parser, result_token) << "\n"
+       << variadic_string("    NEOAST_STAT(parser_stats_reduce(&buffers__->stats, %d));\n", rule_id);
+    if (n)
+    {
+        os << variadic_string("    sp__ -= %d;\n", n);
+    }
+
+    os << "    {\n";
+    if (n == 0)
+    {
+        // The result goes in the lookahead's slot
+        os << "        if (has_lookahead__)\n"
+              "        {\n"
+              "            values__[sp__ + 1] = values__[sp__];\n"
+              "            tokens__[sp__ + 1] = tokens__[sp__];\n"
+              "            NEOAST_STAT(parser_stats_max(&buffers__->stats.max_token_index, sp__ + 1));\n"
+              "        }\n";
+
+        if (!action.empty())
+        {
+            os << "        " << struct_name << "* dest__ = &values__[sp__];\n"
+               << "        " << struct_name << "* args__ = dest__;\n"
+               << "        (void) args__;\n"
+               << action;
+        }
+
+        if (track_position)
+        {
+            // No positional data available
+            os << "        memset((char*) &values__[sp__] + buffers__->union_s, 0,\n"
+                  "               buffers__->val_s - buffers__->union_s);\n";
+        }
+    }
+    else
+    {
+        if (!action.empty())
+        {
+            // Actions may still read the arguments after writing the result
+            os << "        " << struct_name << "* args__ = &values__[sp__];\n"
+               << "        " << struct_name << " dest_val__;\n"
+               << "        " << struct_name << "* dest__ = &dest_val__;\n"
+               << action
+               << "        values__[sp__].value = dest_val__.value;\n";
+        }
+
+        if (n != 1)
+        {
+            os << "        if (has_lookahead__)\n"
+                  "        {\n"
+               << variadic_string("            values__[sp__ + 1] = values__[sp__ + %d];\n", n)
+               << variadic_string("            tokens__[sp__ + 1] = tokens__[sp__ + %d];\n", n)
+               << "        }\n";
+        }
+    }
+
+    os << "    }\n"
+       << variadic_string("    tokens__[sp__] = %d;\n", result_token)
+       << "    sp__++;\n";
+
+    std::set<uint32_t> targets;
+    for (const auto &iter : goto_targets)
+    {
+        targets.insert(iter.second);
+    }
+
+    if (targets.size() == 1)
+    {
+        os << variadic_string("    goto neoast_S%d;\n\n", *targets.begin());
+    }
+    else
+    {
+        os << variadic_string("    goto *neoast_goto_%d__[states__[sp__ - 1]];\n\n", result_token);
+    }
+}
+
+void cg_direct_put_parser(
+        std::ostream &os,
+        const std::string &func_name,
+        const std::string &struct_name,
+        const std::string &ll_next,
+        const GrammarParser* parser,
+        const uint32_t* parsing_table,
+        uint32_t state_n,
+        const uint32_t* default_reductions,
+        const std::vector<std::string> &actions,
+        bool track_position)
+{
+    // Gotos of every nonterminal: state -> next state
+    std::map<uint32_t, std::map<uint32_t, uint32_t>> gotos;
+    for (uint32_t state = 0; state < state_n; state++)
+    {
+        const uint32_t* row = &parsing_table[state * parser->token_n];
+        for (uint32_t tok = parser->action_token_n; tok < parser->token_n; tok++)
+        {
+            if (row[tok] & TOK_SHIFT_MASK)
+            {
+                gotos[tok][state] = row[tok] & TOK_MASK;
+            }
+        }
+    }
+
+    os << "static int32_t " << func_name << "(const GrammarParser* parser__, void* context__,\n"
+       << "        const void* parsing_table__, ParserBuffers* buffers__, void* lexer__)\n"
+          "{\n"
+          "#define yycontext (context__)\n"
+          "#define yyalloc(size) neoast_arena_alloc(buffers__->arena, (size))\n"
+          "#define yylocate(position, location) neoast_lines_locate(buffers__->lines, (position)->offset, (location))\n"
+          "#define NEOAST_LOOKAHEAD__() \\\n"
+          "    if (!has_lookahead__) \\\n"
+          "    { \\\n"
+       << "        tok__ = " << ll_next << "(lexer__, &values__[sp__], context__); \\\n"
+       << "        if (tok__ < 0) goto neoast_lex_error__; \\\n"
+          "        tokens__[sp__] = tok__; \\\n"
+          "        has_lookahead__ = 1; \\\n"
+          "        NEOAST_STAT(buffers__->stats.tokens++); \\\n"
+          "        NEOAST_STAT(parser_stats_max(&buffers__->stats.max_token_index, sp__)); \\\n"
+          "    }\n\n"
+       << "    " << struct_name << "* values__ = (" << struct_name << "*) buffers__->value_table;\n"
+       << "    int32_t* tokens__ = buffers__->token_table;\n"
+          "    uint32_t* states__ = buffers__->parsing_stack->data;\n"
+          "    uint32_t capacity__ = buffers__->table_n < buffers__->stack_n ? buffers__->table_n : buffers__->stack_n;\n"
+          "    uint32_t sp__ = 0; // number of values on the stack, the lookahead goes right above\n"
+          "    uint32_t state__ = 0;\n"
+          "    int32_t tok__ = 0;\n"
+          "    uint32_t has_lookahead__ = 0;\n"
+          "    void* resume__;\n\n";
+
+    // Computed gotos for nonterminals that lead to more than one state
+    for (const auto &iter : gotos)
+    {
+        std::set<uint32_t> targets;
+        for (const auto &target : iter.second)
+        {
+            targets.insert(target.second);
+        }
+
+        if (targets.size() < 2)
+        {
+            continue;
+        }
+
+        os << "    static const void* const neoast_goto_" << iter.first << "__[] = {"
+           << token_comment(parser, iter.first) << "\n";
+        for (uint32_t state = 0; state < state_n; state++)
+        {
+            auto target = iter.second.find(state);
+            if (state % 4 == 0) os << "           ";
+            if (target == iter.second.end())
+            {
+                os << " &&neoast_error__,";
+            }
+            else
+            {
+                os << variadic_string(" &&neoast_S%d,", target->second);
+            }
+            if (state % 4 == 3 || state + 1 == state_n) os << "\n";
+        }
+        os << "    };\n";
+    }
+
+    os << "\n    // Values of the last parse are gone\n"
+          "    neoast_arena_reset(buffers__->arena);\n"
+          "    goto neoast_S0;\n\n";
+
+    std::set<uint32_t> reduced_rules;
+    for (uint32_t state = 0; state < state_n; state++)
+    {
+        put_state(os, parser, &parsing_table[state * parser->token_n], state,
+                  default_reductions ? default_reductions[state] : TOK_SYNTAX_ERROR,
+                  reduced_rules);
+    }
+
+    for (uint32_t rule_id : reduced_rules)
+    {
+        uint32_t result_token = parser->grammar_rules[rule_id].token - NEOAST_ASCII_MAX;
+        put_reduction(os, struct_name, parser, rule_id, actions[rule_id], gotos[result_token],
+                      track_position);
+    }
+
+    os << "neoast_accept__:\n"
+          "    // The start symbol is the only value left on the stack\n"
+          "    return 0;\n\n"
+          "neoast_grow__:\n"
+          "    if (parser_grow_buffers(buffers__, sp__ + 2, sp__ + 2) != 0)\n"
+          "    {\n"
+          "        fprintf(stderr, \"Parser buffers exhausted: %u tokens, %u stack entries\\n\",\n"
+          "                buffers__->table_n, buffers__->stack_n);\n"
+          "        goto neoast_error__;\n"
+          "    }\n"
+       << "    values__ = (" << struct_name << "*) buffers__->value_table;\n"
+       << "    tokens__ = buffers__->token_table;\n"
+          "    states__ = buffers__->parsing_stack->data;\n"
+          "    capacity__ = buffers__->table_n < buffers__->stack_n ? buffers__->table_n : buffers__->stack_n;\n"
+          "    goto *resume__;\n\n"
+          "neoast_lex_error__:\n"
+          "    has_lookahead__ = 0;\n"
+          "    goto neoast_error__;\n\n"
+          "neoast_syntax_error__:\n"
+          "    parser_syntax_error(parser__, context__, parsing_table__,\n"
+       << (track_position
+           ? "                        (const TokenPosition*) ((char*) &values__[sp__] + buffers__->union_s),\n"
+           : "                        NULL,\n")
+       << "                        buffers__->lines,\n"
+          "                        states__, sp__ + 1, 1, tok__, sp__ ? tokens__[sp__ - 1] : 0);\n\n"
+          "neoast_error__:\n"
+          "    // Free the values on the stack and the lookahead\n"
+          "    if (parser__->destructors)\n"
+          "    {\n"
+          "        for (uint32_t i__ = 0; i__ < sp__ + has_lookahead__; i__++)\n"
+          "        {\n"
+          "            uint32_t t__ = tokens__[i__];\n"
+          "            if (t__ < parser__->token_n && parser__->destructors[t__])\n"
+          "            {\n"
+          "                parser__->destructors[t__](&values__[i__]);\n"
+          "            }\n"
+          "        }\n"
+          "    }\n"
+          "    return -1;\n"
+          "#undef NEOAST_LOOKAHEAD__\n"
+          "#undef yylocate\n"
+          "#undef yyalloc\n"
+          "#undef yycontext\n"
+          "}\n";
+}
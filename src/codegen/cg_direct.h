@@ -0,0 +1,63 @@
+/*
+ * This file is part of the Neoast framework
+ * Copyright (c) 2021 Andrei Tumbar.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef NEOAST_CG_DIRECT_H
+#define NEOAST_CG_DIRECT_H
+
+#include <ostream>
+#include <string>
+#include <vector>
+#include <neoast.h>
+
+/**
+ * Generate a direct-coded LR parser. Every state becomes a label
+ * that switches on the lookahead and jumps straight to the next
+ * state or to the inlined action of the rule it reduces. Gotos
+ * after a reduction are computed gotos through per-nonterminal
+ * label tables.
+ *
+ * The generated function has the signature:
+ *   int32_t func_name(const GrammarParser* parser, void* context,
+ *                     const void* parsing_table, ParserBuffers* buffers,
+ *                     void* lexer)
+ * and behaves like parser_parse_lr(). The parser and parsing
+ * table are only used to run destructors and report errors.
+ *
+ * @param os output stream to dump to
+ * @param func_name name of the generated function
+ * @param struct_name type of the values in the value table
+ * @param ll_next lexer function to call for the next token
+ * @param parser grammar rules and token counts
+ * @param parsing_table dense table generated by CanonicalCollection::generate
+ * @param state_n number of states (rows) in the table
+ * @param default_reductions default reductions per state or null
+ * @param actions expanded action code of each rule (empty for the default action)
+ * @param track_position whether the values hold a position after the union
+ */
+void cg_direct_put_parser(
+        std::ostream &os,
+        const std::string &func_name,
+        const std::string &struct_name,
+        const std::string &ll_next,
+        const GrammarParser* parser,
+        const uint32_t* parsing_table,
+        uint32_t state_n,
+        const uint32_t* default_reductions,
+        const std::vector<std::string> &actions,
+        bool track_position);
+
+#endif //NEOAST_CG_DIRECT_H
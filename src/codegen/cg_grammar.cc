@@ -79,6 +79,16 @@ struct CGGrammar
            << "            break;\n";
     }
 
+    std::string get_action(const Options& options) const
+    {
+        if (action.empty())
+        {
+            return "";
+        }
+
+        return action.get_complex(options, argument_types, "dest__", "args__", false);
+    }
+
     void put_grammar_entry(std::ostream& os) const
     {
         for (struct Token* tok = parent->tokens; tok; tok = tok->next)
@@ -254,8 +264,11 @@ void CGGrammars::put_rules(std::ostream &os) const
 void CGGrammars::put_actions(std::ostream &os) const
 {
     int gg_i = 0;
-    os << variadic_string("static void neoast_reduce_handler(uint32_t reduce_id__, %s* dest__, %s* args__, void* context__)\n"
-                          "{\n#define yycontext (context__)\n",
+    os << variadic_string("static void neoast_reduce_handler(uint32_t reduce_id__, %s* dest__, %s* args__,\n"
+                          "                                 void* context__, NeoastArena* arena__, NeoastLines* lines__)\n"
+                          "{\n#define yycontext (context__)\n"
+                          "#define yyalloc(size) neoast_arena_alloc(arena__, (size))\n"
+                          "#define yylocate(position, location) neoast_lines_locate(lines__, (position)->offset, (location))\n",
                           CODEGEN_STRUCT, CODEGEN_STRUCT)
        << "    switch(reduce_id__)\n    {\n";
     for (const auto &rules : impl_->rules_cg)
@@ -267,7 +280,22 @@ void CGGrammars::put_actions(std::ostream &os) const
     }
     os << "    default:\n"
           "        *dest__ = args__[0];\n"
-          "        break;\n    }\n#undef yycontext\n}\n";
+          "        break;\n    }\n#undef yylocate\n#undef yyalloc\n#undef yycontext\n}\n";
+}
+
+std::vector<std::string> CGGrammars::get_actions(const Options &options) const
+{
+    std::vector<std::string> actions;
+    actions.reserve(size());
+    for (const auto &rules : impl_->rules_cg)
+    {
+        for (const auto &rule : rules.second)
+        {
+            actions.push_back(rule.get_action(options));
+        }
+    }
+
+    return actions;
 }
 
 uint32_t CGGrammars::size() const
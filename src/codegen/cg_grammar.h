@@ -20,6 +20,13 @@ public:
     void put_rules(std::ostream &os) const;
     void put_actions(std::ostream &os) const;
 
+    /**
+     * Expand the action of every rule
+     * @param options options to expand the actions with
+     * @return action code indexed by reduce id, empty for the default action
+     */
+    std::vector<std::string> get_actions(const Options &options) const;
+
     uint32_t size() const;
     GrammarRule* get() const;
     const TokenPosition** get_positions() const;
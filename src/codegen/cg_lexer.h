@@ -6,21 +6,22 @@
 class CGLexer
 {
     /**
-     * Subclasses must implement the global and init
-     * functions to paste into the codegen
+     * Subclasses must implement the global
+     * functions to paste into the codegen.
+     * Lexers may not keep any mutable global state,
+     * everything lives in the instance so that generated
+     * parsers can run on multiple threads.
      */
 public:
     virtual void put_top(std::ostream &os) const = 0;
     virtual void put_global(std::ostream &os) const = 0;
     virtual void put_bottom(std::ostream &os) const = 0;
 
-    virtual std::string get_init() const = 0;
-    virtual std::string get_delete() const = 0;
-
     /**
-     * Create and destroy parsing instances of the lexer
+     * Create, restart and destroy parsing instances of the lexer
      */
     virtual std::string get_new_inst(const std::string &name) const = 0;
+    virtual std::string get_reset_inst(const std::string &name) const = 0;
     virtual std::string get_del_inst(const std::string &name) const = 0;
     virtual std::string get_ll_next(const std::string &name) const = 0;
 };
@@ -15,7 +15,15 @@
  * along with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <set>
+#include <tuple>
 #include <reflex/convert.h>
+#include <reflex/matcher.h>
 #include "cg_neoast_lexer.h"
 #include "cg_pattern.h"
 
@@ -24,15 +32,100 @@
 
 struct CGNeoastLexerState;
 
+/**
+ * Find the only text a regular expression can match
+ * @param regex regular expression of a lexer rule
+ * @param literal text the rule matches
+ * @return true if the rule only matches plain characters, false
+ *         if it may match anything else (or we can't tell)
+ */
+static bool regex_literal(const char* regex, std::string &literal)
+{
+    literal.clear();
+    for (const char* c = regex; *c; c++)
+    {
+        if (*c == '\\')
+        {
+            c++;
+            if (*c == 'n') literal.push_back('\n');
+            else if (*c == 't') literal.push_back('\t');
+            else if (*c == 'r') literal.push_back('\r');
+            else if (*c && std::ispunct((unsigned char) *c)) literal.push_back(*c);
+            else return false;
+        }
+        else if (std::strchr(".^$|?*+()[]{}#\"/<>", *c) || std::isspace((unsigned char) *c)
+                 || !std::isprint((unsigned char) *c))
+        {
+            // Operators, freespace comments and whitespace, lex quotes
+            // and trailing contexts. Leave these to the DFA
+            return false;
+        }
+        else
+        {
+            literal.push_back(*c);
+        }
+    }
+
+    return !literal.empty();
+}
+
+/**
+ * Check if a regular expression matches the same no matter
+ * what comes before or after the match
+ * @param regex regular expression of a lexer rule
+ * @return false if the regex may have anchors, word boundaries,
+ *         indents or lookaheads
+ */
+static bool regex_context_free(const std::string &regex)
+{
+    bool in_bracket = false;
+    for (size_t i = 0; i < regex.size(); i++)
+    {
+        char c = regex[i];
+        if (c == '\\')
+        {
+            if (++i < regex.size() && !in_bracket && std::strchr("AbBzZ<>ijk`'", regex[i]))
+                return false;
+        }
+        else if (in_bracket)
+        {
+            in_bracket = c != ']';
+        }
+        else if (c == '[')
+        {
+            // A ']' right after the opening bracket is part of the set
+            in_bracket = true;
+            if (i + 1 < regex.size() && regex[i + 1] == '^') i++;
+            if (i + 1 < regex.size() && regex[i + 1] == ']') i++;
+        }
+        else if (c == '^' || c == '$' || c == '/' || (c == '(' && regex.compare(i, 3, "(?=") == 0)
+                 || (c == '(' && regex.compare(i, 3, "(?!") == 0)
+                 || (c == '(' && regex.compare(i, 3, "(?<") == 0))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
 struct CGNeoastLexerRule
 {
     Code code;
     std::string regex;
 
+    // Rules that only match a single string may be resolved from
+    // the text matched by a more general rule instead of the DFA
+    bool is_literal;
+    std::string literal;
+
+    size_t host;                           // Rule that matches the literal in the DFA, 0 if in the DFA
+    std::unique_ptr<reflex::Pattern> pattern;  // Compiled on demand to check literals against
+
     explicit CGNeoastLexerRule(
             const LexerRuleProto* iter,
             const MacroEngine &m_engine)
-            : code(iter->function, &iter->position)
+            : code(iter->function, &iter->position), is_literal(false), host(0)
     {
         try
         {
@@ -55,6 +148,32 @@ struct CGNeoastLexerRule
                        e.what(),
                        iter->regex);
         }
+
+        // Check the literal against the regex itself
+        is_literal = regex_literal(iter->regex, literal) && matches(literal);
+    }
+
+    bool matches(const std::string &text)
+    {
+        if (is_literal)
+        {
+            return text == literal;
+        }
+
+        try
+        {
+            if (!pattern)
+            {
+                pattern.reset(new reflex::Pattern("(?mx)(?:" + regex + ")"));
+            }
+
+            return reflex::Matcher(*pattern, text).matches() != 0;
+        }
+        catch (reflex::regex_error &e)
+        {
+            // Already reported
+            return false;
+        }
     }
 };
 
@@ -80,6 +199,66 @@ struct CGNeoastLexerState
         rules.emplace_back(iter_s, m_engine);
     }
 
+    /**
+     * Take literal rules (keywords, operators) out of the DFA when a
+     * later, more general rule like an identifier matches them too.
+     * The longest match can't change as the general rule matches the
+     * same text. When it matches the text of exactly one of its
+     * literals, the literal is looked up to run its action instead.
+     */
+    void fold_literals()
+    {
+        for (size_t i = 0; i < rules.size(); i++)
+        {
+            auto &rule = rules[i];
+            if (!rule.is_literal)
+            {
+                continue;
+            }
+
+            // Only the first rule to match the literal, the literal
+            // itself, may be removed from in front of the host
+            size_t host = 0;
+            for (size_t j = 0; j < rules.size(); j++)
+            {
+                if (j == i || !rules[j].matches(rule.literal))
+                {
+                    continue;
+                }
+
+                if (j > i && !rules[j].is_literal && regex_context_free(rules[j].regex))
+                {
+                    host = j + 1;
+                }
+                break;
+            }
+
+            rule.host = host;
+        }
+    }
+
+    /**
+     * @return Number of the rule (from 1) a DFA group (from 1) is for
+     */
+    std::vector<size_t> get_groups() const
+    {
+        std::vector<size_t> groups = {0};
+        for (size_t i = 0; i < rules.size(); i++)
+        {
+            if (!rules[i].host)
+            {
+                groups.push_back(i + 1);
+            }
+        }
+
+        return groups;
+    }
+
+    bool has_folded() const
+    {
+        return get_groups().size() < rules.size() + 1;
+    }
+
     const std::string &get_pattern()
     {
         // Only regenerate the regular expression if we need to
@@ -91,6 +270,12 @@ struct CGNeoastLexerState
             std::string split_s;
             for (const auto &rule: rules)
             {
+                // Folded literals are matched by their host rule
+                if (rule.host)
+                {
+                    continue;
+                }
+
                 ss << split_s << "((?:" << rule.regex << "))";
                 split_s = "|";
             }
@@ -105,16 +290,20 @@ struct CGNeoastLexerState
 struct CGNeoastLexerImpl
 {
     std::vector<CGNeoastLexerState> states;
+    std::vector<std::string> translated_tokens;
     const Options &options;
 
-    explicit CGNeoastLexerImpl(const Options &options) : options(options)
+    explicit CGNeoastLexerImpl(const Options &options,
+                               std::vector<std::string> translated_tokens)
+            : translated_tokens(std::move(translated_tokens)), options(options)
     {}
 };
 
 CGNeoastLexer::CGNeoastLexer(const File* self,
                              const MacroEngine &m_engine_,
-                             const Options &options)
-        : impl_(new CGNeoastLexerImpl(options))
+                             const Options &options,
+                             std::vector<std::string> translated_tokens)
+        : impl_(new CGNeoastLexerImpl(options, std::move(translated_tokens)))
 {
     impl_->states.emplace_back("LEX_STATE_DEFAULT");
 
@@ -160,6 +349,233 @@ CGNeoastLexer::CGNeoastLexer(const File* self,
             impl_->states[0].add_rule(iter, m_engine_);
         }
     }
+
+    if (options.fold_literals)
+    {
+        for (auto &state: impl_->states)
+        {
+            state.fold_literals();
+        }
+    }
+}
+
+static size_t literal_hash(const std::string &text, const uint32_t coefficients[3], size_t mask)
+{
+    auto s = reinterpret_cast<const unsigned char*>(text.data());
+    size_t len = text.size();
+    return (s[0] * coefficients[0] + s[len >> 1] * coefficients[1] + s[len - 1] * coefficients[2] + len) & mask;
+}
+
+// Literals hashed in the search for a perfect hash of a lexer
+// state before falling back to the lookup by length. Bounds the
+// generation time no matter how many keywords a state has.
+#define NEOAST_LITERAL_HASH_BUDGET (1 << 24)
+
+/**
+ * Search for a perfect hash of a set of literals
+ * @param literals literals to hash, all different
+ * @param coefficients weights of the first, middle and last characters
+ * @param size size of the hash table, a power of 2
+ * @return true if no two literals land in the same slot
+ */
+static bool find_literal_hash(const std::vector<const CGNeoastLexerRule*> &literals,
+                              uint32_t coefficients[3], size_t &size)
+{
+    // Literals with the same length and hashed characters
+    // land in the same slot with every coefficient
+    std::set<std::tuple<unsigned char, unsigned char, unsigned char, size_t>> keys;
+    for (const auto* literal: literals)
+    {
+        auto s = reinterpret_cast<const unsigned char*>(literal->literal.data());
+        size_t len = literal->literal.size();
+        if (!keys.emplace(s[0], s[len >> 1], s[len - 1], len).second)
+        {
+            return false;
+        }
+    }
+
+    // Slots are taken by the try with the same stamp, no clearing between tries
+    size_t budget = NEOAST_LITERAL_HASH_BUDGET;
+    std::vector<uint32_t> used;
+    uint32_t stamp = 0;
+    for (size = 1; size < literals.size(); size <<= 1);
+    for (; size <= literals.size() * 8; size <<= 1)
+    {
+        used.assign(size, 0);
+        for (uint32_t a = 0; a < 32; a++)
+        for (uint32_t b = 0; b < 32; b++)
+        for (uint32_t c = 0; c < 32; c++)
+        {
+            coefficients[0] = a;
+            coefficients[1] = b;
+            coefficients[2] = c;
+
+            stamp++;
+            bool perfect = true;
+            for (const auto* literal: literals)
+            {
+                if (!budget--)
+                {
+                    return false;
+                }
+
+                size_t h = literal_hash(literal->literal, coefficients, size - 1);
+                if (used[h] == stamp)
+                {
+                    perfect = false;
+                    break;
+                }
+
+                used[h] = stamp;
+            }
+
+            if (perfect)
+            {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+static std::string literal_string(const std::string &literal)
+{
+    std::string out = "\"";
+    for (char c: literal)
+    {
+        if (std::isalnum((unsigned char) c) || c == '_')
+        {
+            out.push_back(c);
+        }
+        else
+        {
+            out += variadic_string("\\%03o", (unsigned char) c);
+        }
+    }
+
+    return out + "\"";
+}
+
+/**
+ * Put the function mapping the groups of a lexer state's DFA back to
+ * its rules. Text matched by a host rule is looked up in the literal
+ * rules folded into it with a perfect hash (or by length if there is
+ * none) so that the literal's action runs instead.
+ */
+static void put_literals(std::ostream &os, const CGNeoastLexerState &state)
+{
+    auto groups = state.get_groups();
+
+    os << "// " << state.rules.size() + 1 - groups.size() << " literal rules of " << state.name
+       << " are looked up after the DFA matches\n"
+       << "static size_t " << state.name << "_LITERAL(const NeoastMatcher* m, size_t group)\n"
+       << "{\n"
+       << "    static const size_t rules[] = {";
+    for (size_t i = 0; i < groups.size(); i++)
+    {
+        os << (i ? ", " : "") << groups[i];
+    }
+    os << "};\n"
+          "    const unsigned char* s = (const unsigned char*) m->txt_;\n"
+          "    size_t len = m->len_;\n"
+          "\n"
+          "    if (group >= " << groups.size() << ") return group;\n"
+          "    switch (rules[group])\n"
+          "    {\n";
+
+    for (size_t host = 1; host <= state.rules.size(); host++)
+    {
+        std::vector<const CGNeoastLexerRule*> literals;
+        size_t min_len = SIZE_MAX, max_len = 0;
+        for (const auto &rule: state.rules)
+        {
+            if (rule.host == host)
+            {
+                literals.push_back(&rule);
+                min_len = std::min(min_len, rule.literal.size());
+                max_len = std::max(max_len, rule.literal.size());
+            }
+        }
+
+        if (literals.empty())
+        {
+            continue;
+        }
+
+        os << "    case " << host << ":\n"
+           << "        if (len >= " << min_len << " && len <= " << max_len << ")\n"
+           << "        {\n";
+
+        uint32_t coefficients[3];
+        size_t size;
+        if (find_literal_hash(literals, coefficients, size))
+        {
+            std::vector<const CGNeoastLexerRule*> slots(size, nullptr);
+            for (const auto* literal: literals)
+            {
+                slots[literal_hash(literal->literal, coefficients, size - 1)] = literal;
+            }
+
+            os << "            static const struct { const char* text; size_t len; size_t rule; } literals[] = {\n";
+            for (const auto* slot: slots)
+            {
+                if (slot)
+                {
+                    os << "                    {" << literal_string(slot->literal) << ", " << slot->literal.size()
+                       << ", " << (slot - state.rules.data()) + 1 << "},\n";
+                }
+                else
+                {
+                    os << "                    {NULL, 0, 0},\n";
+                }
+            }
+
+            os << "            };\n"
+               << variadic_string("            size_t h = (s[0] * %uu + s[len >> 1] * %uu + s[len - 1] * %uu + len) & %zu;\n",
+                                  coefficients[0], coefficients[1], coefficients[2], size - 1)
+               << "            if (literals[h].len == len && memcmp(literals[h].text, s, len) == 0) return literals[h].rule;\n";
+        }
+        else
+        {
+            os << "            switch (len)\n"
+                  "            {\n";
+            for (size_t len = min_len; len <= max_len; len++)
+            {
+                bool first = true;
+                for (const auto* literal: literals)
+                {
+                    if (literal->literal.size() != len)
+                    {
+                        continue;
+                    }
+
+                    if (first)
+                    {
+                        os << "            case " << len << ":\n";
+                        first = false;
+                    }
+
+                    os << "                if (memcmp(s, " << literal_string(literal->literal) << ", " << len
+                       << ") == 0) return " << (literal - state.rules.data()) + 1 << ";\n";
+                }
+
+                if (!first)
+                {
+                    os << "                break;\n";
+                }
+            }
+            os << "            }\n";
+        }
+
+        os << "        }\n"
+              "        break;\n";
+    }
+
+    os << "    }\n"
+          "\n"
+          "    return rules[group];\n"
+          "}\n\n";
 }
 
 void CGNeoastLexer::put_top(std::ostream &os) const
@@ -179,13 +595,27 @@ void CGNeoastLexer::put_top(std::ostream &os) const
 
 void CGNeoastLexer::put_global(std::ostream &os) const
 {
-    for (auto state: impl_->states)
+    for (auto &state: impl_->states)
     {
         cg_pattern_put_fsm(
                 os,
                 state.get_pattern(),
-                state.name + "_FSM");
+                state.name + "_FSM",
+                impl_->options.lexer_table);
         os << "\n";
+
+        if (state.has_folded())
+        {
+            put_literals(os, state);
+        }
+    }
+
+    // Token names in the lexer actions expand to the id the parser
+    // expects so that the tokens don't need to be mapped at runtime
+    // Skip EOF, it is never returned by name
+    for (size_t i = 1; i < impl_->translated_tokens.size(); i++)
+    {
+        os << "#define " << impl_->translated_tokens[i] << " (" << i << ")\n";
     }
 
     // Put the lexing function
@@ -196,9 +626,16 @@ void CGNeoastLexer::put_global(std::ostream &os) const
           "#define yystate (self__->lexing_state)\n"
           "#define yypush(state) NEOAST_STACK_PUSH(yystate, (state))\n"
           "#define yypop() NEOAST_STACK_POP(yystate)\n"
-          "#define yyposition ((" << impl_->options.track_position_type << "*)&(destination__->position))\n"
           "#define yycontext (context__)\n"
-          "#define yylen (self__->len_)\n\n"
+          "#define yylen (self__->len_)\n"
+          "#define yytext (matcher_text(self__))\n";
+
+    if (impl_->options.track_position)
+    {
+        os << "#define yyposition ((" << impl_->options.track_position_type << "*)&(destination__->position))\n";
+    }
+
+    os << "\n"
           "    while (!matcher_at_end(self__))\n"
           "    {\n"
           "        switch (NEOAST_STACK_PEEK(yystate))\n"
@@ -211,10 +648,18 @@ void CGNeoastLexer::put_global(std::ostream &os) const
                                             "        {\n"
                                             "            size_t neoast_tok___ = matcher_scan(self__, " << state.name
            << "_FSM);\n"
-              "            const char* yytext = matcher_text(self__);\n"
-              "            yyposition->line = matcher_lineno(self__);\n"
-              "            yyposition->col = matcher_columno(self__);\n"
-              "            yyposition->len = matcher_size(self__);\n\n"
+              "            if (matcher_need_more(self__)) return NEOAST_LEX_NEED_MORE;\n";
+        if (state.has_folded())
+        {
+            os << "            neoast_tok___ = " << state.name << "_LITERAL(self__, neoast_tok___);\n";
+        }
+        if (impl_->options.track_position)
+        {
+            os << "            yyposition->offset = matcher_offset(self__) - matcher_size(self__);\n"
+                  "            yyposition->len = matcher_size(self__);\n";
+        }
+
+        os << "\n"
               "            switch(neoast_tok___)\n"
               "            {\n"
               "            default:\n"
@@ -222,16 +667,28 @@ void CGNeoastLexer::put_global(std::ostream &os) const
         if (get_options().lexing_error_cb.empty())
         {
             os << "                if (!matcher_at_end(self__)) { fprintf(stderr, \"Failed to match token near "
-                  "line:col %d:%d (state " << state.name
-               << ")\", yyposition->line, yyposition->col); return -1; }\n"
+                  "line:col %zu:%zu (state " << state.name
+               << ")\", matcher_lineno(self__), matcher_columno(self__)); return -1; }\n"
                   "                else return 0;\n";
         }
-        else
+        else if (impl_->options.track_position)
         {
             os << "                if (!matcher_at_end(self__)) { " << get_options().lexing_error_cb
-               << "(yycontext, yytext, yyposition, \"" << state.name << "\"); return -1; }\n"
+               << "(yycontext, yytext, yyposition, self__->lines, \"" << state.name << "\"); return -1; }\n"
                                                              "                else return 0;\n";
         }
+        else
+        {
+            // Positions are not stored, only work out the one of the error
+            os << "                if (!matcher_at_end(self__))\n"
+                  "                {\n"
+                  "                    TokenPosition position__ = {matcher_offset(self__) - matcher_size(self__), matcher_size(self__)};\n"
+                  "                    " << get_options().lexing_error_cb
+               << "(yycontext, yytext, &position__, self__->lines, \"" << state.name << "\");\n"
+                  "                    return -1;\n"
+                  "                }\n"
+                  "                else return 0;\n";
+        }
 
         int i = 0;
         for (const auto &rule: state.rules)
@@ -251,7 +708,16 @@ void CGNeoastLexer::put_global(std::ostream &os) const
     os <<
        "    }}\n"
        "\n"
-       "    // EOF\n"
+       "    // EOF, unless more of a partial input is on its way\n"
+       "    if (self__->partial_) return NEOAST_LEX_NEED_MORE;\n";
+
+    if (impl_->options.track_position)
+    {
+        os << "    yyposition->offset = matcher_offset(self__);\n"
+              "    yyposition->len = 0;\n";
+    }
+
+    os <<
        "    return 0;\n"
        "#undef yyval\n"
        "#undef yystate\n"
@@ -260,11 +726,27 @@ void CGNeoastLexer::put_global(std::ostream &os) const
        "#undef yyposition\n"
        "#undef yycontext\n"
        "#undef yylen\n"
+       "#undef yytext\n"
        "}\n";
 
+    for (size_t i = 1; i < impl_->translated_tokens.size(); i++)
+    {
+        os << "#undef " << impl_->translated_tokens[i] << "\n";
+    }
+
 }
 void CGNeoastLexer::put_bottom(std::ostream& os) const
 {
+    if (!impl_->translated_tokens.empty())
+    {
+        os << "static int neoast_lexer_next_wrapper(void* matcher, void* dest, void* error_ctx)\n"
+              "{\n"
+              "    // Token ids were translated when the lexer was generated\n"
+              "    return neoast_lexer_next((NeoastMatcher*)matcher, (NeoastValue*)dest, error_ctx);\n"
+              "}";
+        return;
+    }
+
     // Write the wrapper function
     os << "static int neoast_lexer_next_wrapper(void* matcher, void* dest, void* error_ctx)\n"
           "{\n"
@@ -292,16 +774,6 @@ const Options &CGNeoastLexer::get_options() const
     return impl_->options;
 }
 
-std::string CGNeoastLexer::get_init() const
-{
-    return "";
-}
-
-std::string CGNeoastLexer::get_delete() const
-{
-    return "";
-}
-
 CGNeoastLexer::~CGNeoastLexer()
 {
     delete impl_;
@@ -313,6 +785,12 @@ std::string CGNeoastLexer::get_new_inst(const std::string &name) const
            "    NEOAST_STACK_PUSH(ll_inst->lexing_state, LEX_STATE_DEFAULT);";
 }
 
+std::string CGNeoastLexer::get_reset_inst(const std::string &name) const
+{
+    return "matcher_set_input(ll_inst, input);\n"
+           "    NEOAST_STACK_PUSH(ll_inst->lexing_state, LEX_STATE_DEFAULT);";
+}
+
 std::string CGNeoastLexer::get_del_inst(const std::string &name) const
 {
     return "matcher_free(ll_inst);";
@@ -29,19 +29,24 @@ class CGNeoastLexer : public CGLexer
     CGNeoastLexerImpl* impl_;
 
 public:
+    /**
+     * @param translated_tokens action tokens ordered by id, the lexer will
+     *        return these ids directly. Leave empty when ASCII tokens
+     *        need to be mapped at runtime.
+     */
     explicit CGNeoastLexer(const File* self, const MacroEngine &m_engine_,
-                           const Options &options);
+                           const Options &options,
+                           std::vector<std::string> translated_tokens = {});
 
     void put_top(std::ostream &os) const override;
     void put_global(std::ostream &os) const override;
     void put_bottom(std::ostream& os) const override;
     const Options& get_options() const;
-    std::string get_init() const override;
-    std::string get_delete() const override;
     ~CGNeoastLexer();
 
     // Internal call names TODO(tumbar)
     std::string get_new_inst(const std::string &name) const override;
+    std::string get_reset_inst(const std::string &name) const override;
     std::string get_del_inst(const std::string& name) const override;
     std::string get_ll_next(const std::string& name) const override;
 };
@@ -15,7 +15,10 @@
  * along with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <map>
+#include <vector>
 #include <reflex/timer.h>
+#include <parsergen/compressed_table.h>
 #include "cg_pattern.h"
 #include "cg_util.h"
 
@@ -42,6 +45,11 @@ namespace reflex
                 const Pattern::DFA::State* state, int nest,
                 bool peek);
 
+        bool gencode_table(
+                std::ostream &os,
+                const Pattern::DFA::State* start,
+                const std::string &func_name);
+
     public:
         explicit NeoastPattern(const std::string &regex)
         {
@@ -58,7 +66,8 @@ namespace reflex
         }
 
         void custom_codegen(std::ostream &os,
-                            const std::string &func_name)
+                            const std::string &func_name,
+                            bool table)
         {
             Positions startpos;
             Follow followpos;
@@ -78,7 +87,16 @@ namespace reflex
             compact_dfa(start);
             encode_dfa(start);
             wms_ = timer_elapsed(t);
-            gencode_dfa(os, start, func_name);
+            if (!table)
+            {
+                gencode_dfa(os, start, func_name);
+            }
+            else if (!gencode_table(os, start, func_name))
+            {
+                emit_warning(nullptr, "%s cannot run from a table (anchors, word boundaries or lookaheads), "
+                                      "using goto code", func_name.c_str());
+                gencode_dfa(os, start, func_name);
+            }
             // delete the DFA
             dfa_.clear();
         }
@@ -458,11 +476,129 @@ namespace reflex
             }
         }
     }
+
+    bool NeoastPattern::gencode_table(std::ostream &os,
+                                      const Pattern::DFA::State* start,
+                                      const std::string &func_name)
+    {
+        // Anchors, word boundaries, indents and lookaheads
+        // need the goto code to test them between characters.
+        // State indices are opcode offsets, number the states
+        // densely in the order of the list, start state first
+        std::map<Pattern::Index, uint32_t> ids;
+        for (const Pattern::DFA::State* state = start; state; state = state->next)
+        {
+            if (!state->heads.empty() || !state->tails.empty())
+                return false;
+            for (const auto &edge: state->edges)
+            {
+                if (Pattern::is_meta(edge.first))
+                    return false;
+            }
+
+            ids.emplace(state->index, ids.size());
+        }
+
+        // next and check hold 16-bit states, 0xFFFF marks an empty slot
+        uint32_t state_n = ids.size();
+        if (state_n >= 0xFFFF)
+            return false;
+
+        // Dense targets + 1 of every state and byte, 0 halts
+        std::vector<std::vector<uint32_t>> targets(state_n, std::vector<uint32_t>(256, 0));
+        std::vector<uint32_t> accept(state_n, 0);
+        std::vector<bool> reads(state_n, false);
+        for (const Pattern::DFA::State* state = start; state; state = state->next)
+        {
+            uint32_t id = ids[state->index];
+            if (state->redo)
+                accept[id] = 0x7FFFFFFF; // CONST_REDO
+            else if (state->accept > 0)
+                accept[id] = state->accept;
+
+            // Same as gencode_dfa(), a state only reads a character if
+            // it has an edge other than a trailing halt on the lowest range
+            for (auto i = state->edges.rbegin(); i != state->edges.rend(); ++i)
+            {
+                auto j = i;
+                if (i->second.second == NULL && (++j == state->edges.rend() || Pattern::is_meta(j->second.first)))
+                    break;
+
+                reads[id] = true;
+                if (i->second.second == NULL)
+                    continue;
+
+                for (uint32_t c = i->first; c <= i->second.first; c++)
+                    targets[id][c] = ids[i->second.second->index] + 1;
+            }
+        }
+
+        // Bytes that lead to the same state from every state share a class
+        std::map<std::vector<uint32_t>, uint32_t> class_ids;
+        std::vector<uint32_t> classes(256);
+        for (uint32_t c = 0; c < 256; c++)
+        {
+            std::vector<uint32_t> column(state_n);
+            for (uint32_t state = 0; state < state_n; state++)
+                column[state] = targets[state][c];
+
+            auto iter = class_ids.emplace(column, class_ids.size()).first;
+            classes[c] = iter->second;
+        }
+
+        uint32_t class_n = class_ids.size();
+        std::vector<uint32_t> table(state_n * class_n, 0);
+        for (uint32_t c = 0; c < 256; c++)
+        {
+            for (uint32_t state = 0; state < state_n; state++)
+                table[state * class_n + classes[c]] = targets[state][c];
+        }
+
+        parsergen::TableCompressor compressed(table.data(), state_n, class_n);
+        std::vector<uint32_t> base = compressed.base();
+        std::vector<uint32_t> check = compressed.check();
+        for (uint32_t state = 0; state < state_n; state++)
+        {
+            if (!reads[state])
+                base[state] = 0xFFFFFFFF; // FSM_TABLE_NO_READ
+        }
+        for (auto &owner: check)
+        {
+            if (owner == parsergen::TableCompressor::CHECK_EMPTY)
+                owner = 0xFFFF;
+        }
+
+        os << variadic_string("// %u states, %u byte classes, compressed from %u to %zu entries\n",
+                              state_n, class_n, state_n * 256, compressed.size());
+        put_table_vector(os, func_name + "_classes", classes, sizeof(uint8_t));
+        put_table_vector(os, func_name + "_accept", accept);
+        put_table_vector(os, func_name + "_base", base);
+        put_table_vector(os, func_name + "_defaults", compressed.defaults(), sizeof(uint16_t));
+        put_table_vector(os, func_name + "_next", compressed.next(), sizeof(uint16_t));
+        put_table_vector(os, func_name + "_check", check, sizeof(uint16_t));
+
+        os << "static const\nNeoastPatternTable " << func_name << "_table = {\n"
+           << "        .classes = " << func_name << "_classes,\n"
+           << "        .accept = " << func_name << "_accept,\n"
+           << "        .base = " << func_name << "_base,\n"
+           << "        .defaults = " << func_name << "_defaults,\n"
+           << "        .next = " << func_name << "_next,\n"
+           << "        .check = " << func_name << "_check,\n"
+           << "};\n\n";
+
+        os << variadic_string("static void %s(NeoastMatcher* m)\n"
+                              "{\n"
+                              "  FSM_TABLE(m, &%s_table);\n"
+                              "}\n\n",
+                              func_name.c_str(), func_name.c_str());
+        return true;
+    }
 }
 
 void cg_pattern_put_fsm(std::ostream &os,
                         const std::string &regex,
-                        const std::string &func_name)
+                        const std::string &func_name,
+                        bool table)
 {
-    reflex::NeoastPattern(regex).custom_codegen(os, func_name);
+    reflex::NeoastPattern(regex).custom_codegen(os, func_name, table);
 }
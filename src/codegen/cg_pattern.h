@@ -27,10 +27,13 @@
  * @param os output stream to dump to
  * @param pat pattern to generate FSM for
  * @param func_name function name where to place the FSM code
+ * @param table emit a transition table run by FSM_TABLE() instead
+ *              of goto code, if the DFA can be run from one
  */
 void cg_pattern_put_fsm(
         std::ostream &os,
         const std::string &regex,
-        const std::string& func_name);
+        const std::string& func_name,
+        bool table = false);
 
 #endif //NEOAST_CG_PATTERN_H
@@ -63,6 +63,76 @@ void Options::handle(const KeyVal* option)
             emit_error(&option->position, "Invalid parser type, support types: 'LALR(1)', 'CLR(1)'");
         }
     }
+    else if (strcmp(option->key, "table_format") == 0)
+    {
+        if (strcmp(option->value, "dense") == 0)
+        {
+            table_format = TABLE_FORMAT_DENSE;
+        }
+        else if (strcmp(option->value, "compressed") == 0)
+        {
+            table_format = TABLE_FORMAT_COMPRESSED;
+        }
+        else if (strcmp(option->value, "split") == 0)
+        {
+            // Narrowed to the smallest entry type when the table is generated
+            table_format = TABLE_FORMAT_SPLIT_32;
+        }
+        else
+        {
+            emit_error(&option->position, "Invalid table format, support formats: 'dense', 'compressed', 'split'");
+        }
+    }
+    else if (strcmp(option->key, "backend") == 0)
+    {
+        if (strcmp(option->value, "table") == 0)
+        {
+            direct_backend = false;
+        }
+        else if (strcmp(option->value, "direct") == 0)
+        {
+            direct_backend = true;
+        }
+        else
+        {
+            emit_error(&option->position, "Invalid parser backend, support backends: 'table', 'direct'");
+        }
+    }
+    else if (strcmp(option->key, "lexer_backend") == 0)
+    {
+        if (strcmp(option->value, "goto") == 0)
+        {
+            lexer_table = false;
+        }
+        else if (strcmp(option->value, "table") == 0)
+        {
+            lexer_table = true;
+        }
+        else
+        {
+            emit_error(&option->position, "Invalid lexer backend, support backends: 'goto', 'table'");
+        }
+    }
+    else if (strcmp(option->key, "fold_literals") == 0)
+    {
+        fold_literals = codegen_parse_bool(option);
+    }
+    else if (strcmp(option->key, "pipeline") == 0)
+    {
+        pipeline = codegen_parse_bool(option);
+    }
+    else if (strcmp(option->key, "incremental") == 0)
+    {
+        incremental = codegen_parse_bool(option);
+    }
+    else if (strcmp(option->key, "default_reductions") == 0)
+    {
+        default_reductions = codegen_parse_bool(option);
+    }
+    else if (strcmp(option->key, "track_position") == 0)
+    {
+        track_position = codegen_parse_bool(option);
+    }
     else if (strcmp(option->key, "track_position_type") == 0)
     {
         track_position_type = option->value;
@@ -83,6 +153,10 @@ void Options::handle(const KeyVal* option)
     {
         parsing_stack_n = (int)strtol(option->value, nullptr, 0);
     }
+    else if (strcmp(option->key, "max_tokens") == 0)
+    {
+        max_tokens = (int)strtol(option->value, nullptr, 0);
+    }
     else if (strcmp(option->key, "parsing_error_cb") == 0)
     {
         syntax_error_cb = option->value;
@@ -97,14 +171,31 @@ void Options::handle(const KeyVal* option)
     }
 }
 
+void put_table_vector(std::ostream &os,
+                      const std::string& name,
+                      const std::vector<uint32_t>& vec,
+                      size_t entry_size)
+{
+    static const char* types[] = {nullptr, "uint8_t", "uint16_t", nullptr, "uint32_t"};
+    std::string entry_fmt = variadic_string("0x%%0%zuX,%%c", entry_size * 2);
+
+    os << "static const\n" << types[entry_size] << " " << name << "[] = {\n";
+    for (size_t i = 0; i < vec.size(); i++)
+    {
+        if (i % 8 == 0) os << "        ";
+        os << variadic_string(entry_fmt.c_str(), vec[i], (i % 8 == 7 || i + 1 == vec.size()) ? '\n' : ' ');
+    }
+    os << "};\n\n";
+}
 
 std::string Code::get_simple(const Options &options) const
 {
     std::ostringstream ss;
-    if (line && !file.empty() && options.annotate_line)
+    TokenLocation location;
+    if (!file.empty() && options.annotate_line && locate_position(this, &location) == 0)
     {
         ss << "\n#line "
-           << line
+           << location.line
            << " \"" << file.c_str() << "\"\n";
     }
     ss << code;
@@ -117,10 +208,11 @@ Code::get_complex(const Options &options, const std::vector<std::string> &argume
                   const std::string &non_zero_arg, bool is_union) const
 {
     std::ostringstream os;
-    if (line && !file.empty() && options.annotate_line)
+    TokenLocation location;
+    if (!file.empty() && options.annotate_line && locate_position(this, &location) == 0)
     {
         os << "\n#line "
-           << line
+           << location.line
            << " \"" << file.c_str() << "\"\n";
     }
 
@@ -144,9 +236,8 @@ Code::get_complex(const Options &options, const std::vector<std::string> &argume
             continue;
         }
 
-        TokenPosition match_pos = {line,
-                                   static_cast<uint16_t>(col + match.first()),
-                                   static_cast<uint16_t>(match.size())};
+        // Code starts right after the opening brace
+        TokenPosition match_pos = {offset + 1 + match.first(), (uint32_t) match.size()};
         if (match.text()[1] == '$')
         {
             if (is_union)
@@ -166,6 +257,12 @@ Code::get_complex(const Options &options, const std::vector<std::string> &argume
                 continue;
             }
 
+            if (!options.track_position)
+            {
+                emit_error(&match_pos, "Positions are not tracked with %%option track_position=\"FALSE\"");
+                continue;
+            }
+
             size_t idx;
             idx = std::stol(match.text() + 2, nullptr, 10);
 
@@ -222,7 +319,16 @@ Code::get_complex(const Options &options, const std::vector<std::string> &argume
                 continue;
             }
 
-            os << non_zero_arg << "[" << idx - 1 << "].value." << argument_replace[idx];
+            if (options.incremental)
+            {
+                // Arguments are shared with the tree of the last parse
+                os << "((const typeof(*" << non_zero_arg << ")*) " << non_zero_arg << ")"
+                   << "[" << idx - 1 << "].value." << argument_replace[idx];
+            }
+            else
+            {
+                os << non_zero_arg << "[" << idx - 1 << "].value." << argument_replace[idx];
+            }
         }
     }
 
@@ -3,6 +3,7 @@
 
 #include <string>
 #include <sstream>
+#include <vector>
 #include <codegen/codegen.h>
 #include <util/util.h>
 #include <memory>
@@ -11,14 +12,23 @@ struct Options {
     // Should we dump the table
     bool annotate_line = true;
     std::string track_position_type = "TokenPosition";
+    bool track_position = true; // Store the position of every value, needed by $p and yyposition
     std::string debug_ids;
     std::string prefix = "neoast";
     std::string lexing_error_cb;
     std::string syntax_error_cb;
     parser_t parser_type = LALR_1; // LALR(1) or CLR(1)
+    table_format_t table_format = TABLE_FORMAT_DENSE;
+    bool default_reductions = true;
+    bool direct_backend = false; // Emit the parser as direct code instead of driving the table
+    bool pipeline = false; // Emit <prefix>_parse_pipelined(), lexing on a helper thread
+    bool incremental = false; // Emit <prefix>_incremental_*(), reparsing after edits
+    bool lexer_table = false; // Run the lexer DFAs from transition tables instead of goto code
+    bool fold_literals = true; // Look up literal rules matched by a more general rule after the DFA
 
-    int parsing_stack_n = 1024;
-    int max_tokens = 1024;
+    // Hard limits of the parser buffers, 0 to grow without limit
+    int parsing_stack_n = 0;
+    int max_tokens = 0;
 
     void handle(const KeyVal* option);
 };
@@ -74,4 +84,16 @@ void put_enum(int start, const T& iterable, std::ostream& os,
 
 std::vector<std::pair<int, int>> mark_redzones(const std::string& code);
 
+/**
+ * Put a constant C array holding a generated table
+ * @param os output stream to dump to
+ * @param name name of the array
+ * @param vec entries of the table
+ * @param entry_size size of each entry in bytes: 1, 2 or 4
+ */
+void put_table_vector(std::ostream &os,
+                      const std::string& name,
+                      const std::vector<uint32_t>& vec,
+                      size_t entry_size = sizeof(uint32_t));
+
 #endif //NEOAST_CG_UTIL_H
@@ -16,6 +16,8 @@
  */
 
 
+#include <algorithm>
+#include <cstring>
 #include <memory>
 #include <string>
 #include "codegen_impl.h"
@@ -23,13 +25,15 @@
 #include "codegen_priv.h"
 
 #include <parsergen/canonical_collection.h>
+#include <parsergen/compressed_table.h>
+#include <parsergen/split_table.h>
 #include <util/util.h>
 #include <utility>
 #include <fstream>
 
 
 std::string grammar_filename;
-const TokenPosition NO_POSITION = {0, 0};
+const TokenPosition NO_POSITION = {UINT64_MAX, 0};
 
 
 void CodeGenImpl::parse_header(const File* self)
@@ -197,7 +201,99 @@ void CodeGenImpl::parse_lexer(const File* self)
         return;
     }
 
-    lexer = std::make_shared<CGNeoastLexer>(self, m_engine, options);
+    if (options.pipeline)
+    {
+        check_pipeline_lexer(self->lexer_rules);
+    }
+
+    if (options.incremental)
+    {
+        check_incremental(self->lexer_rules);
+    }
+
+    if (!options.track_position)
+    {
+        check_untracked_lexer(self->lexer_rules);
+    }
+
+    // Without ASCII tokens every value the lexer returns is
+    // a named token, translate them while generating the lexer
+    std::vector<std::string> translated_tokens;
+    if (std::none_of(action_tokens.begin(), action_tokens.end(),
+                     [](const sp<CGAction> &tok) { return tok->is_ascii; }))
+    {
+        for (const auto &tok : action_tokens)
+        {
+            translated_tokens.push_back(tok->name);
+        }
+    }
+
+    lexer = std::make_shared<CGNeoastLexer>(self, m_engine, options, std::move(translated_tokens));
+}
+
+void CodeGenImpl::check_pipeline_lexer(const LexerRuleProto* rules)
+{
+    // Pipelined parses run the lexer on its own thread, it may
+    // not read anything the grammar actions are writing to
+    for (const LexerRuleProto* iter = rules; iter; iter = iter->next)
+    {
+        if (iter->state_rules)
+        {
+            check_pipeline_lexer(iter->state_rules);
+        }
+        else if (iter->function && strstr(iter->function, "yycontext"))
+        {
+            emit_error(&iter->position,
+                       "Lexer actions may not use 'yycontext' with %%option pipeline, "
+                       "the lexer runs on a separate thread from the grammar actions");
+        }
+    }
+}
+
+void CodeGenImpl::check_untracked_lexer(const LexerRuleProto* rules)
+{
+    // Values have no room for a position, the lexer
+    // only works one out when reporting an error
+    for (const LexerRuleProto* iter = rules; iter; iter = iter->next)
+    {
+        if (iter->state_rules)
+        {
+            check_untracked_lexer(iter->state_rules);
+        }
+        else if (iter->function && strstr(iter->function, "yyposition"))
+        {
+            emit_error(&iter->position,
+                       "Lexer actions may not use 'yyposition' with %%option track_position=\"FALSE\"");
+        }
+    }
+}
+
+void CodeGenImpl::check_incremental(const LexerRuleProto* rules)
+{
+    // Incremental parses restart the lexer at token boundaries
+    // in its default state and share values between parses
+    for (const LexerRuleProto* iter = rules; iter; iter = iter->next)
+    {
+        if (iter->state_rules)
+        {
+            emit_error(&iter->position,
+                       "Lexing states are not supported with %%option incremental, "
+                       "the lexer is restarted in the middle of the input");
+            break;
+        }
+    }
+
+    if (!destructors.empty())
+    {
+        emit_error(nullptr, "%%destructor is not supported with %%option incremental, "
+                            "values are shared between parses");
+    }
+
+    if (options.track_position_type != "TokenPosition")
+    {
+        emit_error(nullptr, "%%option incremental needs the default track_position_type, "
+                            "positions of reused values are moved as TokenPosition");
+    }
 }
 
 void CodeGenImpl::parse_grammar(const File* self)
@@ -225,6 +321,7 @@ void CodeGenImpl::init_cc()
     parser->grammar_n = grammar->size();
     parser->token_n = static_cast<uint32_t>(tokens.size()) - 1;
     parser->action_token_n = static_cast<uint32_t>(action_tokens.size());
+    parser->table_format = options.table_format;
 
     cc = up<parsergen::CanonicalCollection>(new parsergen::CanonicalCollection(parser.get(), input, grammar->get_positions()));
     if (input->has_errors())
@@ -247,7 +344,8 @@ void CodeGenImpl::init_cc()
     }
 
     parsing_table = up<uint32_t[]>(new uint32_t[cc->table_size()]);
-    auto error = cc->generate(parsing_table.get(), precedence_table.get());
+    default_reductions = up<uint32_t[]>(new uint32_t[cc->size()]);
+    auto error = cc->generate(parsing_table.get(), precedence_table.get(), default_reductions.get());
 
     if (error)
     {
@@ -269,8 +367,70 @@ void CodeGenImpl::put_ascii_mappings(std::ostream &os) const
     }
 }
 
-void CodeGenImpl::put_parsing_table(std::ostream &os) const
+table_format_t CodeGenImpl::put_parsing_table(std::ostream &os) const
 {
+    if (options.default_reductions)
+    {
+        put_table_vector(os, options.prefix + "_default_reductions",
+                         std::vector<uint32_t>(default_reductions.get(), default_reductions.get() + cc->size()));
+    }
+
+    // Terminals with an action in each state, taken before
+    // compression fills the error entries with default actions
+    uint32_t token_n = cc->parser()->token_n;
+    uint32_t action_token_n = cc->parser()->action_token_n;
+    size_t words = (action_token_n + 31) / 32;
+    std::vector<uint32_t> expected_tokens(cc->size() * words, 0);
+    for (size_t state = 0; state < cc->size(); state++)
+    {
+        for (uint32_t tok = 0; tok < action_token_n; tok++)
+        {
+            if (parsing_table[state * token_n + tok] != TOK_SYNTAX_ERROR)
+            {
+                expected_tokens[state * words + (tok >> 5)] |= 1u << (tok & 31);
+            }
+        }
+    }
+    put_table_vector(os, options.prefix + "_expected_tokens", expected_tokens);
+
+    if (options.table_format == TABLE_FORMAT_COMPRESSED)
+    {
+        parsergen::TableCompressor compressed(parsing_table.get(), cc->size(), cc->parser()->token_n,
+                                              options.default_reductions ? default_reductions.get() : nullptr);
+        put_table_vector(os, options.prefix + "_parsing_table_base", compressed.base());
+        put_table_vector(os, options.prefix + "_parsing_table_defaults", compressed.defaults());
+        put_table_vector(os, options.prefix + "_parsing_table_next", compressed.next());
+        put_table_vector(os, options.prefix + "_parsing_table_check", compressed.check());
+
+        os << variadic_string("// Compressed from %zu to %zu entries\n",
+                              cc->table_size(), compressed.size());
+        os << "static const\nCompressedTable " << options.prefix << "_parsing_table = {\n"
+           << "        .base = " << options.prefix << "_parsing_table_base,\n"
+           << "        .defaults = " << options.prefix << "_parsing_table_defaults,\n"
+           << "        .next = " << options.prefix << "_parsing_table_next,\n"
+           << "        .check = " << options.prefix << "_parsing_table_check,\n"
+           << "};";
+        return TABLE_FORMAT_COMPRESSED;
+    }
+    else if (options.table_format == TABLE_FORMAT_SPLIT_8
+             || options.table_format == TABLE_FORMAT_SPLIT_16
+             || options.table_format == TABLE_FORMAT_SPLIT_32)
+    {
+        parsergen::TableSplitter split(parsing_table.get(), cc->size(), cc->parser()->token_n,
+                                       cc->parser()->action_token_n, cc->parser()->grammar_n);
+        put_table_vector(os, options.prefix + "_parsing_table_actions", split.actions(), split.entry_size());
+        put_table_vector(os, options.prefix + "_parsing_table_gotos", split.gotos(), split.entry_size());
+
+        os << variadic_string("// Split from %zu to %zu bytes\n",
+                              cc->table_size() * sizeof(uint32_t), split.size());
+        os << "static const\nSplitTable " << options.prefix << "_parsing_table = {\n"
+           << "        .actions = " << options.prefix << "_parsing_table_actions,\n"
+           << "        .gotos = " << options.prefix << "_parsing_table_gotos,\n"
+           << "        .state_n = " << cc->size() << ",\n"
+           << "};";
+        return split.format();
+    }
+
     // Actually put the LR parsing table
     int i = 0;
     os << "static const\nuint32_t " << options.prefix << "_parsing_table[] = {\n";
@@ -283,6 +443,7 @@ void CodeGenImpl::put_parsing_table(std::ostream &os) const
         }
     }
     os << "};";
+    return TABLE_FORMAT_DENSE;
 }
 
 sp<CGToken> CodeGenImpl::get_token(const std::string &name) const
@@ -340,12 +501,20 @@ CodeGenImpl::CodeGenImpl(CodeGen* parent_, InputFile* input_file)
 {
 }
 
-void CodeGenImpl::parse()
+void CodeGenImpl::parse(const KeyVal* overrides)
 {
     parse_header(input->get());
     if (has_errors())
     { return; }
 
+    for (const KeyVal* iter = overrides; iter; iter = iter->next)
+    {
+        options.handle(iter);
+    }
+
+    if (has_errors())
+    { return; }
+
     parse_lexer(input->get());
     if (has_errors())
     { return; }
@@ -358,11 +527,11 @@ void CodeGenImpl::parse()
     init_cc();
 }
 
-CodeGen::CodeGen(InputFile* input_file)
+CodeGen::CodeGen(InputFile* input_file, const KeyVal* options)
 : impl_(new CodeGenImpl(this, input_file))
 {
     grammar_filename = input_file->get_path();
-    impl_->parse();
+    impl_->parse(options);
 }
 
 sp<CGToken> CodeGen::get_token(const std::string &name) const
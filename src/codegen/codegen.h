@@ -102,14 +102,22 @@ void emit_warning(const TokenPosition* position, const char* message, ...);
 void emit_error(const TokenPosition* position, const char* message, ...);
 uint32_t has_errors();
 
+/**
+ * Get the line and column of a position in the grammar file
+ * @return 0 on success, -1 if the position is not in the file
+ */
+int locate_position(const TokenPosition* position, TokenLocation* location);
+
 void lexing_error_cb(void* ctx,
                      const char* input,
                      const TokenPosition* position,
+                     NeoastLines* lines,
                      const char* lexer_state);
 
 void parsing_error_cb(void* ctx,
                       const char* const* token_names,
                       const TokenPosition* position,
+                      NeoastLines* lines,
                       uint32_t last_token,
                       uint32_t current_token,
                       const uint32_t expected_tokens[],
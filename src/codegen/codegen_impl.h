@@ -41,6 +41,7 @@ struct CodeGenImpl
     up<parsergen::CanonicalCollection> cc;
     up<uint8_t[]> precedence_table;
     up<uint32_t[]> parsing_table;
+    up<uint32_t[]> default_reductions;
 
     std::map <std::string, up<Code>> destructors;
     Options options;
@@ -49,7 +50,7 @@ struct CodeGenImpl
 
     explicit CodeGenImpl(CodeGen* parent_, InputFile* input_file);
     sp<CGToken> get_token(const std::string &name) const;
-    void parse();
+    void parse(const KeyVal* overrides);
 
     void write_header(std::ostream &os, bool dump_license=true) const;
     void write_source(std::ostream &os, bool dump_license=true) const;
@@ -57,11 +58,18 @@ struct CodeGenImpl
 private:
     void parse_header(const File* self);
     void parse_lexer(const File* self);
+    void check_pipeline_lexer(const LexerRuleProto* rules);
+    void check_incremental(const LexerRuleProto* rules);
+    void check_untracked_lexer(const LexerRuleProto* rules);
     void parse_grammar(const File* self);
     void init_cc();
 
     void put_ascii_mappings(std::ostream &os) const;
-    void put_parsing_table(std::ostream &os) const;
+    /**
+     * Put the parsing table in the layout selected by the options
+     * @return format of the table that was written
+     */
+    table_format_t put_parsing_table(std::ostream &os) const;
     void register_action(const sp<CGAction>& ptr);
     void register_grammar(const sp<CGGrammarToken>& ptr);
 };
@@ -34,7 +34,7 @@ class CodeGen
     CodeGenImpl* impl_;
 
 public:
-    explicit CodeGen(InputFile* input_file);
+    explicit CodeGen(InputFile* input_file, const KeyVal* options = nullptr);
 
     sp<CGToken> get_token(const std::string &name) const;
     const char* get_start_token() const;
@@ -17,6 +17,7 @@
 
 
 #include <codegen/codegen_impl.h>
+#include <codegen/cg_direct.h>
 #include <inja/inja.hpp>
 
 static const char license_header[] = R"(/*
@@ -55,6 +56,9 @@ void CodeGenImpl::write_header(std::ostream &os, bool dump_license) const
     header_data["union_name"] = CODEGEN_UNION;
     header_data["struct_name"] = CODEGEN_STRUCT;
     header_data["start_type"] = start_type;
+    header_data["pipeline"] = options.pipeline;
+    header_data["incremental"] = options.incremental;
+    header_data["track_position"] = options.track_position;
 
     if (dump_license)
     {
@@ -77,6 +81,7 @@ extern "C" {
 #endif // NEOAST_GET_TOKENS
 
 #include <lexer/input.h>
+#include <neoast.h>
 
 #ifdef NEOAST_GET_STRUCTURE
 /************************ NEOAST Union/Struct definition ************************/
@@ -84,13 +89,26 @@ typedef union { {{ union }} } {{ union_name }};
 
 typedef struct {
     {{ union_name }} value;
+{% if track_position %}
     TokenPosition position;
+{% endif %}
 } {{ struct_name }};
 #endif // NEOAST_GET_STRUCTURE
 
 /*************************** NEOAST Lexer definition ****************************/
 {{ lexer }}
 
+/**
+ * The {{ prefix }} parser holds no global state. Any number of threads
+ * may parse at the same time as long as each one uses its own buffers
+ * and push parsers, these objects are not shared between threads.
+ * {{ prefix }}_init() and {{ prefix }}_free() are kept for compatibility
+ * and do nothing.
+ */
+uint32_t {{ prefix }}_init();
+
+void {{ prefix }}_free();
+
 void* {{ prefix }}_allocate_buffers();
 
 void {{ prefix }}_free_buffers(void* self);
@@ -114,6 +132,163 @@ typeof(__{{ prefix }}__t_.{{ start_type }}) {{ prefix }}_parse(void* error_ctx,
  * @return top of the generated AST
  */
 typeof(__{{ prefix }}__t_.{{ start_type }}) {{ prefix }}_parse_input(void* error_ctx, void* buffers_, NeoastInput* input);
+{% if pipeline %}
+
+/**
+ * Parse with the lexer running on a helper thread. Lexing overlaps
+ * with parsing and the grammar actions, use this for large inputs.
+ * See {{ prefix }}_parse_len()
+ */
+typeof(__{{ prefix }}__t_.{{ start_type }}) {{ prefix }}_parse_pipelined(void* error_ctx, void* buffers_, const char* input, uint32_t input_len);
+{% endif %}
+
+/**
+ * Check if an input is syntactically valid without running
+ * any grammar actions or building the AST
+ * @param buffers_ Allocated pointer to buffers created with {{ prefix }}_allocate_buffers()
+ * @param input pointer to raw input
+ * @param input_len length of input in bytes
+ * @param error_position set to the position of the rejected token (may be NULL)
+ * @return 0 if the input is valid, -1 otherwise
+ */
+int {{ prefix }}_validate(void* error_ctx, void* buffers_, const char* input, uint32_t input_len,
+                          TokenPosition* error_position);
+
+/**
+ * Create a parse session that owns its buffers and lexer. A session
+ * is reused for any number of inputs, parsing through a session
+ * does not allocate unless an input outgrows the buffers.
+ * @return session to free with {{ prefix }}_session_free()
+ */
+void* {{ prefix }}_session_new();
+
+void {{ prefix }}_session_free(void* session_);
+
+/**
+ * Point a session at the next input. The input must outlive the parse.
+ * Values from the last parse of this session are overwritten.
+ * @param session_ session created with {{ prefix }}_session_new()
+ * @param input pointer to raw input
+ * @param input_len length of input in bytes
+ */
+void {{ prefix }}_session_reset(void* session_, const char* input, uint32_t input_len);
+
+/**
+ * Parse the input given to the last {{ prefix }}_session_reset()
+ * A suspended budgeted parse is dropped and the input is parsed from the start.
+ * @param session_ session created with {{ prefix }}_session_new()
+ * @return top of the generated AST
+ */
+typeof(__{{ prefix }}__t_.{{ start_type }}) {{ prefix }}_session_parse(void* error_ctx, void* session_);
+
+/**
+ * Validate the input given to the last {{ prefix }}_session_reset()
+ * A suspended budgeted parse is dropped first. See {{ prefix }}_validate()
+ */
+int {{ prefix }}_session_validate(void* error_ctx, void* session_, TokenPosition* error_position);
+
+/**
+ * Parse the input given to the last {{ prefix }}_session_reset() for at most
+ * max_steps shifts and reductions. Call this again to resume a suspended
+ * parse where it left off. Resetting the session drops a suspended parse.
+ * @param session_ session created with {{ prefix }}_session_new()
+ * @param max_steps shifts and reductions to run before suspending, 0 for no limit
+ * @param result set to the top of the generated AST once the input is accepted (may be NULL)
+ * @return 0 if the input was accepted, -1 on error or NEOAST_PARSE_SUSPENDED
+ */
+int {{ prefix }}_session_parse_budget(void* error_ctx, void* session_, uint32_t max_steps,
+                                      typeof(__{{ prefix }}__t_.{{ start_type }})* result);
+
+/**
+ * Parse a batch of independent inputs on a pool of threads. Each
+ * worker owns a session, results are written in input order.
+ * Values allocated with yyalloc() are gone once the worker moves
+ * on to its next input.
+ * @param error_ctxs context passed to the callbacks of each input (may be NULL)
+ * @param inputs pointers to the raw inputs
+ * @param input_lens length of each input in bytes, NULL if the inputs are NUL terminated
+ * @param n number of inputs
+ * @param results top of the generated AST of each input, 0 if the input failed to parse
+ * @param thread_n number of threads to parse with, 0 for one per online CPU
+ * @return number of inputs that failed to parse
+ */
+uint32_t {{ prefix }}_parse_batch(void* const error_ctxs[], const char* const inputs[], const uint32_t input_lens[],
+                                  uint32_t n, typeof(__{{ prefix }}__t_.{{ start_type }}) results[], uint32_t thread_n);
+
+{% if incremental %}
+/**
+ * Create an incremental parser. It keeps the tree of its last
+ * parse to reuse the parts of the text that were not edited.
+ * @return incremental parser to free with {{ prefix }}_incremental_free()
+ */
+void* {{ prefix }}_incremental_new();
+
+void {{ prefix }}_incremental_free(void* incremental_);
+
+/**
+ * Record an edit made since the last parse, in offsets of the
+ * text after any edit recorded before it
+ * @param incremental_ incremental parser created with {{ prefix }}_incremental_new()
+ * @param offset offset of the edit in bytes
+ * @param old_len bytes that were replaced
+ * @param new_len bytes that replaced them
+ */
+void {{ prefix }}_incremental_edit(void* incremental_, uint32_t offset, uint32_t old_len, uint32_t new_len);
+
+/**
+ * Parse the whole text again after the recorded edits. Only the
+ * edited region is lexed, values of the rest are reused from the
+ * last parse. Actions get their arguments read only, they must not
+ * free what the arguments point to either. Values must stay valid
+ * until the incremental parser is freed.
+ * @param incremental_ incremental parser created with {{ prefix }}_incremental_new()
+ * @param input pointer to raw input, the whole text after the edits
+ * @param input_len length of input in bytes
+ * @return top of the generated AST
+ */
+typeof(__{{ prefix }}__t_.{{ start_type }}) {{ prefix }}_incremental_parse(void* error_ctx, void* incremental_,
+                                                                         const char* input, uint32_t input_len);
+
+/**
+ * Count the tokens the last parse had to lex again
+ * @param incremental_ incremental parser created with {{ prefix }}_incremental_new()
+ * @return number of tokens lexed, including the end of the input
+ */
+uint32_t {{ prefix }}_incremental_lexed(void* incremental_);
+
+{% endif %}
+#ifdef NEOAST_STATS
+/**
+ * Counters of every parse run through a session
+ * @param session_ session created with {{ prefix }}_session_new()
+ * @return statistics owned by the session
+ */
+const ParserStats* {{ prefix }}_session_stats(void* session_);
+#endif
+
+/**
+ * Create a push parser for a single stream of input.
+ * Input is fed in with {{ prefix }}_push_bytes() as it arrives
+ * @return push parser to free with {{ prefix }}_push_free()
+ */
+void* {{ prefix }}_push_new();
+
+void {{ prefix }}_push_free(void* push_);
+
+/**
+ * Feed the next chunk of a stream to a push parser. Tokens cut
+ * off by the end of the chunk are held back until more data arrives,
+ * the chunk does not need to outlive this call.
+ * @param push_ push parser created with {{ prefix }}_push_new()
+ * @param input next chunk of the stream
+ * @param input_len length of the chunk in bytes
+ * @param is_final non-zero if this is the last chunk of the stream
+ * @param result set to the top of the generated AST when accepted (may be NULL)
+ * @return NEOAST_PUSH_NEED_MORE until the stream is either accepted or rejected
+ */
+push_status_t {{ prefix }}_push_bytes(void* error_ctx, void* push_,
+                                      const char* input, uint32_t input_len, int is_final,
+                                      typeof(__{{ prefix }}__t_.{{ start_type }})* result);
 
 #ifdef __cplusplus
 }
@@ -142,7 +317,17 @@ void CodeGenImpl::write_source(std::ostream &os, bool dump_license) const
     put_ascii_mappings(os_ascii_mappings);
 
     std::ostringstream os_parsing_table;
-    put_parsing_table(os_parsing_table);
+    table_format_t table_format = put_parsing_table(os_parsing_table);
+
+    std::ostringstream os_direct_parser;
+    if (options.direct_backend)
+    {
+        cg_direct_put_parser(os_direct_parser, "neoast_parse_direct", CODEGEN_STRUCT,
+                             lexer->get_ll_next("ll_inst"), parser.get(),
+                             parsing_table.get(), cc->size(),
+                             options.default_reductions ? default_reductions.get() : nullptr,
+                             grammar->get_actions(options), options.track_position);
+    }
 
     std::ostringstream os_grammar;
     grammar->put_actions(os_grammar);
@@ -192,9 +377,8 @@ void CodeGenImpl::write_source(std::ostream &os, bool dump_license) const
     source_data["lexer"] = os_lexer.str();
     source_data["lexer_top"] = os_lexer_top.str();
     source_data["lexer_bottom"] = os_lexer_bottom.str();
-    source_data["lexer_init"] = lexer->get_init();
-    source_data["lexer_delete"] = lexer->get_delete();
     source_data["lexer_new_inst"] = lexer->get_new_inst("ll_inst");
+    source_data["lexer_reset_inst"] = lexer->get_reset_inst("ll_inst");
     source_data["lexer_del_inst"] = lexer->get_del_inst("ll_inst");
     source_data["lexer_next"] = lexer->get_ll_next("ll_inst");
 
@@ -202,6 +386,11 @@ void CodeGenImpl::write_source(std::ostream &os, bool dump_license) const
     source_data["grammar"] = os_grammar.str();
     source_data["grammar_n"] = grammar->size();
     source_data["action_n"] = action_tokens.size();
+    source_data["direct_backend"] = options.direct_backend;
+    source_data["pipeline"] = options.pipeline;
+    source_data["incremental"] = options.incremental;
+    source_data["track_position"] = options.track_position;
+    source_data["direct_parser"] = os_direct_parser.str();
     source_data["parser_error"] = !options.syntax_error_cb.empty() ? options.syntax_error_cb.c_str() : "NULL";
 
     /* Options */
@@ -214,6 +403,18 @@ void CodeGenImpl::write_source(std::ostream &os, bool dump_license) const
     source_data["tokens"] = tokens_names;
     source_data["ascii_mappings"] = os_ascii_mappings.str();
     source_data["parsing_table"] = os_parsing_table.str();
+    static const char* table_format_names[] = {
+            "TABLE_FORMAT_DENSE",
+            "TABLE_FORMAT_COMPRESSED",
+            "TABLE_FORMAT_SPLIT_8",
+            "TABLE_FORMAT_SPLIT_16",
+            "TABLE_FORMAT_SPLIT_32",
+    };
+    source_data["table_format"] = table_format_names[table_format];
+    source_data["default_reductions"] = options.default_reductions
+                                        ? options.prefix + "_default_reductions" : "NULL";
+    source_data["parsing_table_ref"] = (table_format == TABLE_FORMAT_DENSE ? "" : "&")
+                                       + options.prefix + "_parsing_table";
 
     if (dump_license)
     {
@@ -221,6 +422,8 @@ void CodeGenImpl::write_source(std::ostream &os, bool dump_license) const
     }
 
     os << inja::render(R"(#include <neoast.h>
+#include <lr_priv.h>
+#include <stdlib.h>
 #include <string.h>
 
 #define NEOAST_GET_TOKENS
@@ -259,14 +462,17 @@ uint32_t neoast_ascii_mappings[NEOAST_ASCII_MAX] = {
 
 /***************************** NEOAST DEFINITIONS ********************************/
 static const
-char* neoast_token_names[] = {
+char* const neoast_token_names[] = {
 {%- for name in tokens %}        "{{ name }}",
 {%- endfor -%}
 };
 
 {{ lexer_bottom }}
 
-static GrammarParser parser = {
+/********************************* PARSING TABLE *********************************/
+{{ parsing_table }}
+
+static const GrammarParser parser = {
         .ascii_mappings = neoast_ascii_mappings,
         .grammar_rules = neoast_grammar_rules,
         .token_names = neoast_token_names,
@@ -275,32 +481,26 @@ static GrammarParser parser = {
         .parser_reduce = (parser_reduce) neoast_reduce_handler,
         .grammar_n = {{ grammar_n }},
         .token_n = TOK_AUGMENT - NEOAST_ASCII_MAX,
-        .action_token_n = {{ action_n }}
+        .action_token_n = {{ action_n }},
+        .table_format = {{ table_format }},
+        .default_reductions = {{ default_reductions }},
+        .expected_tokens = {{ prefix }}_expected_tokens
 };
 
-/********************************* PARSING TABLE *********************************/
-{{ parsing_table }}
+{% if direct_backend %}
+/******************************** DIRECT PARSER **********************************/
+{{ direct_parser }}
+{% endif %}
 
 /******************************* PARSER DEFINITIONS ******************************/
-static int parser_initialized = 0;
 uint32_t {{ prefix }}_init()
 {
-    if (!parser_initialized)
-    {
-        {{ lexer_init }}
-        parser_initialized = 1;
-    }
-
+    // Everything above is constant, nothing to set up
     return 0;
 }
 
 void {{ prefix }}_free()
 {
-    if (parser_initialized)
-    {
-        {{ lexer_delete }}
-        parser_initialized = 0;
-    }
 }
 
 void* {{ prefix }}_allocate_buffers()
@@ -309,7 +509,11 @@ void* {{ prefix }}_allocate_buffers()
             {{ max_tokens }},
             {{ parsing_stack_n }},
             sizeof({{ struct_name }}),
+{% if track_position %}
             offsetof({{ struct_name }}, position)
+{% else %}
+            sizeof({{ struct_name }}) // no position after the value
+{% endif %}
     );
 }
 
@@ -334,23 +538,444 @@ typeof(__{{ prefix }}__t_.{{ start_type }}) {{ prefix }}_parse(void* error_ctx,
     return {{ prefix }}_parse_len(error_ctx, buffers_, input, strlen(input));
 }
 
-typeof(__{{ prefix }}__t_.{{ start_type }}) {{ prefix }}_parse_input(void* error_ctx, void* buffers_, NeoastInput* input)
+static void neoast_lines_of_input(ParserBuffers* buffers, NeoastMatcher* ll_inst)
 {
-    ParserBuffers* buffers = (ParserBuffers*) buffers_;
+    // Errors can only be located in
+    // inputs that hold the whole text
+    const NeoastInput* input = ll_inst->in;
+    if (input->type == NEOAST_INPUT_BUFFER)
+    {
+        neoast_lines_reset(buffers->lines, input->impl_.buffer_.cstring_, input->impl_.buffer_.size_);
+    }
+    else
+    {
+        neoast_lines_reset(buffers->lines, NULL, 0);
+    }
+
+    ll_inst->lines = buffers->lines;
+}
+
+static int32_t neoast_parse_index(void* error_ctx, ParserBuffers* buffers, NeoastMatcher* ll_inst)
+{
+    NEOAST_STAT(ll_inst->stats = &buffers->stats);
+    neoast_lines_of_input(buffers, ll_inst);
     parser_reset_buffers(buffers);
 
+{% if direct_backend %}
+    int32_t output_idx = neoast_parse_direct(
+            &parser, error_ctx, {{ parsing_table_ref }},
+            buffers, ll_inst);
+{% else %}
+    // The driver is instantiated here with the table format
+    // and lexer of this grammar, the lexer call is direct
+    int32_t output_idx = parser_parse_lr_impl(
+            &parser, error_ctx, {{ parsing_table_ref }}, {{ table_format }},
+            buffers, ll_inst, {{ lexer_next }}, 0, 0);
+{% endif %}
+
+    return output_idx;
+}
+
+static typeof(__{{ prefix }}__t_.{{ start_type }})
+neoast_parse_lexer(void* error_ctx, ParserBuffers* buffers, NeoastMatcher* ll_inst)
+{
+    int32_t output_idx = neoast_parse_index(error_ctx, buffers, ll_inst);
+    if (output_idx < 0)
+        return (typeof(__{{ prefix }}__t_.{{ start_type }}))0;
+
+    return (({{ struct_name }}*)buffers->value_table)[output_idx].value.{{ start_type }};
+}
+
+{% if pipeline %}
+typeof(__{{ prefix }}__t_.{{ start_type }}) {{ prefix }}_parse_pipelined(void* error_ctx, void* buffers_, const char* input_str, uint32_t input_len)
+{
+    NeoastInput* input = input_new_from_buffer(input_str, input_len);
+    ParserBuffers* buffers = (ParserBuffers*) buffers_;
+
     {{ lexer_new_inst }}
+    NEOAST_STAT(ll_inst->stats = &buffers->stats);
+    neoast_lines_reset(buffers->lines, input_str, input_len);
 
-    int32_t output_idx = parser_parse_lr(
-            &parser, error_ctx, {{ prefix }}_parsing_table,
+    int32_t output_idx = parser_parse_lr_pipelined(
+            &parser, error_ctx, {{ parsing_table_ref }},
             buffers, ll_inst, {{ lexer_next }});
 
+    typeof(__{{ prefix }}__t_.{{ start_type }}) ret = (typeof(__{{ prefix }}__t_.{{ start_type }}))0;
+    if (output_idx >= 0)
+    {
+        ret = (({{ struct_name }}*)buffers->value_table)[output_idx].value.{{ start_type }};
+    }
+
+    {{ lexer_del_inst }}
+    input_free(input);
+    return ret;
+}
+
+{% endif %}
+static int neoast_validate_lexer(void* error_ctx, ParserBuffers* buffers, NeoastMatcher* ll_inst,
+                                TokenPosition* error_position)
+{
+    NEOAST_STAT(ll_inst->stats = &buffers->stats);
+    neoast_lines_of_input(buffers, ll_inst);
+    return parser_validate_lr_impl(
+            &parser, error_ctx, {{ parsing_table_ref }}, {{ table_format }},
+            buffers, ll_inst, {{ lexer_next }},
+            error_position);
+}
+
+typeof(__{{ prefix }}__t_.{{ start_type }}) {{ prefix }}_parse_input(void* error_ctx, void* buffers_, NeoastInput* input)
+{
+    {{ lexer_new_inst }}
+
+    typeof(__{{ prefix }}__t_.{{ start_type }}) ret;
+    ret = neoast_parse_lexer(error_ctx, (ParserBuffers*) buffers_, ll_inst);
+
+    {{ lexer_del_inst }}
+    return ret;
+}
+
+int {{ prefix }}_validate(void* error_ctx, void* buffers_, const char* input_str, uint32_t input_len,
+                          TokenPosition* error_position)
+{
+    NeoastInput* input = input_new_from_buffer(input_str, input_len);
+
+    {{ lexer_new_inst }}
+
+    int ret = neoast_validate_lexer(error_ctx, (ParserBuffers*) buffers_, ll_inst, error_position);
+
+    {{ lexer_del_inst }}
+
+    input_free(input);
+    return ret;
+}
+
+typedef struct
+{
+    ParserBuffers* buffers;
+    NeoastInput* input;
+    NeoastMatcher* lexer;
+    const char* input_str; // Input given to the last reset, to parse it again
+    uint32_t input_len;
+    int suspended; // A budgeted parse is waiting to be resumed
+} NeoastSession;
+
+void* {{ prefix }}_session_new()
+{
+    NeoastSession* self = malloc(sizeof(NeoastSession));
+    NeoastInput* input = input_new_from_buffer(NULL, 0);
+
+    {{ lexer_new_inst }}
+
+    self->buffers = {{ prefix }}_allocate_buffers();
+    NEOAST_STAT(ll_inst->stats = &self->buffers->stats);
+    self->input = input;
+    self->lexer = ll_inst;
+    self->input_str = NULL;
+    self->input_len = 0;
+    self->suspended = 0;
+    return self;
+}
+
+/**
+ * Drop a suspended budgeted parse and rewind the lexer
+ * so that the session parses its input from the start
+ */
+static void neoast_session_rewind(NeoastSession* self)
+{
+    NeoastInput* input = self->input;
+    NeoastMatcher* ll_inst = self->lexer;
+
+    parser_abort_lr(&parser, self->buffers);
+    self->suspended = 0;
+
+    input_set_buffer(input, self->input_str, self->input_len);
+    {{ lexer_reset_inst }}
+}
+
+void {{ prefix }}_session_free(void* session_)
+{
+    NeoastSession* self = (NeoastSession*) session_;
+    NeoastMatcher* ll_inst = self->lexer;
+
+    if (self->suspended)
+    {
+        parser_abort_lr(&parser, self->buffers);
+    }
+
+    {{ lexer_del_inst }}
+
+    input_free(self->input);
+    {{ prefix }}_free_buffers(self->buffers);
+    free(self);
+}
+
+void {{ prefix }}_session_reset(void* session_, const char* input_str, uint32_t input_len)
+{
+    NeoastSession* self = (NeoastSession*) session_;
+    NeoastInput* input = self->input;
+    NeoastMatcher* ll_inst = self->lexer;
+
+    if (self->suspended)
+    {
+        parser_abort_lr(&parser, self->buffers);
+        self->suspended = 0;
+    }
+
+    self->input_str = input_str;
+    self->input_len = input_len;
+    input_set_buffer(input, input_str, input_len);
+    {{ lexer_reset_inst }}
+}
+
+typeof(__{{ prefix }}__t_.{{ start_type }}) {{ prefix }}_session_parse(void* error_ctx, void* session_)
+{
+    NeoastSession* self = (NeoastSession*) session_;
+    if (self->suspended)
+    {
+        neoast_session_rewind(self);
+    }
+
+    return neoast_parse_lexer(error_ctx, self->buffers, self->lexer);
+}
+
+#ifdef NEOAST_STATS
+const ParserStats* {{ prefix }}_session_stats(void* session_)
+{
+    return parser_get_stats(((NeoastSession*) session_)->buffers);
+}
+#endif
+
+int {{ prefix }}_session_validate(void* error_ctx, void* session_, TokenPosition* error_position)
+{
+    NeoastSession* self = (NeoastSession*) session_;
+    if (self->suspended)
+    {
+        neoast_session_rewind(self);
+    }
+
+    return neoast_validate_lexer(error_ctx, self->buffers, self->lexer, error_position);
+}
+
+int {{ prefix }}_session_parse_budget(void* error_ctx, void* session_, uint32_t max_steps,
+                                      typeof(__{{ prefix }}__t_.{{ start_type }})* result)
+{
+    NeoastSession* self = (NeoastSession*) session_;
+    int32_t output_idx;
+
+    // Budgeted parses always drive the table
+    if (self->suspended)
+    {
+        output_idx = parser_resume_lr(&parser, error_ctx, {{ parsing_table_ref }},
+                                      self->buffers, self->lexer, {{ lexer_next }}, max_steps);
+    }
+    else
+    {
+        NEOAST_STAT(self->lexer->stats = &self->buffers->stats);
+        neoast_lines_of_input(self->buffers, self->lexer);
+        output_idx = parser_parse_lr_budget(&parser, error_ctx, {{ parsing_table_ref }},
+                                            self->buffers, self->lexer, {{ lexer_next }}, max_steps);
+    }
+
+    self->suspended = output_idx == NEOAST_PARSE_SUSPENDED;
+    if (output_idx < 0)
+    {
+        return output_idx;
+    }
+
+    if (result)
+    {
+        *result = (({{ struct_name }}*)self->buffers->value_table)[output_idx].value.{{ start_type }};
+    }
+
+    return 0;
+}
+
+typedef struct
+{
+    void* const* error_ctxs;
+    const char* const* inputs;
+    const uint32_t* input_lens;
+    typeof(__{{ prefix }}__t_.{{ start_type }})* results;
+    uint32_t failures;
+} NeoastBatch;
+
+static void neoast_batch_parse(void* batch_, void* session_, uint32_t i)
+{
+    NeoastBatch* batch = (NeoastBatch*) batch_;
+    NeoastSession* session = (NeoastSession*) session_;
+
+    uint32_t input_len = batch->input_lens ? batch->input_lens[i] : strlen(batch->inputs[i]);
+    {{ prefix }}_session_reset(session, batch->inputs[i], input_len);
+
+    void* error_ctx = batch->error_ctxs ? batch->error_ctxs[i] : NULL;
+    int32_t output_idx = neoast_parse_index(error_ctx, session->buffers, session->lexer);
+    if (output_idx < 0)
+    {
+        batch->results[i] = (typeof(__{{ prefix }}__t_.{{ start_type }}))0;
+        __atomic_fetch_add(&batch->failures, 1, __ATOMIC_RELAXED);
+    }
+    else
+    {
+        batch->results[i] = (({{ struct_name }}*)session->buffers->value_table)[output_idx].value.{{ start_type }};
+    }
+}
+
+static void* neoast_batch_session_new(void* batch)
+{
+    (void) batch;
+    return {{ prefix }}_session_new();
+}
+
+uint32_t {{ prefix }}_parse_batch(void* const error_ctxs[], const char* const inputs[], const uint32_t input_lens[],
+                                  uint32_t n, typeof(__{{ prefix }}__t_.{{ start_type }}) results[], uint32_t thread_n)
+{
+    NeoastBatch batch = {
+            .error_ctxs = error_ctxs,
+            .inputs = inputs,
+            .input_lens = input_lens,
+            .results = results,
+            .failures = 0
+    };
+
+    parser_run_batch(n, thread_n, &batch,
+                     neoast_batch_session_new,
+                     {{ prefix }}_session_free,
+                     neoast_batch_parse);
+    return batch.failures;
+}
+
+{% if incremental %}
+typedef struct
+{
+    ParserBuffers* buffers;
+    NeoastInput* input;
+    NeoastMatcher* lexer;
+    NeoastTree* tree;
+} NeoastIncremental;
+
+void* {{ prefix }}_incremental_new()
+{
+    NeoastIncremental* self = malloc(sizeof(NeoastIncremental));
+    NeoastInput* input = input_new_from_buffer(NULL, 0);
+
+    {{ lexer_new_inst }}
+
+    self->buffers = {{ prefix }}_allocate_buffers();
+    NEOAST_STAT(ll_inst->stats = &self->buffers->stats);
+    ll_inst->lines = self->buffers->lines;
+    self->input = input;
+    self->lexer = ll_inst;
+    self->tree = parser_tree_new();
+    return self;
+}
+
+void {{ prefix }}_incremental_free(void* incremental_)
+{
+    NeoastIncremental* self = (NeoastIncremental*) incremental_;
+    NeoastMatcher* ll_inst = self->lexer;
+
     {{ lexer_del_inst }}
 
+    parser_tree_free(self->tree);
+    input_free(self->input);
+    {{ prefix }}_free_buffers(self->buffers);
+    free(self);
+}
+
+void {{ prefix }}_incremental_edit(void* incremental_, uint32_t offset, uint32_t old_len, uint32_t new_len)
+{
+    parser_tree_edit(((NeoastIncremental*) incremental_)->tree, offset, old_len, new_len);
+}
+
+typeof(__{{ prefix }}__t_.{{ start_type }}) {{ prefix }}_incremental_parse(void* error_ctx, void* incremental_,
+                                                                         const char* input, uint32_t input_len)
+{
+    NeoastIncremental* self = (NeoastIncremental*) incremental_;
+    int32_t output_idx = parser_parse_lr_incremental(
+            &parser, error_ctx, {{ parsing_table_ref }},
+            self->buffers, self->tree, input, input_len,
+            self->lexer, {{ lexer_next }});
+
     if (output_idx < 0)
         return (typeof(__{{ prefix }}__t_.{{ start_type }}))0;
 
-    return (({{ struct_name }}*)buffers->value_table)[output_idx].value.{{ start_type }};
+    return (({{ struct_name }}*)self->buffers->value_table)[output_idx].value.{{ start_type }};
+}
+
+uint32_t {{ prefix }}_incremental_lexed(void* incremental_)
+{
+    return parser_tree_lexed(((NeoastIncremental*) incremental_)->tree);
+}
+
+{% endif %}
+typedef struct
+{
+    ParserBuffers* buffers;
+    NeoastInput* input;
+    NeoastMatcher* lexer;
+    push_status_t status;
+} NeoastPushParser;
+
+void* {{ prefix }}_push_new()
+{
+    NeoastPushParser* self = malloc(sizeof(NeoastPushParser));
+    NeoastInput* input = input_new_from_buffer(NULL, 0);
+
+    {{ lexer_new_inst }}
+
+    self->buffers = {{ prefix }}_allocate_buffers();
+    NEOAST_STAT(ll_inst->stats = &self->buffers->stats);
+    self->input = input;
+    self->lexer = ll_inst;
+    self->status = NEOAST_PUSH_NEED_MORE;
+    return self;
+}
+
+void {{ prefix }}_push_free(void* push_)
+{
+    NeoastPushParser* self = (NeoastPushParser*) push_;
+    NeoastMatcher* ll_inst = self->lexer;
+
+    {{ lexer_del_inst }}
+
+    input_free(self->input);
+    {{ prefix }}_free_buffers(self->buffers);
+    free(self);
+}
+
+push_status_t {{ prefix }}_push_bytes(void* error_ctx, void* push_,
+                                      const char* input, uint32_t input_len, int is_final,
+                                      typeof(__{{ prefix }}__t_.{{ start_type }})* result)
+{
+    NeoastPushParser* self = (NeoastPushParser*) push_;
+    if (self->status != NEOAST_PUSH_NEED_MORE)
+    {
+        // This stream has already finished
+        return NEOAST_PUSH_ERROR;
+    }
+
+    input_set_buffer(self->input, input, input_len);
+    matcher_set_partial(self->lexer, !is_final);
+
+    do
+    {
+        int32_t tok = {{ lexer_next }}(self->lexer, parser_push_value(self->buffers), error_ctx);
+        if (tok == NEOAST_LEX_NEED_MORE)
+        {
+            // Chunk is used up
+            return NEOAST_PUSH_NEED_MORE;
+        }
+
+        self->status = parser_push_token(&parser, error_ctx, {{ parsing_table_ref }},
+                                         self->buffers, tok);
+    } while (self->status == NEOAST_PUSH_NEED_MORE);
+
+    if (self->status == NEOAST_PUSH_ACCEPT && result)
+    {
+        *result = (({{ struct_name }}*)self->buffers->value_table)[0].value.{{ start_type }};
+    }
+
+    return self->status;
 }
 
 /************************************ BOTTOM *************************************/
@@ -41,6 +41,11 @@ void emit_warning(const TokenPosition* p, const char* format, ...)
     va_end(args);
 }
 
+int locate_position(const TokenPosition* p, TokenLocation* location)
+{
+    return current_input_file ? current_input_file->locate(p, location) : -1;
+}
+
 uint32_t has_errors()
 {
     return current_input_file ? current_input_file->has_errors() : 0;
@@ -58,10 +63,12 @@ void emit_error(const TokenPosition* p, const char* format, ...)
 void lexing_error_cb(void* ctx,
                      const char* input,
                      const TokenPosition* position,
+                     NeoastLines* lines,
                      const char* lexer_state)
 {
     (void) lexing_error_cb;
     (void) input;
+    (void) lines;
 
     static_cast<InputFile*>(ctx)->emit_error(position, "[state %s] Unmatched token near", lexer_state);
 }
@@ -69,6 +76,7 @@ void lexing_error_cb(void* ctx,
 void parsing_error_cb(void* ctx,
                       const char* const* token_names,
                       const TokenPosition* position,
+                      NeoastLines* lines,
                       uint32_t last_token,
                       uint32_t current_token,
                       const uint32_t expected_tokens[],
@@ -94,7 +102,7 @@ void parsing_error_cb(void* ctx,
 }
 
 InputFile::InputFile(const std::string &file_path)
-: file(nullptr), warn_n(0), err_n(0)
+: file(nullptr), lines(neoast_lines_new()), warn_n(0), err_n(0)
 {
     current_input_file = this;
 
@@ -123,6 +131,7 @@ InputFile::InputFile(const std::string &file_path)
 
     // null terminator
     contents[file_length] = 0;
+    neoast_lines_reset(lines, start, file_length);
 
     size_t line_start = 0;
     char* end = start + file_length;
@@ -151,17 +160,12 @@ InputFile::InputFile(const std::string &file_path)
     }
 }
 
-void InputFile::put_position(std::ostream &os, const TokenPosition* position) const
+void InputFile::put_position(std::ostream &os, const TokenLocation* location, const TokenPosition* position) const
 {
-    if (!position || position->line < 0)
-    {
-        return;
-    }
-
     // Get the number of digits in the line number:
-    int dig_n = snprintf(nullptr, 0, "%+d", position->line);
+    int dig_n = snprintf(nullptr, 0, "%+d", location->line);
 
-    for (int i = (int) position->line - ERROR_CONTEXT_LINE_N; i < (int) position->line; i++)
+    for (int i = (int) location->line - ERROR_CONTEXT_LINE_N; i < (int) location->line; i++)
     {
         if (i < 0)
         {
@@ -174,10 +178,10 @@ void InputFile::put_position(std::ostream &os, const TokenPosition* position) co
                               l_len, line);
     }
 
-    if (position->line > 0)
+    if (location->line > 0)
     {
         size_t len = position->len ? position->len - 1 : position->len;
-        os << std::string(position->col + 3 + dig_n, ' ')
+        os << std::string(location->col + 3 + dig_n, ' ')
            << "\033[1;32m^"
            << std::string(len, '~')
            << "\033[0m\n";
@@ -196,13 +200,14 @@ void InputFile::emit_error_message(const TokenPosition* p, const char* format, .
 {
     va_list args;
     va_start(args, format);
-    if (p)
+    TokenLocation location;
+    if (locate(p, &location) == 0)
     {
         error_stream
-                << variadic_string("\033[1m%s:%d:%d: \033[1;0m ", full_path.c_str(), p->line, p->col + 1)
+                << variadic_string("\033[1m%s:%d:%d: \033[1;0m ", full_path.c_str(), location.line, location.col + 1)
                 << variadic_string(format, args)
                 << "\n";
-        put_position(error_stream, p);
+        put_position(error_stream, &location, p);
     }
     else
     {
@@ -217,13 +222,14 @@ void InputFile::emit_warning_message(const TokenPosition* p, const char* format,
 {
     va_list args;
     va_start(args, format);
-    if (p)
+    TokenLocation location;
+    if (locate(p, &location) == 0)
     {
         warning_stream
-                << variadic_string("\033[1m%s:%d:%d: \033[1;0m ", full_path.c_str(), p->line, p->col + 1)
+                << variadic_string("\033[1m%s:%d:%d: \033[1;0m ", full_path.c_str(), location.line, location.col + 1)
                 << variadic_string(format, args)
                 << "\n";
-        put_position(warning_stream, p);
+        put_position(warning_stream, &location, p);
     }
     else
     {
@@ -244,13 +250,14 @@ void InputFile::emit_warning(const TokenPosition* p, const char* format, ...)
 
 void InputFile::emit_error(const TokenPosition* p, const char* format, va_list args)
 {
-    if (p)
+    TokenLocation location;
+    if (locate(p, &location) == 0)
     {
         error_stream
-                << variadic_string("\033[1m%s:%d:%d: \033[1;31merror:\033[1;0m ", full_path.c_str(), p->line, p->col + 1)
+                << variadic_string("\033[1m%s:%d:%d: \033[1;31merror:\033[1;0m ", full_path.c_str(), location.line, location.col + 1)
                 << variadic_string(format, args)
                 << "\n";
-        put_position(error_stream, p);
+        put_position(error_stream, &location, p);
     }
     else
     {
@@ -263,13 +270,14 @@ void InputFile::emit_error(const TokenPosition* p, const char* format, va_list a
 
 void InputFile::emit_warning(const TokenPosition* p, const char* format, va_list args)
 {
-    if (p)
+    TokenLocation location;
+    if (locate(p, &location) == 0)
     {
         warning_stream
-                << variadic_string("\033[1m%s:%d:%d: \033[1;33mwarning:\033[1;0m ", full_path.c_str(), p->line, p->col + 1)
+                << variadic_string("\033[1m%s:%d:%d: \033[1;33mwarning:\033[1;0m ", full_path.c_str(), location.line, location.col + 1)
                 << variadic_string(format, args)
                 << "\n";
-        put_position(warning_stream, p);
+        put_position(warning_stream, &location, p);
     }
     else
     {
@@ -35,6 +35,7 @@ class InputFile : public Context
     std::unique_ptr<char[]> contents;
     std::vector<size_t> line_starts;
     std::vector<size_t> line_sizes;
+    NeoastLines* lines;
 
     uint32_t warn_n;
     uint32_t err_n;
@@ -42,7 +43,7 @@ class InputFile : public Context
     std::stringstream error_stream;
 
     const char* get_line(uint32_t lineno, size_t &len) const;
-    void put_position(std::ostream& os, const TokenPosition* position) const;
+    void put_position(std::ostream& os, const TokenLocation* location, const TokenPosition* position) const;
 
 public:
     explicit InputFile(const std::string& file_path);
@@ -50,6 +51,7 @@ public:
     ~InputFile()
     {
         if (file) file_free(file);
+        neoast_lines_free(lines);
     }
 
     uint32_t put_errors() const;
@@ -58,6 +60,11 @@ public:
     inline const File* get() const { return file; }
     inline const std::string& get_path() const { return full_path; }
 
+    int locate(const TokenPosition* p, TokenLocation* location) const
+    {
+        return p ? neoast_lines_locate(lines, p->offset, location) : -1;
+    }
+
     void emit_error(const TokenPosition* p, const char* format, va_list args);
     void emit_warning(const TokenPosition* p, const char* format, va_list args);
 
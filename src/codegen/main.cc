@@ -19,15 +19,16 @@
 #include <util/util.h>
 #include <iostream>
 #include <fstream>
+#include <cstring>
 #include "codegen/codegen.h"
 #include "input_file.h"
 #include "codegen_priv.h"
 
 int main(int argc, const char* argv[])
 {
-    if (argc != 4)
+    if (argc < 4)
     {
-        fprintf(stderr, "usage: %s [INPUT_FILE] [OUTPUT_FILE].cc? [OUTPUT_FILE].h\n", argv[0]);
+        fprintf(stderr, "usage: %s [INPUT_FILE] [OUTPUT_FILE].cc? [OUTPUT_FILE].h [KEY=VALUE]...\n", argv[0]);
         return 1;
     }
 
@@ -35,12 +36,30 @@ int main(int argc, const char* argv[])
     const char* output_c = argv[2];
     const char* output_h = argv[3];
 
+    // Trailing arguments override the %option's in the grammar
+    KeyVal* options = nullptr;
+    KeyVal** options_tail = &options;
+    for (int i = 4; i < argc; i++)
+    {
+        const char* eq = strchr(argv[i], '=');
+        if (!eq)
+        {
+            fprintf(stderr, "%s: expected an option as KEY=VALUE, got '%s'\n", argv[0], argv[i]);
+            if (options) key_val_free(options);
+            return 1;
+        }
+
+        *options_tail = key_val_build(&NO_POSITION, KEY_VAL_OPTION,
+                                      strndup(argv[i], eq - argv[i]), strdup(eq + 1));
+        options_tail = &(*options_tail)->next;
+    }
+
     InputFile input(input_file);
     if (has_errors()) goto error;
 
     try
     {
-        CodeGen cg(&input);
+        CodeGen cg(&input, options);
         std::ofstream h(output_h);
         std::ofstream c(output_c);
 
@@ -64,6 +83,7 @@ int main(int argc, const char* argv[])
 //    { emit_error(nullptr, "System exception: %s", e.what()); }
 
 error:
+    if (options) key_val_free(options);
     input.put_errors();
     return (int)has_errors();
 }
@@ -0,0 +1,854 @@
+/*
+ * This file is part of the Neoast framework
+ * Copyright (c) 2021 Andrei Tumbar.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <lr_priv.h>
+#include <lexer/matcher.h>
+#include <stdlib.h>
+#include <alloca.h>
+
+/*
+ * Incremental LR parsing with subtree reuse (Wagner & Graham).
+ *
+ * Every shifted token and every reduction is kept as a node of a
+ * tree that outlives the parse. Nodes only store lengths so that a
+ * subtree can be moved around the text by an edit without being
+ * touched. The next parse reads the old tree instead of the lexer:
+ * a subtree is shifted whole if none of the input it looked at was
+ * edited and the parser is in the state the subtree was shifted in.
+ * Otherwise it is broken down into its children. Only the edited
+ * region is lexed again.
+ *
+ * Nodes are shared between the old and the new tree and are
+ * reference counted. Values of reused nodes are copied back onto
+ * the value stack so the actions see them like any other value.
+ * Actions get their arguments read only, the same value is handed
+ * to the actions of every parse that breaks its parent down.
+ */
+
+typedef struct NeoastNode_prv NeoastNode;
+typedef struct NeoastCursor_prv NeoastCursor;
+typedef struct NeoastReparse_prv NeoastReparse;
+
+#define NODE_VALUE_ALIGN (16)
+
+// Arena bytes the edits may allocate on top of the
+// last parse from scratch before starting over
+#define TREE_ARENA_SLACK (64 * 1024)
+
+struct NeoastNode_prv
+{
+    uint32_t refs;          //!< Parents and parse stack slots holding this node
+    int32_t tok;            //!< Token id, terminals are below action_token_n
+    uint32_t state;         //!< State the node was shifted in
+    uint32_t child_n;       //!< Number of children, 0 for terminals and empty rules
+    int32_t first_tok;      //!< Leftmost terminal of the subtree, 0 if it spans nothing
+    uint32_t len;           //!< Bytes spanned including the whitespace before the first token
+    uint32_t ext;           //!< Bytes after the node that were looked at to build it
+    uint32_t first_end;     //!< Bytes from the start that were looked at to lex the first token
+    uint32_t lead;          //!< Bytes before the first token
+    char* value;            //!< Value of the node (val_s bytes)
+    NeoastNode* children[];
+};
+
+/**
+ * Position in the old tree, one frame per level
+ * the reader went down into
+ */
+struct NeoastCursor_prv
+{
+    NeoastNode* const* children;
+    uint32_t n;
+    uint32_t i;
+    uint32_t start;         //!< Offset of children[i] in the old text
+};
+
+struct NeoastTree_prv
+{
+    NeoastNode* root;
+
+    // Damage since the last successful parse, in
+    // offsets of the old text and of the new text
+    int edited;
+    uint32_t edit_start;
+    uint32_t edit_old_end;
+    uint32_t edit_new_end;
+
+    // Nodes and start offsets parallel to the value table
+    NeoastNode** nodes;
+    uint32_t* starts;
+    uint32_t slot_n;
+
+    NeoastCursor* cursor;
+    uint32_t cursor_n;
+
+    NeoastNode** release;
+    uint32_t release_n;
+
+    size_t arena_base;      //!< Arena bytes used by the last parse from scratch
+    uint32_t lexed;         //!< Tokens lexed by the last parse
+};
+
+typedef enum
+{
+    ITEM_NONE,
+    ITEM_TOKEN,             //!< Token that was just lexed
+    ITEM_NODE,              //!< Subtree of the old tree
+} item_t;
+
+struct NeoastReparse_prv
+{
+    const GrammarParser* parser;
+    void* context;
+    ParserBuffers* buffers;
+    NeoastTree* tree;
+    const char* input;
+    uint32_t input_len;
+    NeoastMatcher* lexer;
+    int (*ll_next)(void*, void*, void*);
+
+    uint32_t start;         //!< Start of the damage, same offset in both texts
+    uint32_t old_end;       //!< End of the damage in the old text
+    int64_t delta;          //!< Bytes added by the edit
+
+    uint32_t pos;           //!< Offset right after the last shifted token
+    uint32_t depth;         //!< Frames in use in the cursor
+    int lexing;
+
+    item_t item;
+    NeoastNode* node;       //!< ITEM_NODE
+    int32_t tok;            //!< ITEM_TOKEN
+    uint32_t tok_start;
+    uint32_t tok_end;
+    uint32_t tok_lah;
+    char* la_val;
+};
+
+NeoastTree* parser_tree_new(void)
+{
+    NeoastTree* self = calloc(1, sizeof(NeoastTree));
+    return self;
+}
+
+static int tree_reserve_release(NeoastTree* self, uint32_t n)
+{
+    if (n <= self->release_n)
+    {
+        return 0;
+    }
+
+    uint32_t release_n = self->release_n ? self->release_n : 64;
+    while (release_n < n)
+    {
+        release_n <<= 1;
+    }
+
+    NeoastNode** release = realloc(self->release, sizeof(NeoastNode*) * release_n);
+    if (!release)
+    {
+        return -1;
+    }
+
+    self->release = release;
+    self->release_n = release_n;
+    return 0;
+}
+
+/**
+ * Drop a reference to a node, nodes that are left
+ * without any are freed along with their children
+ * Trees are often as deep as they are long, so this
+ * doesn't recurse.
+ * @return 0 on success, -1 if memory ran out and part of the subtree was leaked
+ */
+static int tree_release(NeoastTree* self, NeoastNode* node)
+{
+    if (--node->refs)
+    {
+        return 0;
+    }
+
+    uint32_t n = 0;
+    if (tree_reserve_release(self, 1) != 0)
+    {
+        return -1;
+    }
+
+    self->release[n++] = node;
+    while (n)
+    {
+        node = self->release[--n];
+        if (tree_reserve_release(self, n + node->child_n) != 0)
+        {
+            return -1;
+        }
+
+        for (uint32_t i = 0; i < node->child_n; i++)
+        {
+            if (--node->children[i]->refs == 0)
+            {
+                self->release[n++] = node->children[i];
+            }
+        }
+
+        free(node);
+    }
+
+    return 0;
+}
+
+void parser_tree_free(NeoastTree* self)
+{
+    if (self->root)
+    {
+        // Nothing left to report a failure to
+        (void) tree_release(self, self->root);
+    }
+
+    free(self->nodes);
+    free(self->starts);
+    free(self->cursor);
+    free(self->release);
+    free(self);
+}
+
+uint32_t parser_tree_lexed(const NeoastTree* self)
+{
+    return self->lexed;
+}
+
+void parser_tree_edit(NeoastTree* self, uint32_t offset, uint32_t old_len, uint32_t new_len)
+{
+    if (!self->root)
+    {
+        // Nothing to reuse, the next parse starts from scratch
+        return;
+    }
+
+    uint32_t start = offset;
+    uint32_t old_end = offset + old_len;
+    uint32_t new_end = offset + new_len;
+
+    if (self->edited)
+    {
+        // This edit is in offsets of the text after the pending
+        // one, fold both into a single edit of the parsed text
+        int64_t pending_delta = (int64_t) self->edit_new_end - self->edit_old_end;
+        int64_t delta = (int64_t) new_end - old_end;
+
+        old_end = old_end >= self->edit_new_end ? (uint32_t) (old_end - pending_delta) : self->edit_old_end;
+        old_end = old_end > self->edit_old_end ? old_end : self->edit_old_end;
+        new_end = self->edit_new_end >= offset + old_len ? (uint32_t) (self->edit_new_end + delta) : new_end;
+        start = self->edit_start < start ? self->edit_start : start;
+    }
+
+    self->edited = 1;
+    self->edit_start = start;
+    self->edit_old_end = old_end;
+    self->edit_new_end = new_end;
+}
+
+static int tree_reserve_slots(NeoastTree* self, uint32_t n)
+{
+    if (n <= self->slot_n)
+    {
+        return 0;
+    }
+
+    NeoastNode** nodes = realloc(self->nodes, sizeof(NeoastNode*) * n);
+    if (!nodes)
+    {
+        return -1;
+    }
+
+    self->nodes = nodes;
+    uint32_t* starts = realloc(self->starts, sizeof(uint32_t) * n);
+    if (!starts)
+    {
+        return -1;
+    }
+
+    self->starts = starts;
+    self->slot_n = n;
+    return 0;
+}
+
+static int tree_reserve_cursor(NeoastTree* self, uint32_t n)
+{
+    if (n <= self->cursor_n)
+    {
+        return 0;
+    }
+
+    uint32_t cursor_n = self->cursor_n ? self->cursor_n << 1 : 64;
+    NeoastCursor* cursor = realloc(self->cursor, sizeof(NeoastCursor) * cursor_n);
+    if (!cursor)
+    {
+        return -1;
+    }
+
+    self->cursor = cursor;
+    self->cursor_n = cursor_n;
+    return 0;
+}
+
+static NeoastNode* node_new(uint32_t child_n, uint32_t val_s)
+{
+    size_t value_off = sizeof(NeoastNode) + sizeof(NeoastNode*) * child_n;
+    value_off = (value_off + NODE_VALUE_ALIGN - 1) & ~(size_t) (NODE_VALUE_ALIGN - 1);
+
+    NeoastNode* self = malloc(value_off + val_s);
+    if (!self)
+    {
+        return NULL;
+    }
+
+    self->refs = 1;
+    self->child_n = child_n;
+    self->value = (char*) self + value_off;
+    return self;
+}
+
+/**
+ * Move the position of a value to where its first token is now
+ * Values that never had a position (empty rules) are left alone.
+ */
+static void reparse_position(NeoastReparse* self, char* value, uint32_t lead)
+{
+    if (self->buffers->union_s == self->buffers->val_s)
+    {
+        return;
+    }
+
+    TokenPosition* p = (TokenPosition*) (value + self->buffers->union_s);
+    if (p->len)
+    {
+        p->offset = self->pos + lead;
+    }
+}
+
+static NeoastNode* cursor_peek(const NeoastReparse* self, uint32_t* start)
+{
+    if (!self->depth)
+    {
+        return NULL;
+    }
+
+    const NeoastCursor* top = &self->tree->cursor[self->depth - 1];
+    *start = top->start;
+    return top->children[top->i];
+}
+
+static void cursor_normalize(NeoastReparse* self)
+{
+    while (self->depth)
+    {
+        NeoastCursor* top = &self->tree->cursor[self->depth - 1];
+        if (top->i < top->n)
+        {
+            return;
+        }
+
+        self->depth--;
+    }
+}
+
+static void cursor_advance(NeoastReparse* self)
+{
+    NeoastCursor* top = &self->tree->cursor[self->depth - 1];
+    top->start += top->children[top->i]->len;
+    top->i++;
+    cursor_normalize(self);
+}
+
+static int cursor_descend(NeoastReparse* self)
+{
+    NeoastTree* tree = self->tree;
+    if (tree_reserve_cursor(tree, self->depth + 1) != 0)
+    {
+        return -1;
+    }
+
+    NeoastCursor* top = &tree->cursor[self->depth - 1];
+    const NeoastNode* node = top->children[top->i];
+    NeoastCursor* frame = &tree->cursor[self->depth++];
+    frame->children = node->children;
+    frame->n = node->child_n;
+    frame->i = 0;
+    frame->start = top->start;
+
+    top->start += node->len;
+    top->i++;
+    cursor_normalize(self);
+    return 0;
+}
+
+static int reparse_lex(NeoastReparse* self)
+{
+    int32_t tok = self->ll_next(self->lexer, self->la_val, self->context);
+    if (tok < 0)
+    {
+        return -1;
+    }
+
+    NEOAST_STAT(self->buffers->stats.tokens++);
+    self->tree->lexed++;
+    self->item = ITEM_TOKEN;
+    self->tok = tok;
+    self->tok_end = (uint32_t) matcher_offset(self->lexer);
+    self->tok_lah = (uint32_t) matcher_lookahead(self->lexer);
+    self->tok_start = tok ? self->tok_end - (uint32_t) matcher_size(self->lexer) : self->tok_end;
+
+    // The lexer keeps counting offsets from the start of the text,
+    // only the end of the input needs a position
+    if (!tok && self->buffers->union_s < self->buffers->val_s)
+    {
+        TokenPosition* p = (TokenPosition*) (self->la_val + self->buffers->union_s);
+        p->offset = self->tok_end;
+        p->len = 0;
+    }
+
+    return 0;
+}
+
+static void reparse_start_lexing(NeoastReparse* self)
+{
+    self->lexing = 1;
+    matcher_set_buffer_at(self->lexer, self->input, self->input_len, self->pos);
+}
+
+/**
+ * Get the next subtree or token to parse
+ * Subtrees of the old tree are used until one is hit that
+ * depends on the edit. The lexer then runs until it gets
+ * back in step with a subtree after the edit.
+ * @return 0 on success, -1 on a lexing error
+ */
+static int reparse_next(NeoastReparse* self)
+{
+    while (1)
+    {
+        uint32_t start;
+        NeoastNode* node = cursor_peek(self, &start);
+        if (node && !node->len)
+        {
+            // Empty rules are reduced again as needed
+            cursor_advance(self);
+            continue;
+        }
+
+        if (self->lexing)
+        {
+            if (!node)
+            {
+                return reparse_lex(self);
+            }
+
+            // The character before the subtree has to be the same too,
+            // it sets up anchors and word boundaries in the lexer
+            if (start > self->old_end && start + self->delta >= self->pos)
+            {
+                if (start + self->delta > self->pos)
+                {
+                    return reparse_lex(self);
+                }
+
+                // Back in step with the old tree
+                self->lexing = 0;
+                self->item = ITEM_NODE;
+                self->node = node;
+                return 0;
+            }
+
+            if (node->child_n
+                && start + node->len > self->old_end
+                && start + node->len + self->delta > self->pos)
+            {
+                // Part of this subtree is still ahead
+                if (cursor_descend(self) != 0)
+                {
+                    return -1;
+                }
+            }
+            else
+            {
+                cursor_advance(self);
+            }
+
+            continue;
+        }
+
+        if (!node)
+        {
+            reparse_start_lexing(self);
+            continue;
+        }
+
+        if (start + node->len + node->ext <= self->start
+            || start > self->old_end)
+        {
+            // Nothing this subtree depends on was edited
+            assert(start + (start < self->start ? 0 : self->delta) == self->pos);
+            self->item = ITEM_NODE;
+            self->node = node;
+            return 0;
+        }
+
+        if (node->child_n)
+        {
+            if (cursor_descend(self) != 0)
+            {
+                return -1;
+            }
+        }
+        else
+        {
+            // Relex from the start of this token
+            reparse_start_lexing(self);
+        }
+    }
+}
+
+static int reparse_reserve(NeoastReparse* self, uint32_t i)
+{
+    if (g_lr_reserve(self->buffers, i) != 0
+        || tree_reserve_slots(self->tree, self->buffers->table_n) != 0)
+    {
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * Shift the current item into slot i
+ */
+static int reparse_shift(NeoastReparse* self, uint32_t i, uint32_t state, uint32_t next_state)
+{
+    if (reparse_reserve(self, i) != 0)
+    {
+        return -1;
+    }
+
+    ParserBuffers* buffers = self->buffers;
+    NeoastNode* node;
+    if (self->item == ITEM_NODE)
+    {
+        node = self->node;
+        node->refs++;
+        cursor_advance(self);
+        buffers->token_table[i] = node->tok;
+        memcpy(OFFSET_VOID_PTR(buffers->value_table, buffers->val_s, i), node->value, buffers->val_s);
+        reparse_position(self, OFFSET_VOID_PTR(buffers->value_table, buffers->val_s, i), node->lead);
+    }
+    else
+    {
+        node = node_new(0, buffers->val_s);
+        if (!node)
+        {
+            return -1;
+        }
+
+        node->tok = self->tok;
+        node->state = state;
+        node->first_tok = self->tok;
+        node->len = self->tok_end - self->pos;
+        node->ext = self->tok_lah - self->tok_end;
+        node->first_end = node->len + node->ext;
+        node->lead = self->tok_start - self->pos;
+        memcpy(node->value, self->la_val, buffers->val_s);
+
+        buffers->token_table[i] = self->tok;
+        memcpy(OFFSET_VOID_PTR(buffers->value_table, buffers->val_s, i), self->la_val, buffers->val_s);
+    }
+
+    self->tree->nodes[i] = node;
+    self->tree->starts[i] = self->pos;
+    self->pos += node->len;
+    self->item = ITEM_NONE;
+
+    NEOAST_STACK_PUSH(buffers->parsing_stack, i);
+    NEOAST_STACK_PUSH(buffers->parsing_stack, next_state);
+    NEOAST_STAT(buffers->stats.shifts++);
+    NEOAST_STAT(parser_stats_max(&buffers->stats.max_depth, buffers->parsing_stack->pos >> 1));
+    return 0;
+}
+
+/**
+ * Reduce a rule and keep the result as a node
+ * @return next state, -1 if memory ran out
+ */
+static int64_t reparse_reduce(NeoastReparse* self, const void* parsing_table, uint32_t reduce_value,
+                              int has_lookahead)
+{
+    const GrammarParser* parser = self->parser;
+    ParserBuffers* buffers = self->buffers;
+    NeoastTree* tree = self->tree;
+    const GrammarRule* rule = &parser->grammar_rules[reduce_value & TOK_MASK];
+
+    if (rule->tok_n == 0 && reparse_reserve(self, buffers->parsing_stack->pos >> 1) != 0)
+    {
+        return -1;
+    }
+
+    NeoastNode* node = node_new(rule->tok_n, buffers->val_s);
+    if (!node)
+    {
+        return -1;
+    }
+
+    ParsingStack* stack = buffers->parsing_stack;
+    uint32_t idx = (stack->pos >> 1) - rule->tok_n;
+    uint32_t start = rule->tok_n ? tree->starts[idx] : self->pos;
+
+    node->tok = (int32_t) rule->token - NEOAST_ASCII_MAX;
+    node->state = stack->data[stack->pos - (rule->tok_n << 1) - 1];
+    node->first_tok = 0;
+    node->len = self->pos - start;
+    node->first_end = 0;
+    node->lead = 0;
+
+    // Everything the children looked at and the
+    // lookahead that decided this reduction
+    uint32_t ext_end = self->pos;
+    for (uint32_t k = 0; k < rule->tok_n; k++)
+    {
+        NeoastNode* child = tree->nodes[idx + k];
+        uint32_t child_end = tree->starts[idx + k] + child->len + child->ext;
+        ext_end = child_end > ext_end ? child_end : ext_end;
+
+        if (!node->first_tok && child->first_tok)
+        {
+            node->first_tok = child->first_tok;
+            node->first_end = tree->starts[idx + k] - start + child->first_end;
+            node->lead = tree->starts[idx + k] - start + child->lead;
+        }
+
+        node->children[k] = child;
+    }
+
+    if (has_lookahead)
+    {
+        uint32_t la_end = self->item == ITEM_NODE ? self->pos + self->node->first_end : self->tok_lah;
+        ext_end = la_end > ext_end ? la_end : ext_end;
+    }
+
+    node->ext = ext_end - self->pos;
+
+    uint32_t dest_idx;
+    uint32_t next_state = g_lr_reduce(parser, self->context, parsing_table, parser->table_format,
+                                      reduce_value, buffers, &dest_idx);
+    NEOAST_STAT(parser_stats_reduce(&buffers->stats, reduce_value & TOK_MASK));
+
+    assert(dest_idx == idx);
+    memcpy(node->value, OFFSET_VOID_PTR(buffers->value_table, buffers->val_s, idx), buffers->val_s);
+    tree->nodes[idx] = node;
+    tree->starts[idx] = start;
+    return next_state;
+}
+
+static void reparse_drop_stack(NeoastReparse* self)
+{
+    ParsingStack* stack = self->buffers->parsing_stack;
+    for (uint32_t i = 0; i < stack->pos >> 1; i++)
+    {
+        // The parse already failed
+        (void) tree_release(self->tree, self->tree->nodes[i]);
+    }
+
+    stack->pos = 0;
+}
+
+int32_t parser_parse_lr_incremental(const GrammarParser* parser,
+                                    void* context,
+                                    const void* parsing_table,
+                                    ParserBuffers* buffers,
+                                    NeoastTree* tree,
+                                    const char* input,
+                                    uint32_t input_len,
+                                    void* lexer,
+                                    int ll_next(void*, void*, void*))
+{
+    NeoastReparse self = {
+            .parser = parser,
+            .context = context,
+            .buffers = buffers,
+            .tree = tree,
+            .input = input,
+            .input_len = input_len,
+            .lexer = lexer,
+            .ll_next = ll_next,
+            .start = UINT32_MAX,
+            .old_end = UINT32_MAX,
+            .delta = 0,
+            .item = ITEM_NONE,
+    };
+
+    // Values of reused nodes may live in the arena, it is only
+    // reset by a parse from scratch. Start over once the edits
+    // allocated as much again as that parse did.
+    if (tree->root && neoast_arena_used(buffers->arena) > 2 * tree->arena_base + TREE_ARENA_SLACK)
+    {
+        NeoastNode* old_root = tree->root;
+        tree->root = NULL;
+        tree->edited = 0;
+        if (tree_release(tree, old_root) != 0)
+        {
+            return -1;
+        }
+    }
+
+    tree->lexed = 0;
+    NeoastNode* const* root = &tree->root;
+    if (!tree->root)
+    {
+        // Values of the last parse are gone
+        neoast_arena_reset(buffers->arena);
+        reparse_start_lexing(&self);
+    }
+    else
+    {
+        if (tree->edited)
+        {
+            self.start = tree->edit_start;
+            self.old_end = tree->edit_old_end;
+            self.delta = (int64_t) tree->edit_new_end - tree->edit_old_end;
+        }
+
+        if (tree_reserve_cursor(tree, 1) != 0)
+        {
+            return -1;
+        }
+
+        NeoastCursor* frame = &tree->cursor[0];
+        frame->children = root;
+        frame->n = 1;
+        frame->i = 0;
+        frame->start = 0;
+        self.depth = 1;
+    }
+
+    self.la_val = alloca(buffers->val_s);
+    parser_reset_buffers(buffers);
+    neoast_lines_reset(buffers->lines, input, input_len);
+    ParsingStack* stack = buffers->parsing_stack;
+    NEOAST_STACK_PUSH(stack, 0);
+
+    uint32_t current_state = 0;
+    while (1)
+    {
+        uint32_t reduce_value;
+        int has_lookahead = 0;
+        if (parser->default_reductions && parser->default_reductions[current_state])
+        {
+            reduce_value = parser->default_reductions[current_state];
+        }
+        else
+        {
+            if (self.item == ITEM_NONE && reparse_next(&self) != 0)
+            {
+                break;
+            }
+
+            int32_t tok = self.item == ITEM_NODE ? self.node->first_tok : self.tok;
+            uint32_t table_value = g_table_lookup(parsing_table, parser->table_format,
+                                                  current_state, tok, parser);
+            int is_subtree = self.item == ITEM_NODE && self.node->tok >= (int32_t) parser->action_token_n;
+
+            if (is_subtree
+                && (table_value == TOK_SYNTAX_ERROR
+                    || ((table_value & TOK_SHIFT_MASK) && self.node->state != current_state)))
+            {
+                // The subtree can't be used as is, try its children
+                self.item = ITEM_NONE;
+                if (cursor_descend(&self) != 0)
+                {
+                    break;
+                }
+
+                continue;
+            }
+
+            if (table_value == TOK_SYNTAX_ERROR)
+            {
+                if (self.item == ITEM_NODE)
+                {
+                    memcpy(self.la_val, self.node->value, buffers->val_s);
+                    reparse_position(&self, self.la_val, self.node->lead);
+                }
+
+                stack = buffers->parsing_stack;
+                parser_syntax_error(parser, context, parsing_table,
+                                    g_lr_position(buffers, self.la_val), buffers->lines,
+                                    stack->data, (stack->pos + 1) >> 1, 2, tok,
+                                    stack->pos > 1 ? buffers->token_table[stack->data[stack->pos - 2]] : 0);
+                break;
+            }
+            else if (table_value & TOK_SHIFT_MASK)
+            {
+                uint32_t next_state = table_value & TOK_MASK;
+                if (is_subtree)
+                {
+                    next_state = g_table_lookup(parsing_table, parser->table_format,
+                                                current_state, self.node->tok, parser) & TOK_MASK;
+                }
+
+                if (reparse_shift(&self, buffers->parsing_stack->pos >> 1, current_state, next_state) != 0)
+                {
+                    break;
+                }
+
+                current_state = next_state;
+                continue;
+            }
+            else if (table_value & TOK_ACCEPT_MASK)
+            {
+                // Keep the new tree and drop what is left of the old one
+                stack = buffers->parsing_stack;
+                int32_t result = (int32_t) stack->data[stack->pos - 2];
+                NeoastNode* old_root = tree->root;
+                tree->root = tree->nodes[result];
+                tree->edited = 0;
+                if (!old_root)
+                {
+                    tree->arena_base = neoast_arena_used(buffers->arena);
+                }
+                else if (tree_release(tree, old_root) != 0)
+                {
+                    return -1;
+                }
+
+                return result;
+            }
+
+            reduce_value = table_value;
+            has_lookahead = 1;
+        }
+
+        int64_t next_state = reparse_reduce(&self, parsing_table, reduce_value, has_lookahead);
+        if (next_state < 0)
+        {
+            break;
+        }
+
+        current_state = (uint32_t) next_state;
+    }
+
+    // The old tree and the pending edit are kept for the next try
+    reparse_drop_stack(&self);
+    return -1;
+}
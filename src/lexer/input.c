@@ -19,6 +19,9 @@
 #include <string.h>
 #include <malloc.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include "lexer/input.h"
 
 #if defined(WITH_STANDARD_REPLACEMENT_CHARACTER)
@@ -389,6 +392,7 @@ NeoastInput* input_new_from_file(FILE* fp)
 static void input_file_init(struct FileHandle* this, file_encoding_type_t enc)
 {
     struct stat st;
+    this->size_ = 0;
     if (fstat(fileno(this->file_), &st) == 0 && S_ISREG(st.st_mode) && st.st_size <= 4294967295LL)
         this->size_ = (size_t)(st.st_size);
 
@@ -483,10 +487,18 @@ static void input_file_init(struct FileHandle* this, file_encoding_type_t enc)
     }
 }
 
+static inline void input_init(NeoastInput* self, input_t type)
+{
+    self->type = type;
+    self->map_ = NULL;
+    self->map_len_ = 0;
+    self->own_file_ = FALSE;
+}
+
 NeoastInput* input_new_from_file_and_encoding(FILE* fp, file_encoding_type_t encoding)
 {
     NeoastInput* self = malloc(sizeof(NeoastInput));
-    self->type = NEOAST_INPUT_FILE;
+    input_init(self, NEOAST_INPUT_FILE);
     struct FileHandle* this = &self->impl_.file_;
     memset(this->utf8_, 0, sizeof(this->utf8_));
     this->uidx_ = 0;
@@ -500,18 +512,95 @@ NeoastInput* input_new_from_file_and_encoding(FILE* fp, file_encoding_type_t enc
 NeoastInput* input_new_from_buffer(const char* str, size_t len)
 {
     NeoastInput* self = malloc(sizeof(NeoastInput));
+    input_init(self, NEOAST_INPUT_BUFFER);
     self->impl_.buffer_.cstring_ = str;
     self->impl_.buffer_.size_ = len;
-    self->type = NEOAST_INPUT_BUFFER;
     return self;
 }
 
+/// Map a regular file that can be lexed as is.
+/// @returns mapped input or NULL to stream the file
+static NeoastInput* input_map_file(int fd)
+{
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode))
+        return NULL;
+
+    size_t len = (size_t) st.st_size;
+    void* map = NULL;
+    if (len > 0)
+    {
+        map = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map == MAP_FAILED)
+            return NULL;
+    }
+
+    const char* str = map;
+    size_t skip = 0;
+    if (len >= 3 && memcmp(str, "\xef\xbb\xbf", 3) == 0)
+    {
+        // UTF-8 BOM is dropped the same way a streamed file drops it
+        skip = 3;
+    }
+    else if (len >= 2 && (memcmp(str, "\xfe\xff", 2) == 0
+                          || memcmp(str, "\xff\xfe", 2) == 0
+                          || (len >= 4 && memcmp(str, "\0\0\xfe\xff", 4) == 0)))
+    {
+        // UTF-16/32 is converted while it is read
+        munmap(map, len);
+        return NULL;
+    }
+
+    if (map)
+    {
+        madvise(map, len, MADV_SEQUENTIAL);
+    }
+
+    NeoastInput* self = input_new_from_buffer(map ? str + skip : NULL, len - skip);
+    self->map_ = map;
+    self->map_len_ = len;
+    return self;
+}
+
+NeoastInput* input_new_from_path_mmap(const char* path)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return NULL;
+
+    NeoastInput* self = input_map_file(fd);
+    if (self)
+    {
+        // The mapping stays valid without the descriptor
+        close(fd);
+        return self;
+    }
+
+    FILE* fp = fdopen(fd, "rb");
+    if (!fp)
+    {
+        close(fd);
+        return NULL;
+    }
+
+    self = input_new_from_file(fp);
+    self->own_file_ = TRUE;
+    return self;
+}
+
+void input_set_buffer(NeoastInput* self, const char* str, size_t len)
+{
+    assert(self->type == NEOAST_INPUT_BUFFER);
+    self->impl_.buffer_.cstring_ = str;
+    self->impl_.buffer_.size_ = len;
+}
+
 NeoastInput* input_new_from_custom(void* ptr, neoast_input_get get)
 {
     NeoastInput* self = malloc(sizeof(NeoastInput));
+    input_init(self, NEOAST_INPUT_CUSTOM);
     self->impl_.custom_.ptr = ptr;
     self->impl_.custom_.get = get;
-    self->type = NEOAST_INPUT_CUSTOM;
     return self;
 }
 
@@ -529,6 +618,15 @@ void input_free(NeoastInput* self)
             break;
     }
 
+    if (self->map_)
+    {
+        munmap(self->map_, self->map_len_);
+    }
+    if (self->own_file_)
+    {
+        fclose(self->impl_.file_.file_);
+    }
+
     free(self);
 }
 
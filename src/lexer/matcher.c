@@ -29,6 +29,12 @@
 #include "lexer/matcher.h"
 #include "lexer/matcher_priv.h"
 
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+// Vector units are picked at runtime, the kernels are compiled for each one
+#define NEOAST_SIMD_X86
+#include <immintrin.h>
+#endif
+
 static inline void matcher_reset_text(NeoastMatcher* self);
 static inline size_t matcher_get_1(NeoastMatcher* self, char* s, size_t n);
 static inline void matcher_set_current(NeoastMatcher* self, size_t loc);
@@ -57,6 +63,10 @@ static inline void option_init(struct Option* self)
 
 void matcher_init(NeoastMatcher* self)
 {
+    self->own_ = NULL;
+    self->max_ = 0;
+    NEOAST_STAT(self->stats = NULL);
+    self->lines = NULL;
     matcher_context_init(&self->context_);
     fsm_init(&self->fsm_);
     matcher_reset(self);
@@ -64,18 +74,20 @@ void matcher_init(NeoastMatcher* self)
 
     neoast_vector_init(&self->lap_, sizeof(int));
     neoast_vector_init(&self->tab_, sizeof(size_t));
+    neoast_vector_init(&self->text_, sizeof(char));
     self->lexing_state = parser_allocate_stack(32);
 }
 
 void matcher_destroy(NeoastMatcher* self)
 {
-    if (self->buf_)
+    if (self->own_)
     {
-        free(self->buf_);
-        self->buf_ = NULL;
+        free(self->own_);
+        self->own_ = NULL;
     }
     neoast_vector_free(&self->lap_);
     neoast_vector_free(&self->tab_);
+    neoast_vector_free(&self->text_);
     parser_free_stack(self->lexing_state);
 }
 
@@ -94,18 +106,31 @@ void matcher_free(NeoastMatcher* self)
     free(self);
 }
 
+void matcher_set_input(NeoastMatcher* self, NeoastInput* input)
+{
+    self->in = input;
+    matcher_context_init(&self->context_);
+    fsm_init(&self->fsm_);
+    matcher_reset(self);
+    self->lexing_state->pos = 0;
+}
+
 void matcher_reset(NeoastMatcher* self)
 {
-    self->buf_ = NULL;
-    self->max_ = 2 * CONST_BLOCK;
-    if (posix_memalign((void**) &self->buf_, 4096, self->max_) != 0)
+    // Keep the buffer from the last input, it may have grown.
+    // It is only allocated once an input can't be scanned in place.
+    if (self->own_)
+    {
+        self->buf_ = self->own_;
+        self->buf_[0] = '\0';
+    }
+    else
     {
-        perror("memalign() - matcher buffer");
-        abort();
+        self->buf_ = (char*) "";
     }
 
-    self->buf_[0] = '\0';
     self->txt_ = self->buf_;
+    self->text_.n = 0;
     self->len_ = 0;
     self->cap_ = 0;
     self->cur_ = 0;
@@ -115,17 +140,13 @@ void matcher_reset(NeoastMatcher* self)
     self->blk_ = 0;
     self->got_ = CONST_BOB;
     self->chr_ = '\0';
-#if defined(WITH_SPAN)
-    self->bol_ = self->buf_;
-    self->evh_ = NULL;
-#endif
     self->lpb_ = self->buf_;
     self->lno_ = 1;
-#if !defined(WITH_SPAN)
     self->cno_ = 0;
-#endif
     self->num_ = 0;
+    self->lah_ = 0;
     self->eof_ = FALSE;
+    self->partial_ = FALSE;
 
     self->ded_ = 0;
     self->tab_.n = 0;
@@ -163,6 +184,11 @@ size_t matcher_scan(NeoastMatcher* self, NeoastPatternFSM fsm)
     nul = self->fsm_.nul;
     c1 = self->fsm_.c1;
 
+    // Everything up to and including the character after the
+    // last one read may have decided this match (peeks, EOF)
+    if (self->num_ + self->pos_ + 1 > self->lah_)
+        self->lah_ = self->num_ + self->pos_ + 1;
+
 #if !defined(WITH_NO_INDENT)
     if (self->mrk_ && self->cap_ != CONST_REDO)
     {
@@ -247,61 +273,12 @@ size_t matcher_scan(NeoastMatcher* self, NeoastPatternFSM fsm)
     return self->cap_;
 }
 
-/// Shift or expand the internal buffer when it is too small to accommodate more input, where the buffer size is doubled when needed, change cur_, pos_, end_, max_, ind_, buf_, bol_, lpb_, and txt_.
+/// Shift or expand the internal buffer when it is too small to accommodate more input, where the buffer size is doubled when needed, change cur_, pos_, end_, max_, ind_, buf_, lpb_, and txt_.
 static inline bool_t matcher_grow(NeoastMatcher* self, size_t need) ///< optional needed space = Const::BLOCK size by default
 /// @returns true if buffer was shifted or enlarged
 {
     if (self->max_ - self->end_ >= need + 1)
         return FALSE;
-#if defined(WITH_SPAN)
-    (void)lineno();
-    if (self->bol_ + CONST_BLOCK < self->txt_ && self->evh_ == NULL)
-    {
-      // this line is very long, likely a binary file, so shift a block size away from the match instead
-      DBGLOG("Line in buffer to long to shift, moving bol position to text match position minus %zu", Const::BLOCK);
-        self->bol_ = self->txt_ - CONST_BLOCK;
-    }
-    size_t gap = self->bol_ - self->buf_;
-    if (gap > 0 && self->evh_ != NULL)
-      (*self->evh_)(self, self->buf_, gap, self->num_);
-    self->cur_ -= gap;
-    self->ind_ -= gap;
-    self->pos_ -= gap;
-    self->end_ -= gap;
-    self->txt_ -= gap;
-    self->bol_ -= gap;
-    self->lpb_ -= gap;
-    self->num_ += gap;
-    memmove(self->buf_, self->buf_ + gap, self->end_);
-    if (self->max_ - self->end_ >= need)
-    {
-      DBGLOG("Shift buffer to close gap of %zu bytes", gap);
-    }
-    else
-    {
-      size_t newmax = self->end_ + need;
-      while (self->max_ < newmax)
-          self->max_ *= 2;
-      DBGLOG("Expand buffer to %zu bytes", max_);
-#if defined(WITH_REALLOC)
-#if (defined(__WIN32__) || defined(_WIN32) || defined(WIN32) || defined(_WIN64) || defined(__BORLANDC__)) && !defined(__CYGWIN__)
-      char *newbuf = static_cast<char*>(_aligned_realloc(static_cast<void*>(buf_), max_, 4096));
-#else
-      char *newbuf = static_cast<char*>(std::realloc(static_cast<void*>(buf_), max_));
-#endif
-      if (newbuf == NULL)
-        throw std::bad_alloc();
-#else
-      char *newbuf = new char[max_];
-      std::memcpy(newbuf, buf_, end_);
-      delete[] buf_;
-#endif
-      txt_ = newbuf + (txt_ - buf_);
-      lpb_ = newbuf + (lpb_ - buf_);
-      buf_ = newbuf;
-    }
-    bol_ = buf_;
-#else
     size_t gap = self->txt_ - self->buf_;
     if (self->max_ - self->end_ + gap >= need)
     {
@@ -326,6 +303,12 @@ static inline bool_t matcher_grow(NeoastMatcher* self, size_t need) ///< optiona
         if (oldmax < self->max_)
         {
             DBGLOG("Expand buffer from %zu to %zu bytes", oldmax, max_);
+#ifdef NEOAST_STATS
+            if (self->stats)
+            {
+                self->stats->lexer_grows++;
+            }
+#endif
             (void) matcher_lineno(self);
             self->cur_ -= gap;
             self->ind_ -= gap;
@@ -337,31 +320,128 @@ static inline bool_t matcher_grow(NeoastMatcher* self, size_t need) ///< optiona
             if (newbuf == NULL)
                 assert(0 && "bad allocation");
             self->buf_ = newbuf;
+            self->own_ = newbuf;
             self->txt_ = self->buf_;
             self->lpb_ = self->buf_;
         }
     }
-#endif
     return TRUE;
 }
 
+/// Point the buffer somewhere else while it holds no input, change buf_, txt_ and lpb_.
+static inline void matcher_move_buffer(NeoastMatcher* self, char* buf)
+{
+    assert(self->end_ == 0);
+    self->txt_ = buf + (self->txt_ - self->buf_);
+    self->lpb_ = buf + (self->lpb_ - self->buf_);
+    self->buf_ = buf;
+}
+
+/// Make more input available in the buffer. In-memory inputs are scanned in place
+/// while nothing is buffered, anything else is read into own_ block by block.
+static void matcher_fill(NeoastMatcher* self)
+{
+    if (matcher_in_place(self) && self->end_ > 0)
+    {
+        // The whole input is already in place
+        return;
+    }
+
+    if (self->end_ == 0 && !self->partial_ && self->in->type == NEOAST_INPUT_BUFFER)
+    {
+        // A partial input may be refilled once it runs out so
+        // only the last chunk can be aliased, no copy is made
+        size_t n = self->in->impl_.buffer_.size_;
+        matcher_move_buffer(self, n ? (char*) self->in->impl_.buffer_.cstring_ : (char*) "");
+        self->in->impl_.buffer_.cstring_ += n;
+        self->in->impl_.buffer_.size_ = 0;
+        self->end_ = n;
+#ifdef NEOAST_STATS
+        if (self->stats)
+        {
+            self->stats->bytes += n;
+        }
+#endif
+        return;
+    }
+
+    if (matcher_in_place(self))
+    {
+        if (!self->own_)
+        {
+            self->max_ = 2 * CONST_BLOCK;
+            if (posix_memalign((void**) &self->own_, 4096, self->max_) != 0)
+            {
+                perror("memalign() - matcher buffer");
+                abort();
+            }
+        }
+
+        matcher_move_buffer(self, self->own_);
+    }
+
+    if (self->end_ + self->blk_ + 1 >= self->max_)
+        (void) matcher_grow(self, CONST_BLOCK);
+    self->end_ += matcher_get_1(self, self->buf_ + self->end_,
+                                self->blk_ > 0 ? self->blk_ : self->max_ - self->end_ - 1);
+}
+
 /// Get the next character and grow the buffer to make more room if necessary.
 int matcher_get_more(NeoastMatcher* self)
 /// @returns the character read (unsigned char 0..255) or EOF (-1)
 {
     if (self->eof_)
         return EOF;
-    while (TRUE)
-    {
-        if (self->end_ + self->blk_ + 1 >= self->max_)
-            (void) matcher_grow(self, CONST_BLOCK);
-        self->end_ += matcher_get_1(self, self->buf_ + self->end_,
-                                    self->blk_ > 0 ? self->blk_ : self->max_ - self->end_ - 1);
-        if (self->pos_ < self->end_)
-            return (unsigned char) (self->buf_[self->pos_++]);
-        self->eof_ = TRUE;
-        return EOF;
-    }
+    // The text terminator may sit past the end of the buffered
+    // input, restore it before new input is read over it
+    matcher_reset_text(self);
+    matcher_fill(self);
+    if (self->pos_ < self->end_)
+        return (unsigned char) (self->buf_[self->pos_++]);
+    self->eof_ = TRUE;
+    return EOF;
+}
+
+void matcher_set_partial(NeoastMatcher* self, bool_t partial)
+{
+    self->partial_ = partial;
+    self->eof_ = FALSE;
+}
+
+bool_t matcher_need_more(NeoastMatcher* self)
+{
+    if (!self->partial_ || !self->eof_)
+        return FALSE;
+
+    // The match might continue into the next chunk,
+    // rewind to its start and scan again after a refill
+    matcher_set_current(self, self->txt_ - self->buf_);
+    self->len_ = 0;
+    self->cap_ = 0;
+    return TRUE;
+}
+
+void matcher_set_buffer_at(NeoastMatcher* self, const char* str, size_t len, size_t offset)
+{
+    input_set_buffer(self->in, str + offset, len - offset);
+    matcher_set_input(self, self->in);
+    NEOAST_STACK_PUSH(self->lexing_state, 0);
+
+    // Offsets keep counting from the start of the buffer
+    self->num_ = offset;
+    self->lah_ = offset;
+    if (offset > 0)
+        self->got_ = (unsigned char) str[offset - 1];
+}
+
+size_t matcher_offset(const NeoastMatcher* self)
+{
+    return self->num_ + self->cur_;
+}
+
+size_t matcher_lookahead(const NeoastMatcher* self)
+{
+    return self->lah_;
 }
 
 /// Reset the matched text by removing the terminating \0, which is needed to search for a new match.
@@ -372,186 +452,181 @@ static inline void matcher_reset_text(NeoastMatcher* self)
         self->txt_[self->len_] = self->chr_;
         self->chr_ = '\0';
     }
+    self->text_.n = 0;
 }
 
 
-/// Updates and returns the starting line number of the match in the input character sequence.
-size_t matcher_lineno(NeoastMatcher* self)
-/// @returns line number
+/// Count the newlines in [s, e) one byte at a time.
+static size_t count_lines_scalar(const char* s, const char* e)
+{
+    size_t n = 0;
+    for (; s < e; s++)
+        n += *s == '\n';
+    return n;
+}
+
+/// Count the UTF-8 characters in [s, e) one byte at a time, every byte but a continuation byte starts one.
+static size_t count_chars_scalar(const char* s, const char* e)
+{
+    size_t n = 0;
+    for (; s < e; s++)
+        n += (*s & 0xC0) != 0x80;
+    return n;
+}
+
+#if defined(NEOAST_SIMD_X86)
+// Matching bytes are counted by subtracting the all-ones compare results
+// from 8-bit counters. The counters are summed up with a SAD against zero
+// every 255 vectors, before any of them can overflow. Continuation bytes
+// 0x80-0xBF are the only bytes below -64 as signed chars.
+
+__attribute__((target("sse2")))
+static size_t count_sse2(const char* s, const char* e, int chars)
 {
-#if defined(WITH_SPAN)
-    if (self->lpb_ < self->txt_)
+    const __m128i nl = _mm_set1_epi8('\n');
+    const __m128i cont = _mm_set1_epi8(-65);
+    __m128i total = _mm_setzero_si128();
+    while (e - s >= 16)
     {
-        char* s = self->bol_;
-        char* t = self->txt_;
-        // clang/gcc 4-way vectorizable loop
-        while (t - 4 >= s)
-        {
-            if ((t[-1] == '\n') | (t[-2] == '\n') | (t[-3] == '\n') | (t[-4] == '\n'))
-                break;
-            t -= 4;
-        }
-        // epilogue
-        if (--t >= s && *t != '\n')
-            if (--t >= s && *t != '\n')
-                if (--t >= s && *t != '\n')
-                    --t;
-        self->bol_ = t + 1;
-        self->lpb_ = self->txt_;
-        size_t n = self->lno_;
-#if defined(HAVE_AVX512BW) && (!defined(_MSC_VER) || defined(_WIN64))
-        if (have_HW_AVX512BW())
-        {
-          __m512i vlcn = _mm512_set1_epi8('\n');
-          while (s + 63 <= t)
-          {
-            __m512i vlcm = _mm512_loadu_si512(reinterpret_cast<const __m512i*>(s));
-            uint64_t mask = _mm512_cmpeq_epi8_mask(vlcm, vlcn);
-            n += popcountl(mask);
-            s += 64;
-          }
-        }
-        else if (have_HW_AVX2())
-        {
-          __m256i vlcn = _mm256_set1_epi8('\n');
-          while (s + 31 <= t)
-          {
-            __m256i vlcm = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s));
-            __m256i vlceq = _mm256_cmpeq_epi8(vlcm, vlcn);
-            uint32_t mask = _mm256_movemask_epi8(vlceq);
-            n += popcount(mask);
-            s += 32;
-          }
-        }
-        else if (have_HW_SSE2())
-        {
-          __m128i vlcn = _mm_set1_epi8('\n');
-          while (s + 15 <= t)
-          {
-            __m128i vlcm = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s));
-            __m128i vlceq = _mm_cmpeq_epi8(vlcm, vlcn);
-            uint32_t mask = _mm_movemask_epi8(vlceq);
-            n += popcount(mask);
-            s += 16;
-          }
-        }
-#elif defined(HAVE_AVX2)
-        if (have_HW_AVX2())
-        {
-          __m256i vlcn = _mm256_set1_epi8('\n');
-          while (s + 31 <= t)
-          {
-            __m256i vlcm = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s));
-            __m256i vlceq = _mm256_cmpeq_epi8(vlcm, vlcn);
-            uint32_t mask = _mm256_movemask_epi8(vlceq);
-            n += popcount(mask);
-            s += 32;
-          }
-        }
-        else if (have_HW_SSE2())
+        size_t blocks = (size_t) (e - s) / 16;
+        if (blocks > 255)
+            blocks = 255;
+        __m128i acc = _mm_setzero_si128();
+        for (size_t i = 0; i < blocks; i++, s += 16)
         {
-          __m128i vlcn = _mm_set1_epi8('\n');
-          while (s + 15 <= t)
-          {
-            __m128i vlcm = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s));
-            __m128i vlceq = _mm_cmpeq_epi8(vlcm, vlcn);
-            uint32_t mask = _mm_movemask_epi8(vlceq);
-            n += popcount(mask);
-            s += 16;
-          }
+            __m128i v = _mm_loadu_si128((const __m128i*) s);
+            acc = _mm_sub_epi8(acc, chars ? _mm_cmpgt_epi8(v, cont) : _mm_cmpeq_epi8(v, nl));
         }
-#elif defined(HAVE_SSE2)
-        if (have_HW_SSE2())
-        {
-          __m128i vlcn = _mm_set1_epi8('\n');
-          while (s + 15 <= t)
-          {
-            __m128i vlcm = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s));
-            __m128i vlceq = _mm_cmpeq_epi8(vlcm, vlcn);
-            uint32_t mask = _mm_movemask_epi8(vlceq);
-            n += popcount(mask);
-            s += 16;
-          }
-        }
-#elif defined(HAVE_NEON)
-        {
-          // ARM AArch64/NEON SIMD optimized loop? - no code found yet that runs faster than the code below
-        }
-#endif
-        uint32_t n0 = 0, n1 = 0, n2 = 0, n3 = 0;
-        // clang/gcc 4-way vectorizable loop
-        while (s + 3 <= t)
-        {
-            n0 += s[0] == '\n';
-            n1 += s[1] == '\n';
-            n2 += s[2] == '\n';
-            n3 += s[3] == '\n';
-            s += 4;
-        }
-        n += n0 + n1 + n2 + n3;
-        // epilogue
-        if (s <= t)
+        total = _mm_add_epi64(total, _mm_sad_epu8(acc, _mm_setzero_si128()));
+    }
+
+    uint64_t lanes[2];
+    _mm_storeu_si128((__m128i*) lanes, total);
+    return lanes[0] + lanes[1] + (chars ? count_chars_scalar(s, e) : count_lines_scalar(s, e));
+}
+
+__attribute__((target("avx2")))
+static size_t count_avx2(const char* s, const char* e, int chars)
+{
+    const __m256i nl = _mm256_set1_epi8('\n');
+    const __m256i cont = _mm256_set1_epi8(-65);
+    __m256i total = _mm256_setzero_si256();
+    while (e - s >= 32)
+    {
+        size_t blocks = (size_t) (e - s) / 32;
+        if (blocks > 255)
+            blocks = 255;
+        __m256i acc = _mm256_setzero_si256();
+        for (size_t i = 0; i < blocks; i++, s += 32)
         {
-            n += *s == '\n';
-            if (++s <= t)
-            {
-                n += *s == '\n';
-                if (++s <= t)
-                    n += *s == '\n';
-            }
+            __m256i v = _mm256_loadu_si256((const __m256i*) s);
+            acc = _mm256_sub_epi8(acc, chars ? _mm256_cmpgt_epi8(v, cont) : _mm256_cmpeq_epi8(v, nl));
         }
-        self->lno_ = n;
+        total = _mm256_add_epi64(total, _mm256_sad_epu8(acc, _mm256_setzero_si256()));
+    }
+
+    uint64_t lanes[4];
+    _mm256_storeu_si256((__m256i*) lanes, total);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3]
+           + (chars ? count_chars_scalar(s, e) : count_lines_scalar(s, e));
+}
+
+__attribute__((target("avx512bw,popcnt")))
+static size_t count_avx512(const char* s, const char* e, int chars)
+{
+    const __m512i nl = _mm512_set1_epi8('\n');
+    const __m512i cont = _mm512_set1_epi8(-65);
+    size_t n = 0;
+    for (; e - s >= 64; s += 64)
+    {
+        __m512i v = _mm512_loadu_si512((const void*) s);
+        n += (size_t) __builtin_popcountll(chars ? _mm512_cmpgt_epi8_mask(v, cont) : _mm512_cmpeq_epi8_mask(v, nl));
+    }
+
+    return n + (chars ? count_chars_scalar(s, e) : count_lines_scalar(s, e));
+}
+
+/// Pick the widest vector unit of the CPU
+static size_t count_dispatch(const char* s, const char* e, int chars)
+{
+    if (e - s >= 64)
+    {
+        if (__builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("popcnt"))
+            return count_avx512(s, e, chars);
+        if (__builtin_cpu_supports("avx2"))
+            return count_avx2(s, e, chars);
     }
+
+    if (e - s >= 16 && __builtin_cpu_supports("sse2"))
+        return count_sse2(s, e, chars);
+
+    return chars ? count_chars_scalar(s, e) : count_lines_scalar(s, e);
+}
+#endif
+
+size_t matcher_count_lines(const char* s, const char* e)
+{
+#if defined(NEOAST_SIMD_X86)
+    return count_dispatch(s, e, 0);
 #else
-    size_t n = self->lno_;
-    size_t k = self->cno_;
+    return count_lines_scalar(s, e);
+#endif
+}
+
+size_t matcher_count_chars(const char* s, const char* e)
+{
+#if defined(NEOAST_SIMD_X86)
+    return count_dispatch(s, e, 1);
+#else
+    return count_chars_scalar(s, e);
+#endif
+}
+
+size_t matcher_count_columns(const char* s, const char* e, size_t col, size_t tab)
+{
+    // Tabs depend on the column before them, count the UTF-8
+    // characters in between and only step over the tabs
+    const char* t;
+    while (s < e && (t = memchr(s, '\t', e - s)))
+    {
+        col += matcher_count_chars(s, t);
+        col += 1 + (~col & (tab - 1));
+        s = t + 1;
+    }
+
+    return col + matcher_count_chars(s, e);
+}
+
+/// Updates and returns the starting line number of the match in the input character sequence.
+size_t matcher_lineno(NeoastMatcher* self)
+/// @returns line number
+{
     char* s = self->lpb_;
     char* e = self->txt_;
-    while (s < e)
+    if (s < e)
     {
-        if (*s == '\n')
-        {
-            ++n;
-            k = 0;
-        }
-        else if (*s == '\t')
-        {
-            // count tab spacing
-            k += 1 + (~k & (self->opt_.T - 1));
-        }
-        else
+        size_t n = matcher_count_lines(s, e);
+        if (n > 0)
         {
-            // count column offset in UTF-8 chars
-            k += ((*s & 0xC0) != 0x80);
+            // Only the columns after the last newline are counted
+            self->lno_ += n;
+            self->cno_ = 0;
+            while (e[-1] != '\n')
+                --e;
+            s = e;
+            e = self->txt_;
         }
-        ++s;
+
+        self->cno_ = matcher_count_columns(s, e, self->cno_, (size_t) self->opt_.T);
+        self->lpb_ = e;
     }
-    self->lpb_ = e;
-    self->lno_ = n;
-    self->cno_ = k;
-#endif
+
     return self->lno_;
 }
 
 size_t matcher_columno(NeoastMatcher* self)
 {
-    (void)matcher_lineno(self);
-#if defined(WITH_SPAN)
-    const char *s = self->cpb_;
-    const char *e = self->txt_;
-    size_t k = self->cno_;
-    size_t m = self->opt_.T - 1;
-    while (s < e)
-    {
-      if (*s == '\t')
-        k += 1 + (~k & m); // count tab spacing
-      else
-        k += ((*s & 0xC0) != 0x80); // count column offset in UTF-8 chars
-      ++s;
-    }
-    self->cpb_ = self->txt_;
-    self->cno_ = k;
-#endif
+    (void) matcher_lineno(self);
     return self->cno_;
 }
 
@@ -562,6 +637,19 @@ size_t matcher_size(NeoastMatcher* self)
 
 const char* matcher_text(NeoastMatcher* self)
 {
+    if (matcher_in_place(self))
+    {
+        // The input can't be written to, terminate a copy of the match
+        if (self->text_.n == 0)
+        {
+            neoast_vector_grow(&self->text_, self->len_ + 1);
+            memcpy(self->text_.ptr, self->txt_, self->len_);
+            ((char*) self->text_.ptr)[self->len_] = '\0';
+            self->text_.n = self->len_ + 1;
+        }
+        return self->text_.ptr;
+    }
+
     if (self->chr_ == '\0')
     {
         self->chr_ = self->txt_[self->len_];
@@ -572,7 +660,16 @@ const char* matcher_text(NeoastMatcher* self)
 
 static inline size_t matcher_get_1(NeoastMatcher* self, char* s, size_t n)
 {
+#ifdef NEOAST_STATS
+    size_t got = input_get(self->in, s, n);
+    if (self->stats)
+    {
+        self->stats->bytes += got;
+    }
+    return got;
+#else
     return input_get(self->in, s, n);
+#endif
 }
 
 /// Set the current position in the buffer for the next match.
@@ -580,11 +677,7 @@ static inline void matcher_set_current(NeoastMatcher* self, size_t loc) ///< new
 {
 //    DBGCHK(loc <= end_);
     self->pos_ = self->cur_ = loc;
-#if defined(WITH_SPAN)
-    self->got_ = loc > 0 ? (unsigned char)(self->buf_[loc - 1]) : '\n';
-#else
     self->got_ = loc > 0 ? (unsigned char) (self->buf_[loc - 1]) : CONST_UNK;
-#endif
 }
 
 /// Set the current match position in the buffer.
@@ -601,16 +694,12 @@ int matcher_peek_more(NeoastMatcher* self)
     DBGLOG("AbstractMatcher::peek_more()");
     if (self->eof_)
         return EOF;
-    while (TRUE)
-    {
-        if (self->end_ + self->blk_ + 1 >= self->max_)
-            (void) matcher_grow(self, CONST_BLOCK);
-        self->end_ += matcher_get_1(self, self->buf_ + self->end_,
-                                    self->blk_ > 0 ? self->blk_ : self->max_ - self->end_ - 1);
-        if (self->pos_ < self->end_)
-            return (unsigned char) (self->buf_[self->pos_]);
-//        DBGLOGN("peek_more(): EOF");
-        self->eof_ = TRUE;
-        return EOF;
-    }
+    // The text terminator may sit past the end of the buffered
+    // input, restore it before new input is read over it
+    matcher_reset_text(self);
+    matcher_fill(self);
+    if (self->pos_ < self->end_)
+        return (unsigned char) (self->buf_[self->pos_]);
+    self->eof_ = TRUE;
+    return EOF;
 }
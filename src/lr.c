@@ -16,129 +16,194 @@
  */
 
 
-#include <neoast.h>
-#include <alloca.h>
-#include <string.h>
-#include <assert.h>
-
-#define OFFSET_VOID_PTR(ptr, s, i) (void*)(((char*)(ptr)) + ((s) * (i)))
-
-static inline
-const void* g_table_from_matrix(const void* table,
-                                size_t row, size_t col,
-                                size_t col_n)
-{
-    size_t off = sizeof(uint32_t) * ((row * col_n) + (col));
-    return ((const char*) table) + off;
-}
-
-static inline
-uint32_t g_lr_reduce(
-        const GrammarParser* parser,
-        void* context,
-        const uint32_t* parsing_table,
-        uint32_t reduce_token,
-        const ParserBuffers* buffers,
-        uint32_t* dest_idx)
+#include <lr_priv.h>
+#include <stdlib.h>
+
+// Terminals and rules up to this count are checked
+// on a syntax error without going to the heap
+#define NEOAST_SYNTAX_ERROR_BUF_N (256)
+
+/**
+ * Check if the parser can shift a token after running the
+ * reductions it triggers on the current stack (lookahead correction).
+ * The reductions only run on a copy of the states so the real
+ * stack is left untouched.
+ * @param self parser that ran into the error
+ * @param parsing_table table to simulate the reductions with
+ * @param states states on the parsing stack, the current one last
+ * @param state_n number of states on the stack
+ * @param stride distance between two states in the states array
+ * @param pushed scratch space of grammar_n states pushed by the reductions
+ * @param tok terminal to check
+ * @return 1 if the token would be shifted or accepted, 0 otherwise
+ */
+static int parser_lac_accepts(const GrammarParser* self,
+                              const void* parsing_table,
+                              const uint32_t* states,
+                              uint32_t state_n,
+                              uint32_t stride,
+                              uint32_t* pushed,
+                              uint32_t tok)
 {
-    // Find how many tokens to pop
-    // due to this rule
-    const GrammarRule* reduce_rule = &parser->grammar_rules[reduce_token & TOK_MASK];
-    uint32_t arg_count = reduce_rule->tok_n;
-
-    char* dest = alloca(buffers->val_s);
-    char* args = alloca(buffers->val_s * arg_count);
-
-    uint32_t idx = *dest_idx;
-    assert(buffers->parsing_stack->pos % 2 == 1 && buffers->parsing_stack->pos > (arg_count << 1));
-    for (uint32_t i = 0; i < arg_count; i++)
+    // States below state_n come from the real stack, the
+    // ones the reductions push are kept in the scratch space
+    uint32_t pushed_n = 0;
+    while (1)
     {
-        NEOAST_STACK_POP(buffers->parsing_stack); // Pop the state
-        idx = NEOAST_STACK_POP(buffers->parsing_stack); // Pop the index of the token/value
+        uint32_t state = pushed_n ? pushed[pushed_n - 1] : states[(state_n - 1) * stride];
+        uint32_t action = self->default_reductions ? self->default_reductions[state] : TOK_SYNTAX_ERROR;
+        if (!action)
+        {
+            action = g_table_lookup(parsing_table, self->table_format, state, tok, self);
+        }
 
-        // Fill the argument
-        memcpy(OFFSET_VOID_PTR(args, buffers->val_s, arg_count - i - 1),
-               OFFSET_VOID_PTR(buffers->value_table, buffers->val_s, idx),
-               buffers->val_s);
-    }
+        if (action == TOK_SYNTAX_ERROR)
+        {
+            return 0;
+        }
+        else if (action & (TOK_SHIFT_MASK | TOK_ACCEPT_MASK))
+        {
+            return 1;
+        }
 
-    int32_t result_token = (int32_t) reduce_rule->token - NEOAST_ASCII_MAX;
-    assert(result_token > 0);
+        const GrammarRule* rule = &self->grammar_rules[action & TOK_MASK];
+        uint32_t pop_n = rule->tok_n;
+        if (pop_n > pushed_n)
+        {
+            state_n -= pop_n - pushed_n;
+            pushed_n = 0;
+        }
+        else
+        {
+            pushed_n -= pop_n;
+        }
 
-    // Run the reduction code
-    parser->parser_reduce(reduce_token & TOK_MASK, dest, (void**) args, context);
+        // Every rule pushes at most one state in a chain of reductions
+        // that ends in a shift, anything deeper never consumes the token
+        if (pushed_n >= self->grammar_n)
+        {
+            return 0;
+        }
 
-    // Copy the result back into the table
-    memcpy(OFFSET_VOID_PTR(buffers->value_table, buffers->val_s, idx),
-           dest,
-           buffers->val_s);
+        state = pushed_n ? pushed[pushed_n - 1] : states[(state_n - 1) * stride];
+        pushed[pushed_n++] = g_table_lookup(parsing_table, self->table_format, state,
+                                            rule->token - NEOAST_ASCII_MAX, self) & TOK_MASK;
+    }
+}
 
-    assert(buffers->val_s - buffers->union_s >= sizeof(TokenPosition));
-    if (arg_count > 0)
+/**
+ * Collect the terminals the parser would accept in the error state
+ * @param self parser that ran into the error
+ * @param parsing_table table to simulate the reductions with
+ * @param states states on the parsing stack, the current one last
+ * @param state_n number of states on the stack
+ * @param stride distance between two states in the states array
+ * @param pushed scratch space of grammar_n states
+ * @param expected_tokens destination of at most action_token_n terminals
+ * @return number of terminals placed in expected_tokens
+ */
+static uint32_t parser_expected_tokens(const GrammarParser* self,
+                                       const void* parsing_table,
+                                       const uint32_t* states,
+                                       uint32_t state_n,
+                                       uint32_t stride,
+                                       uint32_t* pushed,
+                                       uint32_t* expected_tokens)
+{
+    uint32_t current_state = states[(state_n - 1) * stride];
+    uint32_t expected_tokens_n = 0;
+    if (self->expected_tokens)
     {
-        // Copy the positional data of the first argument back to the destination
-        memcpy(dest + buffers->union_s, args + buffers->union_s, sizeof(TokenPosition));
+        // Only visit the terminals the state has an action for
+        uint32_t words = (self->action_token_n + 31) / 32;
+        const uint32_t* row = &self->expected_tokens[current_state * words];
+        for (uint32_t w = 0; w < words; w++)
+        {
+            for (uint32_t bits = row[w]; bits; bits &= bits - 1)
+            {
+                uint32_t i = (w << 5) + (uint32_t) __builtin_ctz(bits);
+                if (parser_lac_accepts(self, parsing_table, states, state_n, stride, pushed, i))
+                {
+                    expected_tokens[expected_tokens_n++] = i;
+                }
+            }
+        }
     }
     else
     {
-        // No argument (empty rule), no positional data available
-        memset(dest + buffers->union_s, 0, sizeof(TokenPosition));
+        for (uint32_t i = 0; i < self->action_token_n; i++)
+        {
+            if (parser_lac_accepts(self, parsing_table, states, state_n, stride, pushed, i))
+            {
+                expected_tokens[expected_tokens_n++] = i;
+            }
+        }
     }
 
-    // Fill the result
-    buffers->token_table[idx] = result_token;
-
-    // Check the goto
-    uint32_t next_state = *(uint32_t*) g_table_from_matrix(
-            parsing_table,
-            NEOAST_STACK_PEEK(buffers->parsing_stack), // Top of stack is current state
-            result_token,
-            parser->token_n);
-
-    next_state &= TOK_MASK;
-
-    NEOAST_STACK_PUSH(buffers->parsing_stack, idx);
-    NEOAST_STACK_PUSH(buffers->parsing_stack, next_state);
-
-    *dest_idx = idx;
-    return next_state;
+    return expected_tokens_n;
 }
 
-static void lr_parse_error(
+void parser_syntax_error(
         const GrammarParser* self,
         void* err_ctx,
-        const uint32_t* parsing_table,
+        const void* parsing_table,
         const TokenPosition* p,
-        uint32_t current_state,
+        NeoastLines* lines,
+        const uint32_t* states,
+        uint32_t state_n,
+        uint32_t stride,
         uint32_t error_tok,
         uint32_t prev_tok)
 {
     const char* current_token = self->token_names[error_tok];
     const char* prev_token = self->token_names[prev_tok];
+    uint32_t current_state = states[(state_n - 1) * stride];
+
+    // Scratch space is only taken from the stack up to a fixed
+    // size, larger grammars go to the heap on the error path
+    uint32_t pushed_buf[NEOAST_SYNTAX_ERROR_BUF_N];
+    uint32_t expected_buf[NEOAST_SYNTAX_ERROR_BUF_N];
+    uint32_t* pushed = pushed_buf;
+    uint32_t* expected_tokens = expected_buf;
+    if (self->grammar_n > NEOAST_SYNTAX_ERROR_BUF_N)
+    {
+        pushed = malloc(sizeof(uint32_t) * self->grammar_n);
+    }
+    if (self->action_token_n > NEOAST_SYNTAX_ERROR_BUF_N)
+    {
+        expected_tokens = malloc(sizeof(uint32_t) * self->action_token_n);
+    }
 
-    uint32_t index_off = current_state * self->token_n;
-    uint32_t* expected_tokens = alloca(sizeof(uint32_t) * self->token_n);
     uint32_t expected_tokens_n = 0;
-    for (uint32_t i = 0; i < self->token_n; i++)
+    if (pushed && expected_tokens)
     {
-        if (parsing_table[index_off + i] != TOK_SYNTAX_ERROR)
-        {
-            expected_tokens[expected_tokens_n++] = i;
-        }
+        expected_tokens_n = parser_expected_tokens(self, parsing_table, states, state_n, stride,
+                                                   pushed, expected_tokens);
+    }
+
+    if (!expected_tokens)
+    {
+        // Still report the error, only without the expected tokens
+        expected_tokens = expected_buf;
     }
 
     if (self->parser_error)
     {
         self->parser_error(
                 err_ctx,
-                self->token_names, p, prev_tok, error_tok,
+                self->token_names, p, lines, prev_tok, error_tok,
                 expected_tokens, expected_tokens_n);
     }
     else
     {
-        if (p)
+        TokenLocation location;
+        if (p && neoast_lines_locate(lines, p->offset, &location) == 0)
+        {
+            fprintf(stderr, "Error on line %u:%u\n", location.line, location.col);
+        }
+        else if (p)
         {
-            fprintf(stderr, "Error on line %d:%d\n", p->line, p->col);
+            fprintf(stderr, "Error at offset %llu\n", (unsigned long long) p->offset);
         }
 
         fprintf(stderr, "Invalid syntax: unexpected token '%s' [%d] after '%s' [%d] (state %d)\n",
@@ -153,146 +218,163 @@ static void lr_parse_error(
         fprintf(stderr, "\n");
     }
 
-}
-
-static void run_destructor(const GrammarParser* parser,
-                           const ParserBuffers* buffers,
-                           uint32_t index)
-{
-    uint32_t current_token = buffers->token_table[index];
-
-    if (current_token < parser->token_n         // Don't free invalid tokens
-        && parser->destructors[current_token])  // Only free tokens that have a destructor
-    {
-        void* self_ptr = OFFSET_VOID_PTR(buffers->value_table,
-                                         buffers->val_s, index);
-
-        // A destructor is defined for this token
-        // Call the destructor on this object
-        parser->destructors[current_token](self_ptr);
-        memset(self_ptr, 0, buffers->val_s);
-    }
-}
-
-static void parser_run_destructors(
-        const GrammarParser* parser,
-        const ParserBuffers* buffers,
-        int32_t invalid_tok_i)
-{
-    if (!parser->destructors)
+    if (pushed != pushed_buf)
     {
-        // Destructors have not been defined
-        return;
+        free(pushed);
     }
-
-    // Free the current invalid token
-    if (invalid_tok_i >= 0)
+    if (expected_tokens != expected_buf)
     {
-        run_destructor(parser, buffers, invalid_tok_i);
+        free(expected_tokens);
     }
+}
 
-    // Free the reduced tokens
-    assert(buffers->parsing_stack->pos % 2 == 1);
-    while (buffers->parsing_stack->pos > 1) // lastly, hold the initialized state '0'
+/**
+ * Pick the driver specialised for the layout of the parsing table
+ */
+static int32_t parser_parse_lr_dispatch(const GrammarParser* parser,
+                                        void* context,
+                                        const void* parsing_table,
+                                        ParserBuffers* buffers,
+                                        void* lexer,
+                                        int ll_next(void*, void*, void*),
+                                        int32_t tok,
+                                        uint32_t max_steps)
+{
+    switch (parser->table_format)
     {
-        NEOAST_STACK_POP(buffers->parsing_stack); // state
-        uint32_t index = NEOAST_STACK_POP(buffers->parsing_stack);
-        run_destructor(parser, buffers, index);
+        case TABLE_FORMAT_COMPRESSED:
+            return parser_parse_lr_impl(parser, context, parsing_table, TABLE_FORMAT_COMPRESSED,
+                                        buffers, lexer, ll_next, tok, max_steps);
+        case TABLE_FORMAT_SPLIT_8:
+            return parser_parse_lr_impl(parser, context, parsing_table, TABLE_FORMAT_SPLIT_8,
+                                        buffers, lexer, ll_next, tok, max_steps);
+        case TABLE_FORMAT_SPLIT_16:
+            return parser_parse_lr_impl(parser, context, parsing_table, TABLE_FORMAT_SPLIT_16,
+                                        buffers, lexer, ll_next, tok, max_steps);
+        case TABLE_FORMAT_SPLIT_32:
+            return parser_parse_lr_impl(parser, context, parsing_table, TABLE_FORMAT_SPLIT_32,
+                                        buffers, lexer, ll_next, tok, max_steps);
+        case TABLE_FORMAT_DENSE:
+        default:
+            return parser_parse_lr_impl(parser, context, parsing_table, TABLE_FORMAT_DENSE,
+                                        buffers, lexer, ll_next, tok, max_steps);
     }
 }
 
 int32_t parser_parse_lr(const GrammarParser* parser,
                         void* context,
-                        const uint32_t* parsing_table,
-                        const ParserBuffers* buffers,
+                        const void* parsing_table,
+                        ParserBuffers* buffers,
                         void* lexer,
                         int ll_next(void*, void*, void*))
 {
-    // Lexer states
-    char* lex_val = buffers->value_table;
+    // Pull parses always start from the initial state
+    parser_reset_buffers(buffers);
+    return parser_parse_lr_dispatch(parser, context, parsing_table, buffers, lexer, ll_next, 0, 0);
+}
 
-    // Push the initial state to the stack
-    uint32_t current_state = 0;
-    NEOAST_STACK_PUSH(buffers->parsing_stack, current_state);
+int32_t parser_parse_lr_budget(const GrammarParser* parser,
+                               void* context,
+                               const void* parsing_table,
+                               ParserBuffers* buffers,
+                               void* lexer,
+                               int ll_next(void*, void*, void*),
+                               uint32_t max_steps)
+{
+    parser_reset_buffers(buffers);
+    return parser_resume_lr(parser, context, parsing_table, buffers, lexer, ll_next, max_steps);
+}
 
-    uint32_t i = 0;
-    uint32_t prev_tok = 0;
-    int32_t tok = ll_next(lexer, lex_val, context);
-    buffers->token_table[0] = tok;
+int32_t parser_resume_lr(const GrammarParser* parser,
+                         void* context,
+                         const void* parsing_table,
+                         ParserBuffers* buffers,
+                         void* lexer,
+                         int ll_next(void*, void*, void*),
+                         uint32_t max_steps)
+{
+    int32_t result = parser_parse_lr_dispatch(parser, context, parsing_table, buffers,
+                                              lexer, ll_next, 0, max_steps);
 
-    uint32_t dest_idx = 0; // index of the last reduction
-    while (1)
+    if (result != NEOAST_PARSE_SUSPENDED)
     {
-        // Check for lexing error
-        if (tok < 0)
-        {
-            parser_run_destructors(parser, buffers, -1);
-            return -1;
-        }
+        // This parse is finished, don't resume it
+        parser_reset_buffers(buffers);
+    }
 
-        uint32_t table_value = *(uint32_t*) g_table_from_matrix(
-                parsing_table,
-                current_state,
-                tok,
-                parser->token_n);
+    return result;
+}
 
-        if (table_value == TOK_SYNTAX_ERROR)
-        {
-            const TokenPosition* p = (const TokenPosition*) (lex_val + buffers->union_s);
-
-            lr_parse_error(parser,
-                           context,
-                           parsing_table,
-                           p,
-                           current_state,
-                           tok, prev_tok);
-
-            // We need to free the remaining objects in this map
-            parser_run_destructors(parser, buffers, (int32_t) i);
-            return -1;
-        }
-        else if (table_value & TOK_SHIFT_MASK)
-        {
-            current_state = table_value & TOK_MASK;
-            NEOAST_STACK_PUSH(buffers->parsing_stack, i);
-            NEOAST_STACK_PUSH(buffers->parsing_stack, current_state);
-            prev_tok = tok;
-
-            lex_val += buffers->val_s;
-            tok = ll_next(lexer, lex_val, context);
-            buffers->token_table[++i] = tok;
-        }
-        else if (table_value & TOK_REDUCE_MASK)
-        {
-            // Goto rules cannot occur here
-            assert(tok < parser->action_token_n);
+void parser_abort_lr(const GrammarParser* parser, ParserBuffers* buffers)
+{
+    if (buffers->parsing_stack->pos == 0)
+    {
+        // Nothing left of the parse
+        return;
+    }
 
-            // Reduce this rule
-            current_state = g_lr_reduce(parser, context, parsing_table,
-                                        table_value, buffers,
-                                        &dest_idx);
+    uint32_t lookahead = buffers->parsing_stack->pos >> 1;
+    parser_run_destructors(parser, buffers, buffers->has_lookahead ? (int32_t) lookahead : -1);
+    parser_reset_buffers(buffers);
+}
 
-            // Don't move on empty rule
-            if (i != dest_idx)
-            {
-                // Move the lookahead to the slot in front of the
-                // result. We should do this so that we don't fill up the
-                // buffer tables. As rules reduce we reduce our footprint
-                // on the buffers.
-                assert(buffers->token_table[i] == tok);
-                void* dest_val = OFFSET_VOID_PTR(buffers->value_table, buffers->val_s, dest_idx + 1);
-                memcpy(dest_val, lex_val, buffers->val_s);
-                buffers->token_table[dest_idx + 1] = buffers->token_table[i];
-
-                lex_val = dest_val;
-                i = dest_idx + 1;
-            }
 
-            prev_tok = parser->grammar_rules[table_value & TOK_MASK].token - NEOAST_ASCII_MAX;
-        }
-        else if (table_value & TOK_ACCEPT_MASK)
-        {
-            return (int32_t) dest_idx;
-        }
+int32_t parser_validate_lr(const GrammarParser* parser,
+                           void* context,
+                           const void* parsing_table,
+                           ParserBuffers* buffers,
+                           void* lexer,
+                           int ll_next(void*, void*, void*),
+                           TokenPosition* error_position)
+{
+    switch (parser->table_format)
+    {
+        case TABLE_FORMAT_COMPRESSED:
+            return parser_validate_lr_impl(parser, context, parsing_table, TABLE_FORMAT_COMPRESSED,
+                                           buffers, lexer, ll_next, error_position);
+        case TABLE_FORMAT_SPLIT_8:
+            return parser_validate_lr_impl(parser, context, parsing_table, TABLE_FORMAT_SPLIT_8,
+                                           buffers, lexer, ll_next, error_position);
+        case TABLE_FORMAT_SPLIT_16:
+            return parser_validate_lr_impl(parser, context, parsing_table, TABLE_FORMAT_SPLIT_16,
+                                           buffers, lexer, ll_next, error_position);
+        case TABLE_FORMAT_SPLIT_32:
+            return parser_validate_lr_impl(parser, context, parsing_table, TABLE_FORMAT_SPLIT_32,
+                                           buffers, lexer, ll_next, error_position);
+        case TABLE_FORMAT_DENSE:
+        default:
+            return parser_validate_lr_impl(parser, context, parsing_table, TABLE_FORMAT_DENSE,
+                                           buffers, lexer, ll_next, error_position);
     }
 }
+
+void* parser_push_value(const ParserBuffers* buffers)
+{
+    // The lookahead always goes right above the value stack
+    return OFFSET_VOID_PTR(buffers->value_table, buffers->val_s,
+                           buffers->parsing_stack->pos >> 1);
+}
+
+push_status_t parser_push_token(const GrammarParser* parser,
+                                void* context,
+                                const void* parsing_table,
+                                ParserBuffers* buffers,
+                                int32_t tok)
+{
+    int32_t result = parser_parse_lr_dispatch(parser, context, parsing_table, buffers, NULL, NULL, tok, 0);
+
+    if (result == LR_NEED_MORE)
+    {
+        return NEOAST_PUSH_NEED_MORE;
+    }
+
+    // This parse is finished, the next token starts a new one
+    parser_reset_buffers(buffers);
+    if (result < 0)
+    {
+        return NEOAST_PUSH_ERROR;
+    }
+
+    assert(result == 0);
+    return NEOAST_PUSH_ACCEPT;
+}
@@ -34,27 +34,109 @@ void parser_free_stack(ParsingStack* self)
     free(self);
 }
 
+// Initial number of values and stack entries, the buffers
+// of an idle parser should stay small
+#define NEOAST_BUFFERS_INITIAL_N (32)
+
+static inline uint32_t parser_initial_size(uint32_t max_n)
+{
+    return max_n && max_n < NEOAST_BUFFERS_INITIAL_N ? max_n : NEOAST_BUFFERS_INITIAL_N;
+}
+
 ParserBuffers* parser_allocate_buffers(int max_tokens,
                                        int parsing_stack_n,
                                        size_t val_s,
                                        size_t union_s)
 {
     ParserBuffers* buffers = malloc(sizeof(ParserBuffers));
-    buffers->parsing_stack = parser_allocate_stack(parsing_stack_n);
-    buffers->token_table = malloc(sizeof(uint32_t) * max_tokens);
-    buffers->value_table = malloc(val_s * max_tokens);
+    buffers->max_table_n = max_tokens > 0 ? max_tokens : 0;
+    buffers->max_stack_n = parsing_stack_n > 0 ? parsing_stack_n : 0;
+    buffers->table_n = parser_initial_size(buffers->max_table_n);
+    buffers->stack_n = parser_initial_size(buffers->max_stack_n);
+
+    buffers->parsing_stack = parser_allocate_stack(buffers->stack_n);
+    buffers->token_table = malloc(sizeof(uint32_t) * buffers->table_n);
+    buffers->value_table = malloc(val_s * buffers->table_n);
+    buffers->reduce_dest = malloc(val_s);
+    buffers->arena = neoast_arena_new();
+    buffers->lines = neoast_lines_new();
+    buffers->has_lookahead = 0;
+    NEOAST_STAT(memset(&buffers->stats, 0, sizeof(ParserStats)));
     buffers->val_s = val_s;
     buffers->union_s = union_s;
-    buffers->table_n = max_tokens;
 
     return buffers;
 }
 
+static uint32_t parser_grow_size(uint32_t current, uint32_t required, uint32_t max_n)
+{
+    uint32_t limit = max_n ? max_n : UINT32_MAX;
+    uint32_t n = current ? current : 1;
+    while (n < required)
+    {
+        // Doubling again would pass the limit or wrap around
+        if (n > limit / 2)
+        {
+            return limit;
+        }
+
+        n *= 2;
+    }
+
+    return n;
+}
+
+int parser_grow_buffers(ParserBuffers* self, uint32_t table_n, uint32_t stack_n)
+{
+    if ((self->max_table_n && table_n > self->max_table_n)
+        || (self->max_stack_n && stack_n > self->max_stack_n))
+    {
+        return -1;
+    }
+
+    if (table_n > self->table_n)
+    {
+        uint32_t n = parser_grow_size(self->table_n, table_n, self->max_table_n);
+        int32_t* token_table = realloc(self->token_table, sizeof(uint32_t) * n);
+        if (!token_table)
+        {
+            return -1;
+        }
+        self->token_table = token_table;
+
+        void* value_table = realloc(self->value_table, (size_t) self->val_s * n);
+        if (!value_table)
+        {
+            return -1;
+        }
+        self->value_table = value_table;
+        self->table_n = n;
+    }
+
+    if (stack_n > self->stack_n)
+    {
+        uint32_t n = parser_grow_size(self->stack_n, stack_n, self->max_stack_n);
+        ParsingStack* stack = realloc(self->parsing_stack, sizeof(ParsingStack) + sizeof(uint32_t) * n);
+        if (!stack)
+        {
+            return -1;
+        }
+        self->parsing_stack = stack;
+        self->stack_n = n;
+    }
+
+    return 0;
+}
+
 void parser_free_buffers(ParserBuffers* self)
 {
     parser_free_stack(self->parsing_stack);
     free(self->token_table);
     free(self->value_table);
+    free(self->reduce_dest);
+    neoast_arena_free(self->arena);
+    neoast_lines_free(self->lines);
+    NEOAST_STAT(free(self->stats.rule_reduces));
     free(self);
 }
 
@@ -62,3 +144,44 @@ void parser_reset_buffers(const ParserBuffers* self)
 {
     self->parsing_stack->pos = 0;
 }
+
+#ifdef NEOAST_STATS
+const ParserStats* parser_get_stats(const ParserBuffers* self)
+{
+    return &self->stats;
+}
+
+void parser_reset_stats(ParserBuffers* self)
+{
+    free(self->stats.rule_reduces);
+    memset(&self->stats, 0, sizeof(ParserStats));
+}
+
+void parser_stats_reduce(ParserStats* self, uint32_t rule_id)
+{
+    if (rule_id >= self->rule_n)
+    {
+        // Parsers don't share their rule count, grow as rules show up
+        uint32_t n = self->rule_n ? self->rule_n : 16;
+        while (n <= rule_id)
+        {
+            n *= 2;
+        }
+
+        uint64_t* rule_reduces = realloc(self->rule_reduces, sizeof(uint64_t) * n);
+        if (!rule_reduces)
+        {
+            // Keep the total, this rule just won't be counted
+            self->reduces++;
+            return;
+        }
+
+        memset(rule_reduces + self->rule_n, 0, sizeof(uint64_t) * (n - self->rule_n));
+        self->rule_reduces = rule_reduces;
+        self->rule_n = n;
+    }
+
+    self->reduces++;
+    self->rule_reduces[rule_id]++;
+}
+#endif
@@ -223,7 +223,8 @@ namespace parsergen
         }
     }
 
-    uint32_t CanonicalCollection::generate(uint32_t* table, const uint8_t* precedence_table) const
+    uint32_t CanonicalCollection::generate(uint32_t* table, const uint8_t* precedence_table,
+                                           uint32_t* default_reductions) const
     {
         auto* curr_row = table;
         uint32_t rr_conflicts = 0, sr_conflicts = 0;
@@ -233,7 +234,12 @@ namespace parsergen
             auto* state = get_state(state_id);
 
             // Fill the row
-            state->fill_table(curr_row, rr_conflicts, sr_conflicts, precedence_table);
+            uint32_t default_reduction = state->fill_table(curr_row, rr_conflicts,
+                                                           sr_conflicts, precedence_table);
+            if (default_reductions)
+            {
+                default_reductions[state_id] = default_reduction;
+            }
 
             // Increment by an entire row
             curr_row += parser_->token_n;
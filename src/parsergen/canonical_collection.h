@@ -161,9 +161,12 @@ namespace parsergen
          * Write the parsing table to a matrix
          * @param table matrix to fill parsing table with
          * @param precedence_table precedence_table  or null
+         * @param default_reductions per state default reduction (size()) or null,
+         *        set to TOK_SYNTAX_ERROR for states that need a lookahead
          * @return error code or 0 for success
          */
-        uint32_t generate(uint32_t* table, const uint8_t* precedence_table) const;
+        uint32_t generate(uint32_t* table, const uint8_t* precedence_table,
+                          uint32_t* default_reductions = nullptr) const;
     };
 }
 
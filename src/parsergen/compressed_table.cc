@@ -0,0 +1,162 @@
+/*
+ * This file is part of the Neoast framework
+ * Copyright (c) 2021 Andrei Tumbar.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "compressed_table.h"
+#include <algorithm>
+#include <unordered_map>
+
+namespace parsergen
+{
+    constexpr uint32_t TableCompressor::CHECK_EMPTY;
+
+    TableCompressor::TableCompressor(const uint32_t* table, uint32_t state_n, uint32_t token_n,
+                                     const uint32_t* default_reductions)
+    : base_(state_n, 0), defaults_(state_n, TOK_SYNTAX_ERROR)
+    {
+        // Non-default (column, action) entries in each row
+        std::vector<std::vector<std::pair<uint32_t, uint32_t>>> rows(state_n);
+
+        for (uint32_t state = 0; state < state_n; state++)
+        {
+            const uint32_t* row = &table[state * token_n];
+
+            if (default_reductions && default_reductions[state] != TOK_SYNTAX_ERROR)
+            {
+                // Only the gotos of this state will ever be looked up
+                defaults_[state] = default_reductions[state];
+                for (uint32_t tok = 0; tok < token_n; tok++)
+                {
+                    if (row[tok] != TOK_SYNTAX_ERROR && row[tok] != default_reductions[state])
+                    {
+                        rows[state].emplace_back(tok, row[tok]);
+                    }
+                }
+
+                continue;
+            }
+
+            // The most frequent action becomes the default
+            // Ties are broken in favor of the syntax error so that
+            // error rows stay small and lookups stay deterministic
+            std::unordered_map<uint32_t, uint32_t> counts;
+            uint32_t best = TOK_SYNTAX_ERROR;
+            uint32_t best_n = 0;
+            for (uint32_t tok = 0; tok < token_n; tok++)
+            {
+                uint32_t n = ++counts[row[tok]];
+                if (n > best_n || (n == best_n && row[tok] == TOK_SYNTAX_ERROR))
+                {
+                    best = row[tok];
+                    best_n = n;
+                }
+            }
+
+            defaults_[state] = best;
+            for (uint32_t tok = 0; tok < token_n; tok++)
+            {
+                if (row[tok] != best)
+                {
+                    rows[state].emplace_back(tok, row[tok]);
+                }
+            }
+        }
+
+        // Place the densest rows first, they are
+        // the hardest to fit into the comb
+        std::vector<uint32_t> order(state_n);
+        for (uint32_t i = 0; i < state_n; i++) order[i] = i;
+        std::stable_sort(order.begin(), order.end(), [&rows](uint32_t a, uint32_t b) {
+            return rows[a].size() > rows[b].size();
+        });
+
+        uint32_t first_free = 0;
+        uint32_t max_base = 0;
+        for (uint32_t state : order)
+        {
+            const auto& entries = rows[state];
+            if (entries.empty())
+            {
+                // Nothing to place, every lookup will miss the check
+                continue;
+            }
+
+            // First fit: find the lowest displacement where all
+            // of the entries of this row land in empty slots
+            uint32_t base = first_free > entries[0].first ? first_free - entries[0].first : 0;
+            for (;; base++)
+            {
+                bool fits = true;
+                for (const auto& e : entries)
+                {
+                    uint32_t i = base + e.first;
+                    if (i < check_.size() && check_[i] != CHECK_EMPTY)
+                    {
+                        fits = false;
+                        break;
+                    }
+                }
+
+                if (fits) break;
+            }
+
+            if (check_.size() < base + token_n)
+            {
+                check_.resize(base + token_n, CHECK_EMPTY);
+                next_.resize(base + token_n, TOK_SYNTAX_ERROR);
+            }
+
+            for (const auto& e : entries)
+            {
+                check_[base + e.first] = state;
+                next_[base + e.first] = e.second;
+            }
+
+            base_[state] = base;
+            max_base = std::max(max_base, base);
+            for (; first_free < check_.size() && check_[first_free] != CHECK_EMPTY; first_free++);
+        }
+
+        // Any base + token must index inside the vectors
+        if (check_.size() < max_base + token_n)
+        {
+            check_.resize(max_base + token_n, CHECK_EMPTY);
+            next_.resize(max_base + token_n, TOK_SYNTAX_ERROR);
+        }
+    }
+
+    CompressedTable TableCompressor::get() const
+    {
+        CompressedTable out;
+        out.base = base_.data();
+        out.defaults = defaults_.data();
+        out.next = next_.data();
+        out.check = check_.data();
+        return out;
+    }
+
+    uint32_t TableCompressor::lookup(uint32_t state, uint32_t tok) const
+    {
+        uint32_t i = base_[state] + tok;
+        if (check_[i] == state)
+        {
+            return next_[i];
+        }
+
+        return defaults_[state];
+    }
+}
@@ -0,0 +1,82 @@
+/*
+ * This file is part of the Neoast framework
+ * Copyright (c) 2021 Andrei Tumbar.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef NEOAST_COMPRESSED_TABLE_H
+#define NEOAST_COMPRESSED_TABLE_H
+
+#include <neoast.h>
+#include <vector>
+
+namespace parsergen
+{
+    /**
+     * Row displacement (comb) compression of a dense
+     * LR parsing table. Each state keeps its most common
+     * action as the default and stores every other entry
+     * in the shared next/check vectors.
+     */
+    class TableCompressor
+    {
+        std::vector<uint32_t> base_;
+        std::vector<uint32_t> defaults_;
+        std::vector<uint32_t> next_;
+        std::vector<uint32_t> check_;
+
+    public:
+        // Marks a slot in check that belongs to no state
+        static constexpr uint32_t CHECK_EMPTY = 0xFFFFFFFF;
+
+        /**
+         * Compress a dense parsing table
+         * @param table state_n x token_n matrix generated by CanonicalCollection::generate
+         * @param state_n number of rows (states)
+         * @param token_n number of columns (tokens)
+         * @param default_reductions default reductions from CanonicalCollection::generate or null.
+         *        The parser never consults the actions of these states so their
+         *        syntax errors are folded into the default.
+         */
+        TableCompressor(const uint32_t* table, uint32_t state_n, uint32_t token_n,
+                        const uint32_t* default_reductions = nullptr);
+
+        inline const std::vector<uint32_t>& base() const { return base_; }
+        inline const std::vector<uint32_t>& defaults() const { return defaults_; }
+        inline const std::vector<uint32_t>& next() const { return next_; }
+        inline const std::vector<uint32_t>& check() const { return check_; }
+
+        /**
+         * @return A table view that may be passed to parser_parse_lr().
+         *         Only valid for the lifetime of this compressor.
+         */
+        CompressedTable get() const;
+
+        /**
+         * Decompress a single entry
+         * @param state row of the dense table
+         * @param tok column of the dense table
+         * @return action in the parsing table
+         */
+        uint32_t lookup(uint32_t state, uint32_t tok) const;
+
+        /**
+         * @return Number of 32-bit words needed to hold the compressed table
+         */
+        inline size_t size() const
+        { return base_.size() + defaults_.size() + next_.size() + check_.size(); }
+    };
+}
+
+#endif //NEOAST_COMPRESSED_TABLE_H
@@ -192,8 +192,8 @@ namespace parsergen
         }
     }
 
-    void GrammarState::fill_table(uint32_t* row, uint32_t &rr_conflicts, uint32_t &sr_conflicts,
-                                  const uint8_t* precedence_table) const
+    uint32_t GrammarState::fill_table(uint32_t* row, uint32_t &rr_conflicts, uint32_t &sr_conflicts,
+                                      const uint8_t* precedence_table) const
     {
         // The row starts initialized with zeroes (syntax error)
         // We just need to fill in SHIFT, GOTO (basically just shift), and REDUCE
@@ -276,6 +276,29 @@ namespace parsergen
                 row[i] = action_mask | reduce_id;
             }
         }
+
+        // A consistent (LR(0)-reduce) state only has a single
+        // reduction in its action columns. The parser may perform this
+        // reduction without reading the lookahead because any invalid token
+        // will still be caught by the next state before it is shifted.
+        uint32_t default_reduction = TOK_SYNTAX_ERROR;
+        for (uint32_t i = 0; i < cc->parser()->action_token_n; i++)
+        {
+            if (row[i] == TOK_SYNTAX_ERROR)
+            {
+                continue;
+            }
+
+            if (!(row[i] & TOK_REDUCE_MASK)
+                || (default_reduction != TOK_SYNTAX_ERROR && default_reduction != row[i]))
+            {
+                return TOK_SYNTAX_ERROR;
+            }
+
+            default_reduction = row[i];
+        }
+
+        return default_reduction;
     }
 
     bool GrammarState::lalr_equal(const GrammarState &other) const
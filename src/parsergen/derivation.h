@@ -188,7 +188,14 @@ namespace parsergen
          * (fill dfa)
          */
         void resolve() const;
-        void fill_table(uint32_t row[],
+
+        /**
+         * Fill this state's row of the parsing table
+         * @return the default reduction of this state if it is consistent
+         *         (every valid action token reduces the same rule),
+         *         TOK_SYNTAX_ERROR otherwise
+         */
+        uint32_t fill_table(uint32_t row[],
                         uint32_t& rr_conflicts,
                         uint32_t& sr_conflicts,
                         const uint8_t* precedence_table) const;
@@ -0,0 +1,83 @@
+/*
+ * This file is part of the Neoast framework
+ * Copyright (c) 2021 Andrei Tumbar.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "split_table.h"
+
+namespace parsergen
+{
+    TableSplitter::TableSplitter(const uint32_t* table, uint32_t state_n, uint32_t token_n,
+                                 uint32_t action_token_n, uint32_t grammar_n)
+    : actions_(state_n * action_token_n, 0),
+      gotos_(state_n * (token_n - action_token_n), 0),
+      state_n_(state_n), token_n_(token_n), action_token_n_(action_token_n)
+    {
+        uint32_t goto_n = token_n - action_token_n;
+        for (uint32_t state = 0; state < state_n; state++)
+        {
+            const uint32_t* row = &table[state * token_n];
+            for (uint32_t tok = 0; tok < action_token_n; tok++)
+            {
+                uint32_t entry = row[tok];
+                if (entry == TOK_SYNTAX_ERROR) continue;
+                else if (entry & TOK_SHIFT_MASK) entry &= TOK_MASK;
+                else if (entry & TOK_ACCEPT_MASK) entry = state_n;
+                else entry = state_n + (entry & TOK_MASK);
+
+                actions_[state * action_token_n + tok] = entry;
+            }
+
+            for (uint32_t tok = action_token_n; tok < token_n; tok++)
+            {
+                gotos_[state * goto_n + tok - action_token_n] = row[tok] & TOK_MASK;
+            }
+        }
+
+        // The largest entry is a reduction of the last rule
+        uint64_t max_entry = (uint64_t) state_n + grammar_n - 1;
+        if (max_entry <= UINT8_MAX) format_ = TABLE_FORMAT_SPLIT_8;
+        else if (max_entry <= UINT16_MAX) format_ = TABLE_FORMAT_SPLIT_16;
+        else format_ = TABLE_FORMAT_SPLIT_32;
+    }
+
+    size_t TableSplitter::entry_size() const
+    {
+        switch (format_)
+        {
+            case TABLE_FORMAT_SPLIT_8:
+                return sizeof(uint8_t);
+            case TABLE_FORMAT_SPLIT_16:
+                return sizeof(uint16_t);
+            default:
+                return sizeof(uint32_t);
+        }
+    }
+
+    uint32_t TableSplitter::lookup(uint32_t state, uint32_t tok) const
+    {
+        if (tok >= action_token_n_)
+        {
+            uint32_t next_state = gotos_[state * (token_n_ - action_token_n_) + tok - action_token_n_];
+            return next_state ? next_state | TOK_SHIFT_MASK : TOK_SYNTAX_ERROR;
+        }
+
+        uint32_t entry = actions_[state * action_token_n_ + tok];
+        if (entry == 0) return TOK_SYNTAX_ERROR;
+        else if (entry < state_n_) return entry | TOK_SHIFT_MASK;
+        else if (entry == state_n_) return TOK_ACCEPT_MASK;
+        return (entry - state_n_) | TOK_REDUCE_MASK;
+    }
+}
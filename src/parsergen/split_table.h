@@ -0,0 +1,82 @@
+/*
+ * This file is part of the Neoast framework
+ * Copyright (c) 2021 Andrei Tumbar.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef NEOAST_SPLIT_TABLE_H
+#define NEOAST_SPLIT_TABLE_H
+
+#include <neoast.h>
+#include <vector>
+
+namespace parsergen
+{
+    /**
+     * Split a dense LR parsing table into an action matrix
+     * over the terminals and a goto matrix over the nonterminals.
+     * Entries are re-encoded (see SplitTable) so that they fit
+     * in the narrowest integer type possible.
+     */
+    class TableSplitter
+    {
+        std::vector<uint32_t> actions_;
+        std::vector<uint32_t> gotos_;
+        table_format_t format_;
+        uint32_t state_n_;
+        uint32_t token_n_;
+        uint32_t action_token_n_;
+
+    public:
+        /**
+         * Split a dense parsing table
+         * @param table state_n x token_n matrix generated by CanonicalCollection::generate
+         * @param state_n number of rows (states)
+         * @param token_n number of columns (tokens)
+         * @param action_token_n number of terminals, the first columns of the table
+         * @param grammar_n number of grammar rules
+         */
+        TableSplitter(const uint32_t* table, uint32_t state_n, uint32_t token_n,
+                      uint32_t action_token_n, uint32_t grammar_n);
+
+        inline const std::vector<uint32_t>& actions() const { return actions_; }
+        inline const std::vector<uint32_t>& gotos() const { return gotos_; }
+
+        /**
+         * @return TABLE_FORMAT_SPLIT_8, _16 or _32 depending on the largest entry
+         */
+        inline table_format_t format() const { return format_; }
+
+        /**
+         * @return Size of a single entry in bytes
+         */
+        size_t entry_size() const;
+
+        /**
+         * Decode a single entry
+         * @param state row of the dense table
+         * @param tok column of the dense table
+         * @return action in the parsing table
+         */
+        uint32_t lookup(uint32_t state, uint32_t tok) const;
+
+        /**
+         * @return Number of bytes needed to hold the split table
+         */
+        inline size_t size() const
+        { return (actions_.size() + gotos_.size()) * entry_size(); }
+    };
+}
+
+#endif //NEOAST_SPLIT_TABLE_H
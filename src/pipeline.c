@@ -0,0 +1,205 @@
+/*
+ * This file is part of the Neoast framework
+ * Copyright (c) 2021 Andrei Tumbar.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include <neoast.h>
+
+// Tokens in flight between the lexer and the parser, power of 2
+#define NEOAST_PIPELINE_N (1024)
+#define NEOAST_PIPELINE_MASK (NEOAST_PIPELINE_N - 1)
+#define NEOAST_CACHE_LINE (64)
+
+// Lexed tokens are handed to the parser in batches
+// to cut down on traffic between the two cores
+#define NEOAST_PIPELINE_BATCH (32)
+
+// Times to poll the other thread before giving up the core
+#define NEOAST_PIPELINE_SPIN (128)
+
+typedef struct NeoastPipeline_prv NeoastPipeline;
+
+/**
+ * Single producer, single consumer ring of lexed tokens
+ * head is only written by the lexer thread and tail only
+ * by the parser thread. Each side keeps a copy of the
+ * other's index to only touch the shared line when
+ * it looks like the ring is full or empty.
+ */
+struct NeoastPipeline_prv
+{
+    void* lexer;
+    int (*ll_next)(void*, void*, void*);
+    void* context;
+    size_t val_s;
+    int32_t* tokens;
+    char* values;
+
+    // Lexer thread
+    uint32_t head __attribute__((aligned(NEOAST_CACHE_LINE)));
+    uint32_t tail_cache;
+    int stop;
+
+    // Parser thread
+    uint32_t tail __attribute__((aligned(NEOAST_CACHE_LINE)));
+    uint32_t head_cache;
+};
+
+static inline char* pipeline_value(const NeoastPipeline* self, uint32_t i)
+{
+    return self->values + self->val_s * (i & NEOAST_PIPELINE_MASK);
+}
+
+static inline void pipeline_wait(uint32_t* spins)
+{
+    if (++(*spins) > NEOAST_PIPELINE_SPIN)
+    {
+        sched_yield();
+    }
+}
+
+static void* pipeline_lex(void* self_)
+{
+    NeoastPipeline* self = self_;
+    uint32_t head = self->head;
+    uint32_t spins = 0;
+
+    while (!__atomic_load_n(&self->stop, __ATOMIC_RELAXED))
+    {
+        if (head - self->tail_cache == NEOAST_PIPELINE_N)
+        {
+            // Wait for the parser to catch up
+            __atomic_store_n(&self->head, head, __ATOMIC_RELEASE);
+            self->tail_cache = __atomic_load_n(&self->tail, __ATOMIC_ACQUIRE);
+            if (head - self->tail_cache == NEOAST_PIPELINE_N)
+            {
+                pipeline_wait(&spins);
+                continue;
+            }
+        }
+
+        spins = 0;
+        int32_t tok = self->ll_next(self->lexer, pipeline_value(self, head), self->context);
+        self->tokens[head & NEOAST_PIPELINE_MASK] = tok;
+        head++;
+
+        if (tok <= 0)
+        {
+            // EOF or lexing error, the parser won't ask for more
+            __atomic_store_n(&self->head, head, __ATOMIC_RELEASE);
+            break;
+        }
+        else if (head % NEOAST_PIPELINE_BATCH == 0)
+        {
+            __atomic_store_n(&self->head, head, __ATOMIC_RELEASE);
+        }
+    }
+
+    // Publish the rest of the batch so the parser can drop it
+    __atomic_store_n(&self->head, head, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+static int pipeline_next(void* self_, void* dest, void* context)
+{
+    (void) context;
+    NeoastPipeline* self = self_;
+    uint32_t tail = self->tail;
+    uint32_t spins = 0;
+
+    while (tail == self->head_cache)
+    {
+        // Wait for the lexer to catch up
+        self->head_cache = __atomic_load_n(&self->head, __ATOMIC_ACQUIRE);
+        if (tail == self->head_cache)
+        {
+            pipeline_wait(&spins);
+        }
+    }
+
+    int32_t tok = self->tokens[tail & NEOAST_PIPELINE_MASK];
+    memcpy(dest, pipeline_value(self, tail), self->val_s);
+    __atomic_store_n(&self->tail, tail + 1, __ATOMIC_RELEASE);
+    return tok;
+}
+
+int32_t parser_parse_lr_pipelined(const GrammarParser* parser,
+                                  void* context,
+                                  const void* parsing_table,
+                                  ParserBuffers* buffers,
+                                  void* lexer,
+                                  int ll_next(void*, void*, void*))
+{
+    NeoastPipeline* self = NULL;
+    if (posix_memalign((void**) &self, NEOAST_CACHE_LINE, sizeof(NeoastPipeline)) != 0)
+    {
+        self = NULL;
+    }
+
+    char* values = malloc(buffers->val_s * NEOAST_PIPELINE_N);
+    int32_t* tokens = malloc(sizeof(int32_t) * NEOAST_PIPELINE_N);
+    pthread_t lexer_thread;
+
+    if (!self || !values || !tokens)
+    {
+        free(self);
+        free(values);
+        free(tokens);
+        return parser_parse_lr(parser, context, parsing_table, buffers, lexer, ll_next);
+    }
+
+    memset(self, 0, sizeof(NeoastPipeline));
+    self->lexer = lexer;
+    self->ll_next = ll_next;
+    self->context = context;
+    self->val_s = buffers->val_s;
+    self->values = values;
+    self->tokens = tokens;
+
+    int32_t result;
+    if (pthread_create(&lexer_thread, NULL, pipeline_lex, self) != 0)
+    {
+        // No thread to spare, lex and parse on this one
+        result = parser_parse_lr(parser, context, parsing_table, buffers, lexer, ll_next);
+    }
+    else
+    {
+        result = parser_parse_lr(parser, context, parsing_table, buffers, self, pipeline_next);
+
+        // The parse may have stopped early on a syntax error
+        __atomic_store_n(&self->stop, 1, __ATOMIC_RELAXED);
+        pthread_join(lexer_thread, NULL);
+
+        // Drop the tokens that were lexed but never parsed
+        for (uint32_t i = self->tail; i != self->head; i++)
+        {
+            int32_t tok = self->tokens[i & NEOAST_PIPELINE_MASK];
+            if (tok > 0 && parser->destructors && parser->destructors[tok])
+            {
+                parser->destructors[tok](pipeline_value(self, i));
+            }
+        }
+    }
+
+    free(values);
+    free(tokens);
+    free(self);
+    return result;
+}
@@ -0,0 +1,136 @@
+/*
+ * This file is part of the Neoast framework
+ * Copyright (c) 2021 Andrei Tumbar.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <neoast.h>
+#include <lexer/matcher_priv.h>
+
+// Columns are counted like the lexer counts them
+#define NEOAST_TAB_STOP (8)
+#define NEOAST_LINES_INITIAL_N (64)
+
+struct NeoastLines_prv
+{
+    const char* text;
+    uint64_t len;
+    uint64_t indexed;       //!< Bytes of the text searched for newlines
+    uint64_t* starts;       //!< Offset of every line but the first
+    uint32_t start_n;
+    uint32_t start_s;
+};
+
+NeoastLines* neoast_lines_new(void)
+{
+    NeoastLines* self = malloc(sizeof(NeoastLines));
+    self->starts = NULL;
+    self->start_s = 0;
+    neoast_lines_reset(self, NULL, 0);
+    return self;
+}
+
+void neoast_lines_reset(NeoastLines* self, const char* text, uint64_t len)
+{
+    // Keep the index storage for the next text
+    self->text = text;
+    self->len = text ? len : 0;
+    self->indexed = 0;
+    self->start_n = 0;
+}
+
+void neoast_lines_free(NeoastLines* self)
+{
+    free(self->starts);
+    free(self);
+}
+
+/**
+ * Record the start of every line up to an offset
+ * @return 0 on success, -1 if memory ran out
+ */
+static int lines_index(NeoastLines* self, uint64_t offset)
+{
+    const char* s = self->text + self->indexed;
+    const char* e = self->text + offset;
+
+    // Make room for every line at once
+    size_t line_n = matcher_count_lines(s, e);
+    if (line_n > UINT32_MAX / 2 - self->start_n)
+    {
+        // Lines are counted in 32 bits
+        return -1;
+    }
+    else if (self->start_n + line_n > self->start_s)
+    {
+        uint32_t n = self->start_s ? self->start_s : NEOAST_LINES_INITIAL_N;
+        while (n < self->start_n + line_n)
+        {
+            n *= 2;
+        }
+
+        uint64_t* starts = realloc(self->starts, sizeof(uint64_t) * n);
+        if (!starts)
+        {
+            return -1;
+        }
+
+        self->starts = starts;
+        self->start_s = n;
+    }
+
+    while (s < e && (s = memchr(s, '\n', e - s)))
+    {
+        self->starts[self->start_n++] = ++s - self->text;
+    }
+
+    self->indexed = offset;
+    return 0;
+}
+
+int neoast_lines_locate(NeoastLines* self, uint64_t offset, TokenLocation* location)
+{
+    if (!self || !self->text || offset > self->len)
+    {
+        return -1;
+    }
+
+    if (offset > self->indexed && lines_index(self, offset) != 0)
+    {
+        return -1;
+    }
+
+    // Lines starting at or before the offset
+    uint32_t lo = 0;
+    uint32_t hi = self->start_n;
+    while (lo < hi)
+    {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (self->starts[mid] <= offset)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+
+    uint64_t bol = lo ? self->starts[lo - 1] : 0;
+    location->line = lo + 1;
+    location->col = matcher_count_columns(self->text + bol, self->text + offset, 0, NEOAST_TAB_STOP);
+    return 0;
+}
@@ -17,6 +17,8 @@
 
 #include <neoast.h>
 #include <parsergen/canonical_collection.h>
+#include <parsergen/compressed_table.h>
+#include <parsergen/split_table.h>
 #include <util/util.h>
 
 extern "C" {
@@ -181,6 +183,93 @@ CTEST(test_tablegen)
     assert_memory_equal(table.get(), expected_lalr1_table, sizeof(expected_lalr1_table));
 }
 
+CTEST(test_table_compression)
+{
+    CanonicalCollection cc(&simple_p, nullptr, nullptr);
+    cc.resolve(LALR_1);
+
+    std::unique_ptr<uint32_t[]> table = std::unique_ptr<uint32_t[]>(new uint32_t[cc.table_size()]);
+    uint8_t error = cc.generate(table.get(), nullptr);
+    assert_int_equal(error, 0);
+
+    TableCompressor compressed(table.get(), cc.size(), simple_p.token_n);
+    assert_int_equal(compressed.base().size(), cc.size());
+    assert_int_equal(compressed.defaults().size(), cc.size());
+    assert_int_equal(compressed.next().size(), compressed.check().size());
+
+    // Every entry must decompress to the dense value
+    for (uint32_t state = 0; state < cc.size(); state++)
+    {
+        for (uint32_t tok = 0; tok < simple_p.token_n; tok++)
+        {
+            assert_int_equal(compressed.lookup(state, tok), table[state * simple_p.token_n + tok]);
+        }
+    }
+}
+
+CTEST(test_table_split)
+{
+    CanonicalCollection cc(&simple_p, nullptr, nullptr);
+    cc.resolve(LALR_1);
+
+    std::unique_ptr<uint32_t[]> table = std::unique_ptr<uint32_t[]>(new uint32_t[cc.table_size()]);
+    uint8_t error = cc.generate(table.get(), nullptr);
+    assert_int_equal(error, 0);
+
+    TableSplitter split(table.get(), cc.size(), simple_p.token_n,
+                        simple_p.action_token_n, simple_p.grammar_n);
+    assert_int_equal(split.format(), TABLE_FORMAT_SPLIT_8);
+    assert_int_equal(split.actions().size(), cc.size() * simple_p.action_token_n);
+    assert_int_equal(split.gotos().size(), cc.size() * (simple_p.token_n - simple_p.action_token_n));
+    assert_int_equal(split.size(), cc.table_size());
+
+    // Every entry must decode to the dense value
+    for (uint32_t state = 0; state < cc.size(); state++)
+    {
+        for (uint32_t tok = 0; tok < simple_p.token_n; tok++)
+        {
+            assert_int_equal(split.lookup(state, tok), table[state * simple_p.token_n + tok]);
+        }
+    }
+}
+
+CTEST(test_default_reductions)
+{
+    CanonicalCollection cc(&simple_p, nullptr, nullptr);
+    cc.resolve(LALR_1);
+
+    std::unique_ptr<uint32_t[]> table = std::unique_ptr<uint32_t[]>(new uint32_t[cc.table_size()]);
+    std::unique_ptr<uint32_t[]> defaults = std::unique_ptr<uint32_t[]>(new uint32_t[cc.size()]);
+    uint8_t error = cc.generate(table.get(), nullptr, defaults.get());
+    assert_int_equal(error, 0);
+
+    // Only the states that reduce a single rule are consistent
+    static const uint32_t expected_defaults[] = {
+            LR_E( ), LR_E( ), LR_E( ), LR_E( ), LR_R(3), LR_R(2), LR_R(1)
+    };
+
+    assert_int_equal(cc.size(), NEOAST_ARR_LEN(expected_defaults));
+    assert_memory_equal(defaults.get(), expected_defaults, sizeof(expected_defaults));
+
+    // Consistent states only need to keep their gotos
+    TableCompressor compressed(table.get(), cc.size(), simple_p.token_n, defaults.get());
+    for (uint32_t state = 0; state < cc.size(); state++)
+    {
+        for (uint32_t tok = 0; tok < simple_p.token_n; tok++)
+        {
+            uint32_t dense = table[state * simple_p.token_n + tok];
+            if (defaults[state] && dense == TOK_SYNTAX_ERROR)
+            {
+                assert_int_equal(compressed.lookup(state, tok), defaults[state]);
+            }
+            else
+            {
+                assert_int_equal(compressed.lookup(state, tok), dense);
+            }
+        }
+    }
+}
+
 CTEST(test_lookaheads)
 {
     CanonicalCollection cc(&simple_p, nullptr, nullptr);
@@ -255,6 +344,9 @@ int main()
             cmocka_unit_test(test_lr1_lr0_sorting),
             cmocka_unit_test(test_bit_vector),
             cmocka_unit_test(test_tablegen),
+            cmocka_unit_test(test_table_compression),
+            cmocka_unit_test(test_table_split),
+            cmocka_unit_test(test_default_reductions),
             cmocka_unit_test(test_lookaheads),
             cmocka_unit_test(test_lalr1_consolidation),
     };
@@ -7,11 +7,13 @@
 void lexer_error_cb(void* ctx,
                     const char* input,
                     const TokenPosition* position,
+                    NeoastLines* lines,
                     const char* state_name);
 
 void parser_error_cb(void* ctx,
                      const char* const* token_names,
                      const TokenPosition* position,
+                     NeoastLines* lines,
                      uint32_t last_token,
                      uint32_t current_token,
                      const uint32_t expected_tokens[],
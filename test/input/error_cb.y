@@ -7,11 +7,13 @@
 void lexer_error_cb(void* ctx,
                     const char* input,
                     const TokenPosition* position,
+                    NeoastLines* lines,
                     const char* state_name);
 
 void parser_error_cb(void* ctx,
                      const char* const* token_names,
                      const TokenPosition* position,
+                     NeoastLines* lines,
                      uint32_t last_token,
                      uint32_t current_token,
                      const uint32_t expected_tokens[],
@@ -49,7 +51,8 @@ void parser_error_cb(void* ctx,
 
 %%
 
-out: expr           { $$ = $1; }
+// Valid inputs give the line their expression starts on
+out: expr           { TokenLocation location; $$ = yylocate($p1, &location) == 0 ? (int) location.line : -1; }
     ;
 
 expr: A_TOKEN       { $$ = $1; }
@@ -0,0 +1,44 @@
+%include {
+#include <stdlib.h>
+}
+
+// Keywords and parentheses are matched by the identifier and
+// operator rules and looked up after, '+' stays in the DFA
+%option prefix="keywords"
+%option annotate_line="FALSE"
+
+%union {
+    int number;
+}
+
+%token<number> NUMBER IDENT
+%token KW_ADD KW_MUL KW_NEG '(' ')'
+%type<number> expr program
+%start<number> program
+
+==
+"[ \t\r\n]+"                { }
+"add"                       { return KW_ADD; }
+"mul"                       { return KW_MUL; }
+"neg"                       { return KW_NEG; }
+"\+"                        { return KW_ADD; }
+"\("                        { return '('; }
+"\)"                        { return ')'; }
+"[A-Za-z_][A-Za-z_0-9]*"    { yyval->number = yylen; return IDENT; }
+"[0-9]+"                    { yyval->number = atoi(yytext); return NUMBER; }
+"[-*/()]"                   { return -1; }
+==
+
+%%
+program: expr                   { $$ = $1; }
+       ;
+
+// Identifiers are worth their length
+expr: NUMBER                    { $$ = $1; }
+    | IDENT                     { $$ = $1; }
+    | KW_ADD expr expr          { $$ = $2 + $3; }
+    | KW_MUL expr expr          { $$ = $2 * $3; }
+    | KW_NEG expr               { $$ = -$2; }
+    | '(' expr ')'              { $$ = $2; }
+    ;
+%%
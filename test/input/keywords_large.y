@@ -0,0 +1,135 @@
+%include {
+#include <stdlib.h>
+}
+
+// The C and C++ keywords, all matched by the identifier rule
+// and looked up after the DFA. Keywords are worth their
+// place in the list and identifiers are worth 1000.
+%option prefix="keywords_large"
+%option annotate_line="FALSE"
+
+%union {
+    int number;
+}
+
+%token<number> KEYWORD IDENT
+%type<number> items program
+%start<number> program
+
+==
+"[ \t\r\n]+"                { }
+"alignas"                   { yyval->number = 1; return KEYWORD; }
+"alignof"                   { yyval->number = 2; return KEYWORD; }
+"and"                       { yyval->number = 3; return KEYWORD; }
+"and_eq"                    { yyval->number = 4; return KEYWORD; }
+"asm"                       { yyval->number = 5; return KEYWORD; }
+"auto"                      { yyval->number = 6; return KEYWORD; }
+"bitand"                    { yyval->number = 7; return KEYWORD; }
+"bitor"                     { yyval->number = 8; return KEYWORD; }
+"bool"                      { yyval->number = 9; return KEYWORD; }
+"break"                     { yyval->number = 10; return KEYWORD; }
+"case"                      { yyval->number = 11; return KEYWORD; }
+"catch"                     { yyval->number = 12; return KEYWORD; }
+"char"                      { yyval->number = 13; return KEYWORD; }
+"char8_t"                   { yyval->number = 14; return KEYWORD; }
+"char16_t"                  { yyval->number = 15; return KEYWORD; }
+"char32_t"                  { yyval->number = 16; return KEYWORD; }
+"class"                     { yyval->number = 17; return KEYWORD; }
+"compl"                     { yyval->number = 18; return KEYWORD; }
+"concept"                   { yyval->number = 19; return KEYWORD; }
+"const"                     { yyval->number = 20; return KEYWORD; }
+"consteval"                 { yyval->number = 21; return KEYWORD; }
+"constexpr"                 { yyval->number = 22; return KEYWORD; }
+"constinit"                 { yyval->number = 23; return KEYWORD; }
+"const_cast"                { yyval->number = 24; return KEYWORD; }
+"continue"                  { yyval->number = 25; return KEYWORD; }
+"co_await"                  { yyval->number = 26; return KEYWORD; }
+"co_return"                 { yyval->number = 27; return KEYWORD; }
+"co_yield"                  { yyval->number = 28; return KEYWORD; }
+"decltype"                  { yyval->number = 29; return KEYWORD; }
+"default"                   { yyval->number = 30; return KEYWORD; }
+"delete"                    { yyval->number = 31; return KEYWORD; }
+"do"                        { yyval->number = 32; return KEYWORD; }
+"double"                    { yyval->number = 33; return KEYWORD; }
+"dynamic_cast"              { yyval->number = 34; return KEYWORD; }
+"else"                      { yyval->number = 35; return KEYWORD; }
+"enum"                      { yyval->number = 36; return KEYWORD; }
+"explicit"                  { yyval->number = 37; return KEYWORD; }
+"export"                    { yyval->number = 38; return KEYWORD; }
+"extern"                    { yyval->number = 39; return KEYWORD; }
+"false"                     { yyval->number = 40; return KEYWORD; }
+"float"                     { yyval->number = 41; return KEYWORD; }
+"for"                       { yyval->number = 42; return KEYWORD; }
+"friend"                    { yyval->number = 43; return KEYWORD; }
+"goto"                      { yyval->number = 44; return KEYWORD; }
+"if"                        { yyval->number = 45; return KEYWORD; }
+"inline"                    { yyval->number = 46; return KEYWORD; }
+"int"                       { yyval->number = 47; return KEYWORD; }
+"long"                      { yyval->number = 48; return KEYWORD; }
+"mutable"                   { yyval->number = 49; return KEYWORD; }
+"namespace"                 { yyval->number = 50; return KEYWORD; }
+"new"                       { yyval->number = 51; return KEYWORD; }
+"noexcept"                  { yyval->number = 52; return KEYWORD; }
+"not"                       { yyval->number = 53; return KEYWORD; }
+"not_eq"                    { yyval->number = 54; return KEYWORD; }
+"nullptr"                   { yyval->number = 55; return KEYWORD; }
+"operator"                  { yyval->number = 56; return KEYWORD; }
+"or"                        { yyval->number = 57; return KEYWORD; }
+"or_eq"                     { yyval->number = 58; return KEYWORD; }
+"private"                   { yyval->number = 59; return KEYWORD; }
+"protected"                 { yyval->number = 60; return KEYWORD; }
+"public"                    { yyval->number = 61; return KEYWORD; }
+"register"                  { yyval->number = 62; return KEYWORD; }
+"reinterpret_cast"          { yyval->number = 63; return KEYWORD; }
+"requires"                  { yyval->number = 64; return KEYWORD; }
+"return"                    { yyval->number = 65; return KEYWORD; }
+"short"                     { yyval->number = 66; return KEYWORD; }
+"signed"                    { yyval->number = 67; return KEYWORD; }
+"sizeof"                    { yyval->number = 68; return KEYWORD; }
+"static"                    { yyval->number = 69; return KEYWORD; }
+"static_assert"             { yyval->number = 70; return KEYWORD; }
+"static_cast"               { yyval->number = 71; return KEYWORD; }
+"struct"                    { yyval->number = 72; return KEYWORD; }
+"switch"                    { yyval->number = 73; return KEYWORD; }
+"template"                  { yyval->number = 74; return KEYWORD; }
+"this"                      { yyval->number = 75; return KEYWORD; }
+"thread_local"              { yyval->number = 76; return KEYWORD; }
+"throw"                     { yyval->number = 77; return KEYWORD; }
+"true"                      { yyval->number = 78; return KEYWORD; }
+"try"                       { yyval->number = 79; return KEYWORD; }
+"typedef"                   { yyval->number = 80; return KEYWORD; }
+"typeid"                    { yyval->number = 81; return KEYWORD; }
+"typename"                  { yyval->number = 82; return KEYWORD; }
+"union"                     { yyval->number = 83; return KEYWORD; }
+"unsigned"                  { yyval->number = 84; return KEYWORD; }
+"using"                     { yyval->number = 85; return KEYWORD; }
+"virtual"                   { yyval->number = 86; return KEYWORD; }
+"void"                      { yyval->number = 87; return KEYWORD; }
+"volatile"                  { yyval->number = 88; return KEYWORD; }
+"wchar_t"                   { yyval->number = 89; return KEYWORD; }
+"while"                     { yyval->number = 90; return KEYWORD; }
+"xor"                       { yyval->number = 91; return KEYWORD; }
+"xor_eq"                    { yyval->number = 92; return KEYWORD; }
+"_Alignas"                  { yyval->number = 93; return KEYWORD; }
+"_Alignof"                  { yyval->number = 94; return KEYWORD; }
+"_Atomic"                   { yyval->number = 95; return KEYWORD; }
+"_Bool"                     { yyval->number = 96; return KEYWORD; }
+"_Complex"                  { yyval->number = 97; return KEYWORD; }
+"_Generic"                  { yyval->number = 98; return KEYWORD; }
+"_Imaginary"                { yyval->number = 99; return KEYWORD; }
+"_Noreturn"                 { yyval->number = 100; return KEYWORD; }
+"_Static_assert"            { yyval->number = 101; return KEYWORD; }
+"_Thread_local"             { yyval->number = 102; return KEYWORD; }
+"restrict"                  { yyval->number = 103; return KEYWORD; }
+"[A-Za-z_][A-Za-z_0-9]*"    { yyval->number = 1000; return IDENT; }
+==
+
+%%
+program: items                  { $$ = $1; }
+       ;
+
+items: items KEYWORD            { $$ = $1 + $2; }
+     | items IDENT              { $$ = $1 + $2; }
+     |                          { $$ = 0; }
+     ;
+%%
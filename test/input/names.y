@@ -0,0 +1,52 @@
+%include {
+#include <stdlib.h>
+#include <string.h>
+}
+
+%top {
+// Names still allocated, lexed on the helper thread and freed on the parser's
+extern int names_n;
+
+static int name_take(char* name)
+{
+    int length = (int) strlen(name);
+    free(name);
+    __atomic_sub_fetch(&names_n, 1, __ATOMIC_RELAXED);
+    return length;
+}
+}
+
+// Every name owns a string, to check that the
+// pipeline drops the tokens it never parsed
+%option annotate_line="FALSE"
+%option prefix="names"
+%option pipeline="TRUE"
+
+%union {
+    int length;
+    char* name;
+}
+
+%token<name> NAME
+%token ','
+%type<length> names
+%start<length> names
+
+%destructor <name> { name_take($$); }
+
+==
+"[ \t\r\n]+"        { }
+"[A-Za-z_]+"        {
+                        yyval->name = strndup(yytext, yylen);
+                        __atomic_add_fetch(&names_n, 1, __ATOMIC_RELAXED);
+                        return NAME;
+                    }
+","                 { return ','; }
+==
+
+%%
+// Names are worth their length
+names: names NAME           { $$ = $1 + name_take($2); }
+     | NAME                 { $$ = name_take($1); }
+     ;
+%%
@@ -21,6 +21,8 @@
 #include <neoast.h>
 #include <lexer/input.h>
 #include <string.h>
+#include <stdlib.h>
+#include <pthread.h>
 
 #define CTEST(name) static void name(void** state)
 
@@ -32,15 +34,57 @@ void* FUNC(name, allocate_buffers)(); \
 void FUNC(name, free_buffers)(void* self); \
 void FUNC(name, free)(); \
 return_type FUNC(name, parse)(void* ctx, const void* buffers, const char* input); \
-return_type FUNC(name, parse_input)(void* ctx, const void* buffers, NeoastInput* input);
+return_type FUNC(name, parse_input)(void* ctx, const void* buffers, NeoastInput* input); \
+int FUNC(name, validate)(void* ctx, void* buffers, const char* input, uint32_t input_len, \
+                         TokenPosition* error_position);
 
 // Pretend headers
 DEFINE_HEADER(calc, double)
+DEFINE_HEADER(calc_direct, double)
+DEFINE_HEADER(calc_pipe, double)
+DEFINE_HEADER(calc_inc, double)
 DEFINE_HEADER(calc_ascii, double)
+DEFINE_HEADER(calc_compressed, double)
+DEFINE_HEADER(calc_untracked, double)
+DEFINE_HEADER(calc_lexer_table, double)
 DEFINE_HEADER(required_use, void*)
 DEFINE_HEADER(error, int)
+DEFINE_HEADER(keywords, int)
+DEFINE_HEADER(keywords_large, int)
+DEFINE_HEADER(keywords_large_unfolded, int)
+DEFINE_HEADER(names, int)
 
 void required_use_stmt_free(void* self);
+int names_n = 0;
+
+void* calc_session_new();
+void calc_session_free(void* self);
+void calc_session_reset(void* self, const char* input, uint32_t input_len);
+double calc_session_parse(void* ctx, void* self);
+int calc_session_parse_budget(void* ctx, void* self, uint32_t max_steps, double* result);
+
+double calc_pipe_parse_len(void* ctx, void* buffers, const char* input, uint32_t input_len);
+double calc_pipe_parse_pipelined(void* ctx, void* buffers, const char* input, uint32_t input_len);
+int names_parse_pipelined(void* ctx, void* buffers, const char* input, uint32_t input_len);
+void* names_session_new();
+void names_session_free(void* self);
+void names_session_reset(void* self, const char* input, uint32_t input_len);
+int names_session_parse(void* ctx, void* self);
+int names_session_validate(void* ctx, void* self, TokenPosition* error_position);
+int names_session_parse_budget(void* ctx, void* self, uint32_t max_steps, int* result);
+double calc_inc_parse_len(void* ctx, void* buffers, const char* input, uint32_t input_len);
+void* calc_inc_incremental_new();
+void calc_inc_incremental_free(void* self);
+void calc_inc_incremental_edit(void* self, uint32_t offset, uint32_t old_len, uint32_t new_len);
+double calc_inc_incremental_parse(void* ctx, void* self, const char* input, uint32_t input_len);
+uint32_t calc_inc_incremental_lexed(void* self);
+uint32_t calc_parse_batch(void* const ctxs[], const char* const inputs[], const uint32_t input_lens[],
+                          uint32_t n, double results[], uint32_t thread_n);
+
+void* calc_push_new();
+void calc_push_free(void* self);
+push_status_t calc_push_bytes(void* ctx, void* self, const char* input, uint32_t input_len,
+                              int is_final, double* result);
 
 CTEST(test_empty)
 {
@@ -65,6 +109,24 @@ CTEST(test_parser)
     calc_free();
 }
 
+CTEST(test_parser_direct)
+{
+    assert_int_equal(calc_direct_init(), 0);
+    void* buffers = calc_direct_allocate_buffers();
+
+    assert_double_equal(calc_direct_parse(NULL, buffers, "   "), 0, 0);
+    assert_double_equal(calc_direct_parse(NULL, buffers, "3 + 5 + (4 * 2 + (5 / 2))"),
+                        3 + 5 + (4 * 2 + (5.0 / 2)), 0.001);
+    assert_double_equal(calc_direct_parse(NULL, buffers, "(10 - 4) / 3 * 2"), 4, 0.001);
+
+    // Errors in the middle and at the end of the input
+    assert_double_equal(calc_direct_parse(NULL, buffers, "3 + + 5"), 0, 0);
+    assert_double_equal(calc_direct_parse(NULL, buffers, "(3 + 5"), 0, 0);
+
+    calc_direct_free_buffers(buffers);
+    calc_direct_free();
+}
+
 CTEST(test_empty_ascii)
 {
     assert_int_equal(calc_ascii_init(), 0);
@@ -100,6 +162,69 @@ CTEST(test_parser_ascii_order_of_ops)
     calc_ascii_free();
 }
 
+CTEST(test_parser_compressed)
+{
+    assert_int_equal(calc_compressed_init(), 0);
+    void* buffers = calc_compressed_allocate_buffers();
+
+    assert_double_equal(calc_compressed_parse(NULL, buffers, "   "), 0, 0);
+    assert_double_equal(calc_compressed_parse(NULL, buffers, "3 + 5 + (4 * 2 + (5 / 2))"),
+                        3 + 5 + (4 * 2 + (5.0 / 2)), 0.001);
+    assert_double_equal(calc_compressed_parse(NULL, buffers, "(10 - 4) / 3 * 2"), 4, 0.001);
+
+    // Rows that share the default entry still reject the token
+    assert_double_equal(calc_compressed_parse(NULL, buffers, "3 + + 5"), 0, 0);
+    assert_double_equal(calc_compressed_parse(NULL, buffers, "(3 + 5"), 0, 0);
+
+    calc_compressed_free_buffers(buffers);
+    calc_compressed_free();
+}
+
+CTEST(test_parser_untracked)
+{
+    assert_int_equal(calc_untracked_init(), 0);
+    void* buffers = calc_untracked_allocate_buffers();
+
+    // Values don't carry a position
+    const ParserBuffers* b = buffers;
+    assert_int_equal(b->union_s, b->val_s);
+    assert_int_equal(b->val_s, sizeof(double));
+
+    // Syntax errors are still reported, just without a position
+    assert_double_equal(calc_untracked_parse(NULL, buffers, "3 + + 5"), 0, 0);
+
+    TokenPosition position = {1, 1};
+    assert_int_equal(calc_untracked_validate(NULL, buffers, "3 + + 5", 7, &position), -1);
+    assert_int_equal(position.offset, 0);
+    assert_int_equal(position.len, 0);
+
+    assert_double_equal(calc_untracked_parse(NULL, buffers, "3 * (2 + 1)"), 9, 0.001);
+    calc_untracked_free_buffers(buffers);
+    calc_untracked_free();
+}
+
+CTEST(test_parser_lexer_table)
+{
+    assert_int_equal(calc_lexer_table_init(), 0);
+    void* buffers = calc_lexer_table_allocate_buffers();
+
+    assert_double_equal(calc_lexer_table_parse(NULL, buffers, "   "), 0, 0);
+    assert_double_equal(calc_lexer_table_parse(NULL, buffers, "3 + 5 + (4 * 2 + (5 / 2))"),
+                        3 + 5 + (4 * 2 + (5.0 / 2)), 0.001);
+    assert_double_equal(calc_lexer_table_parse(NULL, buffers, "3 + + 5"), 0, 0);
+
+    // Input read from a file as it is scanned
+    char* input = "12 + 345 * (6789 - 1)";
+    FILE* mock_file = fmemopen(input, strlen(input), "r");
+    NeoastInput* mock_input = input_new_from_file(mock_file);
+    assert_double_equal(calc_lexer_table_parse_input(NULL, buffers, mock_input), (12 + 345) * (6789 - 1), 0.001);
+    input_free(mock_input);
+    fclose(mock_file);
+
+    calc_lexer_table_free_buffers(buffers);
+    calc_lexer_table_free();
+}
+
 CTEST(test_parser_input)
 {
     assert_int_equal(calc_ascii_init(), 0);
@@ -116,6 +241,348 @@ CTEST(test_parser_input)
     input_free(mock_input);
     fclose(mock_file);
 }
+
+CTEST(test_session)
+{
+    const char* inputs[] = {
+            "3 + 5 + (4 * 2 + (5 / 2))",
+            "",
+            "3 + + 5",
+            "(10 - 4) / 3",
+    };
+
+    double expected[] = {3 + 5 + (4 * 2 + (5.0 / 2)), 0, 0, 2};
+
+    void* session = calc_session_new();
+
+    // Reuse the session after every kind of parse, including errors
+    for (int repeat = 0; repeat < 2; repeat++)
+    {
+        for (uint32_t i = 0; i < sizeof(inputs) / sizeof(inputs[0]); i++)
+        {
+            calc_session_reset(session, inputs[i], strlen(inputs[i]));
+            assert_double_equal(calc_session_parse(NULL, session), expected[i], 0.001);
+        }
+    }
+
+    calc_session_free(session);
+}
+
+CTEST(test_session_budget)
+{
+    const char* input = "3 + 5 + (4 * 2 + (5 / 2))";
+    void* session = calc_session_new();
+
+    // Every budget gives the same result as a whole parse
+    for (uint32_t budget = 1; budget < 8; budget++)
+    {
+        calc_session_reset(session, input, strlen(input));
+
+        double result = 0;
+        int ret;
+        while ((ret = calc_session_parse_budget(NULL, session, budget, &result)) == NEOAST_PARSE_SUSPENDED);
+
+        assert_int_equal(ret, 0);
+        assert_double_equal(result, 3 + 5 + (4 * 2 + (5.0 / 2)), 0.001);
+    }
+
+    // Errors are reported by the slice that runs into them
+    calc_session_reset(session, "3 + + 5", 7);
+    int ret;
+    while ((ret = calc_session_parse_budget(NULL, session, 1, NULL)) == NEOAST_PARSE_SUSPENDED);
+    assert_int_equal(ret, -1);
+
+    // Resetting drops a suspended parse
+    calc_session_reset(session, input, strlen(input));
+    assert_int_equal(calc_session_parse_budget(NULL, session, 2, NULL), NEOAST_PARSE_SUSPENDED);
+    calc_session_reset(session, "(10 - 4) / 3", 12);
+    assert_double_equal(calc_session_parse(NULL, session), 2, 0.001);
+
+    calc_session_free(session);
+}
+
+CTEST(test_session_budget_dropped)
+{
+    const char* input = "abc de fghi jk";
+    void* session = names_session_new();
+
+    // A whole parse drops a suspended one and starts over
+    names_session_reset(session, input, strlen(input));
+    assert_int_equal(names_session_parse_budget(NULL, session, 2, NULL), NEOAST_PARSE_SUSPENDED);
+    assert_int_equal(names_session_parse(NULL, session), 11);
+    assert_int_equal(names_n, 0);
+
+    // Values of the finished parse are not dropped again
+    names_session_reset(session, input, strlen(input));
+    assert_int_equal(names_n, 0);
+
+    assert_int_equal(names_session_parse_budget(NULL, session, 3, NULL), NEOAST_PARSE_SUSPENDED);
+    assert_int_equal(names_session_validate(NULL, session, NULL), 0);
+    assert_int_equal(names_n, 0);
+
+    names_session_reset(session, input, strlen(input));
+    assert_int_equal(names_session_parse_budget(NULL, session, 3, NULL), NEOAST_PARSE_SUSPENDED);
+    names_session_free(session);
+    assert_int_equal(names_n, 0);
+}
+
+CTEST(test_push_parser)
+{
+    assert_int_equal(calc_init(), 0);
+
+    const char* input = "3 + 5 + (4 * 2 + (5 / 2))";
+    uint32_t input_len = strlen(input);
+
+    // Every chunk size splits tokens at different places
+    for (uint32_t chunk = 1; chunk <= input_len; chunk++)
+    {
+        void* push = calc_push_new();
+        double result = 0;
+
+        uint32_t offset = 0;
+        for (; offset + chunk < input_len; offset += chunk)
+        {
+            assert_int_equal(calc_push_bytes(NULL, push, input + offset, chunk, 0, &result),
+                             NEOAST_PUSH_NEED_MORE);
+        }
+
+        assert_int_equal(calc_push_bytes(NULL, push, input + offset, input_len - offset, 0, &result),
+                         NEOAST_PUSH_NEED_MORE);
+        assert_int_equal(calc_push_bytes(NULL, push, NULL, 0, 1, &result), NEOAST_PUSH_ACCEPT);
+        assert_double_equal(result, 3 + 5 + (4 * 2 + (5.0 / 2)), 0.001);
+        calc_push_free(push);
+    }
+
+    void* push = calc_push_new();
+    assert_int_equal(calc_push_bytes(NULL, push, "3 + ", 4, 0, NULL), NEOAST_PUSH_NEED_MORE);
+    assert_int_equal(calc_push_bytes(NULL, push, "+ 5", 3, 1, NULL), NEOAST_PUSH_ERROR);
+    calc_push_free(push);
+
+    calc_free();
+}
+
+CTEST(test_pipeline)
+{
+    assert_int_equal(calc_pipe_init(), 0);
+    void* buffers = calc_pipe_allocate_buffers();
+
+    // Many more tokens than fit in the ring between the threads
+    const uint32_t term_n = 50000;
+    char* input = malloc(term_n * 12 + 8);
+    uint32_t input_len = 0;
+    double expected = 0;
+    for (uint32_t i = 0; i < term_n; i++)
+    {
+        input_len += sprintf(input + input_len, "(%d * 2) + ", i % 100);
+        expected += (i % 100) * 2;
+    }
+    input_len += sprintf(input + input_len, "1");
+    expected += 1;
+
+    assert_double_equal(calc_pipe_parse_len(NULL, buffers, input, input_len), expected, 0.001);
+    assert_double_equal(calc_pipe_parse_pipelined(NULL, buffers, input, input_len), expected, 0.001);
+
+    // Syntax error well before the lexer is done
+    memcpy(input + 10, "+ +", 3);
+    assert_double_equal(calc_pipe_parse_pipelined(NULL, buffers, input, input_len), 0, 0);
+
+    free(input);
+    calc_pipe_free_buffers(buffers);
+    calc_pipe_free();
+}
+
+CTEST(test_pipeline_destructor)
+{
+    assert_int_equal(names_init(), 0);
+    void* buffers = names_allocate_buffers();
+
+    // Every name owns a string until it is reduced or dropped
+    const uint32_t name_n = 5000;
+    char* input = malloc(name_n * 4 + 1);
+    uint32_t input_len = 0;
+    for (uint32_t i = 0; i < name_n; i++)
+    {
+        input_len += sprintf(input + input_len, "abc ");
+    }
+
+    assert_int_equal(names_parse_pipelined(NULL, buffers, input, input_len), name_n * 3);
+    assert_int_equal(names_n, 0);
+
+    // The parser stops on errors at every point of a batch
+    // while the lexer is still filling the ring
+    for (uint32_t error_at = 0; error_at < 100; error_at++)
+    {
+        input[error_at * 4 + 3] = ',';
+        assert_int_equal(names_parse_pipelined(NULL, buffers, input, input_len), 0);
+        assert_int_equal(names_n, 0);
+        input[error_at * 4 + 3] = ' ';
+    }
+
+    free(input);
+    names_free_buffers(buffers);
+    names_free();
+}
+
+CTEST(test_batch)
+{
+    enum {BATCH_N = 1000};
+    static char inputs[BATCH_N][64];
+    const char* input_ptrs[BATCH_N];
+    double results[BATCH_N];
+
+    uint32_t expected_failures = 0;
+    for (uint32_t i = 0; i < BATCH_N; i++)
+    {
+        // Sprinkle in some invalid inputs
+        if (i % 97 == 5)
+        {
+            snprintf(inputs[i], sizeof(inputs[i]), "%d + + 1", i);
+            expected_failures++;
+        }
+        else
+        {
+            snprintf(inputs[i], sizeof(inputs[i]), "%d + (4 * 2)", i);
+        }
+
+        input_ptrs[i] = inputs[i];
+    }
+
+    for (uint32_t thread_n = 1; thread_n <= 8; thread_n *= 2)
+    {
+        memset(results, 0, sizeof(results));
+        assert_int_equal(calc_parse_batch(NULL, input_ptrs, NULL, BATCH_N, results, thread_n),
+                         expected_failures);
+
+        // Results come back in input order
+        for (uint32_t i = 0; i < BATCH_N; i++)
+        {
+            assert_double_equal(results[i], i % 97 == 5 ? 0 : i + 8, 0.001);
+        }
+    }
+
+    assert_int_equal(calc_parse_batch(NULL, input_ptrs, NULL, 0, results, 0), 0);
+}
+
+static uint32_t text_edit(char* text, uint32_t len, void* incremental,
+                          uint32_t offset, uint32_t old_len, const char* replacement)
+{
+    uint32_t new_len = strlen(replacement);
+    memmove(text + offset + new_len, text + offset + old_len, len - offset - old_len + 1);
+    memcpy(text + offset, replacement, new_len);
+    calc_inc_incremental_edit(incremental, offset, old_len, new_len);
+    return len - old_len + new_len;
+}
+
+CTEST(test_incremental)
+{
+    calc_inc_init();
+    void* buffers = calc_inc_allocate_buffers();
+    void* incremental = calc_inc_incremental_new();
+
+    char* text = malloc(16 * 1024);
+    uint32_t len = 0;
+    for (uint32_t i = 0; i < 1000; i++)
+    {
+        len += sprintf(text + len, "(%d * 2) + ", i % 10);
+    }
+    len += sprintf(text + len, "1");
+
+    assert_double_equal(calc_inc_incremental_parse(NULL, incremental, text, len),
+                        calc_inc_parse_len(NULL, buffers, text, len), 0.001);
+    assert_int_equal(calc_inc_incremental_lexed(incremental), 6002);
+
+    // Nothing was edited, only the end of the input is lexed
+    assert_double_equal(calc_inc_incremental_parse(NULL, incremental, text, len), 9001, 0.001);
+    assert_int_equal(calc_inc_incremental_lexed(incremental), 1);
+
+    // Change a number in the middle and at both ends, only
+    // the tokens around each edit are lexed again
+    len = text_edit(text, len, incremental, 5001, 1, "7");
+    assert_double_equal(calc_inc_incremental_parse(NULL, incremental, text, len),
+                        calc_inc_parse_len(NULL, buffers, text, len), 0.001);
+    assert_in_range(calc_inc_incremental_lexed(incremental), 1, 8);
+    len = text_edit(text, len, incremental, 1, 1, "12");
+    assert_double_equal(calc_inc_incremental_parse(NULL, incremental, text, len),
+                        calc_inc_parse_len(NULL, buffers, text, len), 0.001);
+    assert_in_range(calc_inc_incremental_lexed(incremental), 1, 8);
+    len = text_edit(text, len, incremental, len - 1, 1, "100");
+    assert_double_equal(calc_inc_incremental_parse(NULL, incremental, text, len),
+                        calc_inc_parse_len(NULL, buffers, text, len), 0.001);
+    assert_in_range(calc_inc_incremental_lexed(incremental), 1, 8);
+
+    // Whitespace and new terms
+    len = text_edit(text, len, incremental, 300, 0, "   ");
+    len = text_edit(text, len, incremental, strchr(text + 2000, '(') - text, 0, "(5 - 3) + ");
+    assert_double_equal(calc_inc_incremental_parse(NULL, incremental, text, len),
+                        calc_inc_parse_len(NULL, buffers, text, len), 0.001);
+
+    // Edits are kept through a syntax error
+    double expected = calc_inc_parse_len(NULL, buffers, text, len);
+    uint32_t error_at = strchr(text + 4000, '(') - text;
+    len = text_edit(text, len, incremental, error_at, 0, "+ ");
+    assert_double_equal(calc_inc_incremental_parse(NULL, incremental, text, len), 0, 0);
+    len = text_edit(text, len, incremental, error_at, 2, "");
+    assert_double_equal(calc_inc_incremental_parse(NULL, incremental, text, len), expected, 0.001);
+
+    free(text);
+    calc_inc_incremental_free(incremental);
+    calc_inc_free_buffers(buffers);
+    calc_inc_free();
+}
+
+#define THREAD_N 4
+#define THREAD_ITERATIONS 20000
+
+typedef struct
+{
+    uint32_t iterations;
+    uint32_t failures;
+} ThreadJob;
+
+static void* parse_thread(void* job_)
+{
+    ThreadJob* job = job_;
+
+    // Each thread owns its buffers, the parser itself is shared
+    calc_init();
+    void* buffers = calc_allocate_buffers();
+    for (uint32_t i = 0; i < job->iterations; i++)
+    {
+        char input[64];
+        snprintf(input, sizeof(input), "%d + (4 * 2 + (%d / 2)) - %d", i, i, i % 7);
+        double result = calc_parse(NULL, buffers, input);
+        if (result != i + (4 * 2 + (i / 2.0)) - (i % 7))
+        {
+            job->failures++;
+        }
+    }
+
+    calc_free_buffers(buffers);
+    calc_free();
+    return NULL;
+}
+
+CTEST(test_threads)
+{
+    ThreadJob jobs[THREAD_N];
+    pthread_t threads[THREAD_N];
+
+    // Scaling is measured by parser_bench, this only checks
+    // that threads sharing the parser get the right results
+    for (uint32_t i = 0; i < THREAD_N; i++)
+    {
+        jobs[i].iterations = THREAD_ITERATIONS;
+        jobs[i].failures = 0;
+        assert_int_equal(pthread_create(&threads[i], NULL, parse_thread, &jobs[i]), 0);
+    }
+
+    for (uint32_t i = 0; i < THREAD_N; i++)
+    {
+        assert_int_equal(pthread_join(threads[i], NULL), 0);
+        assert_int_equal(jobs[i].failures, 0);
+    }
+}
+
 CTEST(test_destructor)
 {
     assert_int_equal(required_use_init(), 0);
@@ -144,13 +611,19 @@ static volatile int parser_error_called = 0;
 void lexer_error_cb(void* ctx,
                     const char* input,
                     const TokenPosition* position,
+                    NeoastLines* lines,
                     const char* lexer_state)
 {
     (void) lexer_error_cb;
     (void) ctx;
     (void) input;
-    assert_int_equal(position->line, 2);
-    assert_int_equal(position->col, 4);
+
+    // Positions are located in the text being parsed
+    TokenLocation location;
+    assert_int_equal(position->offset, 5);
+    assert_int_equal(neoast_lines_locate(lines, position->offset, &location), 0);
+    assert_int_equal(location.line, 2);
+    assert_int_equal(location.col, 4);
     assert_string_equal(lexer_state, "LEX_STATE_DEFAULT");
     lexer_error_called = 1;
 }
@@ -158,20 +631,23 @@ void lexer_error_cb(void* ctx,
 void parser_error_cb(void* ctx,
                      const char* const* token_names,
                      const TokenPosition* position,
+                     NeoastLines* lines,
                      uint32_t last_token,
                      uint32_t current_token,
                      const uint32_t expected_tokens[],
                      uint32_t expected_tokens_n)
 {
     (void) ctx;
-
     assert_non_null(token_names);
     assert_non_null(position);
     assert_non_null(expected_tokens);
 
-    assert_int_equal(position->line, 1);
-    assert_int_equal(position->col, 13);
+    TokenLocation location;
+    assert_int_equal(position->offset, 13);
     assert_int_equal(position->len, 2);
+    assert_int_equal(neoast_lines_locate(lines, position->offset, &location), 0);
+    assert_int_equal(location.line, 1);
+    assert_int_equal(location.col, 13);
 
     assert_int_equal(last_token, 1);
     assert_int_equal(current_token, 1);
@@ -214,16 +690,106 @@ CTEST(test_error_yy)
     error_free_buffers(buffers);
 }
 
+CTEST(test_error_locate)
+{
+    // Actions locate $p in the text being parsed
+    assert_int_equal(error_init(), 0);
+    void* buffers = error_allocate_buffers();
+    assert_int_equal(error_parse(NULL, buffers, "7 * 3"), 1);
+    assert_int_equal(error_parse(NULL, buffers, "\n\n  7 *\n 3"), 3);
+    error_free();
+    error_free_buffers(buffers);
+}
+
+CTEST(test_keywords)
+{
+    assert_int_equal(keywords_init(), 0);
+    void* buffers = keywords_allocate_buffers();
+
+    // Identifiers are worth their length, keywords are not identifiers
+    assert_int_equal(keywords_parse(NULL, buffers, "add mul 2 3 neg (addx)"), 2);
+    assert_int_equal(keywords_parse(NULL, buffers, "+ ad mulmul"), 8);
+    assert_int_equal(keywords_parse(NULL, buffers, "neg + neg 1 add_"), -3);
+    assert_int_equal(keywords_parse(NULL, buffers, "mul (negate) 2"), 12);
+
+    keywords_free_buffers(buffers);
+    keywords_free();
+}
+
+CTEST(test_keywords_large)
+{
+    assert_int_equal(keywords_large_init(), 0);
+    void* buffers = keywords_large_allocate_buffers();
+
+    // Keywords are worth their place in the list, identifiers 1000
+    assert_int_equal(keywords_large_parse(NULL, buffers, "alignas restrict _Thread_local"), 1 + 103 + 102);
+    assert_int_equal(keywords_large_parse(NULL, buffers, "and and_eq xor xor_eq"), 3 + 4 + 91 + 92);
+    assert_int_equal(keywords_large_parse(NULL, buffers, "static_assert _Static_assert"), 70 + 101);
+    assert_int_equal(keywords_large_parse(NULL, buffers, "if do int"), 45 + 32 + 47);
+    assert_int_equal(keywords_large_parse(NULL, buffers, "char8_t char16_t char32"), 14 + 15 + 1000);
+    assert_int_equal(keywords_large_parse(NULL, buffers, "whilex whil While"), 3000);
+
+    keywords_large_free_buffers(buffers);
+    keywords_large_free();
+}
+
+CTEST(test_keywords_unfolded)
+{
+    assert_int_equal(keywords_large_init(), 0);
+    assert_int_equal(keywords_large_unfolded_init(), 0);
+    void* buffers = keywords_large_allocate_buffers();
+    void* unfolded_buffers = keywords_large_unfolded_allocate_buffers();
+
+    // Literals looked up after the DFA lex the same as literals in the DFA
+    const char* inputs[] = {
+            "alignas restrict _Thread_local",
+            "and and_eq xor xor_eq an xo",
+            "static_assert _Static_assert static_cast static",
+            "if do int in d i",
+            "char8_t char16_t char32 char",
+            "whilex whil While while_ _while",
+            "co_await co_return co_yield co_",
+    };
+
+    for (uint32_t i = 0; i < sizeof(inputs) / sizeof(inputs[0]); i++)
+    {
+        assert_int_equal(keywords_large_parse(NULL, buffers, inputs[i]),
+                         keywords_large_unfolded_parse(NULL, unfolded_buffers, inputs[i]));
+    }
+
+    keywords_large_unfolded_free_buffers(unfolded_buffers);
+    keywords_large_free_buffers(buffers);
+    keywords_large_unfolded_free();
+    keywords_large_free();
+}
+
 const static struct CMUnitTest left_scan_tests[] = {
         cmocka_unit_test(test_empty),
         cmocka_unit_test(test_parser),
+        cmocka_unit_test(test_parser_direct),
         cmocka_unit_test(test_empty_ascii),
         cmocka_unit_test(test_parser_ascii),
+        cmocka_unit_test(test_parser_compressed),
+        cmocka_unit_test(test_parser_untracked),
+        cmocka_unit_test(test_parser_lexer_table),
         cmocka_unit_test(test_parser_input),
+        cmocka_unit_test(test_session),
+        cmocka_unit_test(test_session_budget),
+        cmocka_unit_test(test_session_budget_dropped),
+        cmocka_unit_test(test_push_parser),
+        cmocka_unit_test(test_pipeline),
+        cmocka_unit_test(test_pipeline_destructor),
+        cmocka_unit_test(test_batch),
+        cmocka_unit_test(test_incremental),
+        cmocka_unit_test(test_threads),
         cmocka_unit_test(test_destructor),
         cmocka_unit_test(test_destructor_lex),
         cmocka_unit_test(test_error_ll),
         cmocka_unit_test(test_error_yy),
+        cmocka_unit_test(test_error_locate),
+        cmocka_unit_test(test_keywords),
+        cmocka_unit_test(test_keywords_large),
+        cmocka_unit_test(test_keywords_unfolded),
 };
 
 int main()
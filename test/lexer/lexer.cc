@@ -162,9 +162,8 @@ private:
             {
                 // Invalid token
                 TokenPosition p{
-                        .line = static_cast<uint32_t>(lineno()),
-                        .col=static_cast<uint16_t>(columno()),
-                        .len=static_cast<uint16_t>(size())
+                        .offset = static_cast<uint64_t>(matcher().first()),
+                        .len = static_cast<uint64_t>(size())
                 };
 
                 if (parent->error_cb)
@@ -174,7 +173,7 @@ private:
                 else
                 {
                     std::cerr << "Failed to match token near on line:col "
-                              << p.line << ":" << p.col << " (state " << current_state << ")\n";
+                              << lineno() << ":" << columno() << " (state " << current_state << ")\n";
                 }
 
                 return -1;
@@ -184,8 +183,7 @@ private:
                 // Note where this token was found
                 auto* position = reinterpret_cast<TokenPosition*>(
                         static_cast<char*>(ll_val) + parent->position_offset);
-                position->line = static_cast<uint32_t>(lineno());
-                position->col = static_cast<uint32_t>(columno());
+                position->offset = static_cast<uint64_t>(matcher().first());
                 position->len = static_cast<uint32_t>(size());
 
                 // Run token action
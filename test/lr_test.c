@@ -91,6 +91,48 @@ uint32_t lalr_table[] = {
         LR_R(2), LR_R(2), LR_R(2), LR_E( ), LR_E( ), /* 6 */
 };
 
+static const
+uint32_t lalr_default_reductions[] = {
+        LR_E( ), LR_E( ), LR_E( ), LR_E( ), LR_R(3), LR_R(1), LR_R(2)
+};
+
+// Terminals with an action in each row of lalr_table
+static const
+uint32_t lalr_expected_tokens[] = {
+        0x6, 0x7, 0x6, 0x6, 0x7, 0x1, 0x7
+};
+
+// lalr_table split into uint8_t actions/gotos
+// shift: state, accept: 7, reduce: 7 + rule
+static const
+uint8_t lalr_split_actions[] = {
+        0, 3, 4,    /* 0 */
+        7, 7, 7,    /* 1 */
+        0, 3, 4,    /* 2 */
+        0, 3, 4,    /* 3 */
+        10, 10, 10, /* 4 */
+        8, 0, 0,    /* 5 */
+        9, 9, 9,    /* 6 */
+};
+
+static const
+uint8_t lalr_split_gotos[] = {
+        1, 2, /* 0 */
+        0, 0, /* 1 */
+        0, 5, /* 2 */
+        0, 6, /* 3 */
+        0, 0, /* 4 */
+        0, 0, /* 5 */
+        0, 0, /* 6 */
+};
+
+static const
+SplitTable lalr_split_table = {
+        .actions = lalr_split_actions,
+        .gotos = lalr_split_gotos,
+        .state_n = 7,
+};
+
 static void reduce_generic(uint32_t id, CodegenStruct* dest, CodegenStruct* args)
 {
     (void) id;
@@ -151,8 +193,376 @@ CTEST(test_parser)
     assert_int_not_equal(res_idx, -1);
 }
 
+CTEST(test_parser_default_reductions)
+{
+    const char* lexer_input = "10 ; 20 30 ;";
+
+    ParserBuffers* buf = parser_allocate_buffers(256, 256, sizeof(CodegenStruct), sizeof(CodegenUnion));
+
+    GrammarParser p_defaults = p;
+    p_defaults.default_reductions = lalr_default_reductions;
+
+    void* lexer_inst = bootstrap_lexer_instance_new(lexer_parent, lexer_input, strlen(lexer_input));
+    int32_t res_idx = parser_parse_lr(&p_defaults, NULL, lalr_table, buf, lexer_inst, bootstrap_lexer_next);
+    bootstrap_lexer_instance_free(lexer_inst);
+
+    parser_free_buffers(buf);
+    assert_int_not_equal(res_idx, -1);
+}
+
+CTEST(test_parser_split)
+{
+    const char* lexer_input = "10 ; 20 30 ;";
+
+    ParserBuffers* buf = parser_allocate_buffers(256, 256, sizeof(CodegenStruct), sizeof(CodegenUnion));
+
+    GrammarParser p_split = p;
+    p_split.table_format = TABLE_FORMAT_SPLIT_8;
+
+    void* lexer_inst = bootstrap_lexer_instance_new(lexer_parent, lexer_input, strlen(lexer_input));
+    int32_t res_idx = parser_parse_lr(&p_split, NULL, &lalr_split_table, buf, lexer_inst, bootstrap_lexer_next);
+    bootstrap_lexer_instance_free(lexer_inst);
+    assert_int_equal(res_idx, 0);
+
+    // Syntax errors are still caught
+    lexer_inst = bootstrap_lexer_instance_new(lexer_parent, "10 ;", 4);
+    res_idx = parser_parse_lr(&p_split, NULL, &lalr_split_table, buf, lexer_inst, bootstrap_lexer_next);
+    bootstrap_lexer_instance_free(lexer_inst);
+    assert_int_equal(res_idx, -1);
+
+    parser_free_buffers(buf);
+}
+
+static uint32_t expected_tokens_n;
+static uint32_t expected_tokens[3];
+
+static void expected_tokens_cb(void* ctx,
+                               const char* const* token_names,
+                               const TokenPosition* position,
+                               NeoastLines* lines,
+                               uint32_t last_token,
+                               uint32_t current_token,
+                               const uint32_t expected[],
+                               uint32_t expected_n)
+{
+    (void) ctx;
+    (void) token_names;
+    (void) position;
+    (void) lines;
+    (void) last_token;
+    (void) current_token;
+
+    assert_true(expected_n <= 3);
+    memcpy(expected_tokens, expected, sizeof(uint32_t) * expected_n);
+    expected_tokens_n = expected_n;
+}
+
+CTEST(test_parser_expected)
+{
+    GrammarParser p_expected = p;
+    p_expected.parser_error = expected_tokens_cb;
+
+    for (int i = 0; i < 2; i++)
+    {
+        // Scanning the table and the precomputed rows agree
+        p_expected.expected_tokens = i ? lalr_expected_tokens : NULL;
+
+        // State 4 reduces A -> b on every terminal but only
+        // EOF can follow once the reductions reach state 5
+        const uint32_t states[] = {0, 2, 4};
+        parser_syntax_error(&p_expected, NULL, lalr_table, NULL, NULL, states, 3, 1,
+                            TOK_a - NEOAST_ASCII_MAX, TOK_b - NEOAST_ASCII_MAX);
+        assert_int_equal(expected_tokens_n, 1);
+        assert_int_equal(expected_tokens[0], 0);
+
+        // Parsing stack layout of the table driver
+        const uint32_t stack[] = {0, 0, 3};
+        parser_syntax_error(&p_expected, NULL, lalr_table, NULL, NULL, stack, 2, 2,
+                            0, TOK_a - NEOAST_ASCII_MAX);
+        assert_int_equal(expected_tokens_n, 2);
+        assert_int_equal(expected_tokens[0], TOK_a - NEOAST_ASCII_MAX);
+        assert_int_equal(expected_tokens[1], TOK_b - NEOAST_ASCII_MAX);
+    }
+}
+
+CTEST(test_parser_push)
+{
+    const char* lexer_input = "10 ; 20 30 ;";
+
+    ParserBuffers* buf = parser_allocate_buffers(256, 256, sizeof(CodegenStruct), sizeof(CodegenUnion));
+
+    GrammarParser p_defaults = p;
+    p_defaults.default_reductions = lalr_default_reductions;
+
+    // Run the same input with and without default reductions
+    const GrammarParser* parsers[] = {&p, &p_defaults};
+    for (uint32_t i = 0; i < NEOAST_ARR_LEN(parsers); i++)
+    {
+        void* lexer_inst = bootstrap_lexer_instance_new(lexer_parent, lexer_input, strlen(lexer_input));
+
+        int tokens_n = 0;
+        push_status_t status;
+        do
+        {
+            int tok = bootstrap_lexer_next(lexer_inst, parser_push_value(buf), NULL);
+            status = parser_push_token(parsers[i], NULL, lalr_table, buf, tok);
+            tokens_n++;
+        } while (status == NEOAST_PUSH_NEED_MORE);
+
+        bootstrap_lexer_instance_free(lexer_inst);
+
+        // a b a a b + EOF
+        assert_int_equal(status, NEOAST_PUSH_ACCEPT);
+        assert_int_equal(tokens_n, 6);
+        assert_int_equal(buf->parsing_stack->pos, 0);
+    }
+
+    // Errors reset the parse as well
+    void* lexer_inst = bootstrap_lexer_instance_new(lexer_parent, ";", 1);
+    assert_int_equal(parser_push_token(&p, NULL, lalr_table, buf,
+                                       bootstrap_lexer_next(lexer_inst, parser_push_value(buf), NULL)),
+                     NEOAST_PUSH_NEED_MORE);
+    assert_int_equal(parser_push_token(&p, NULL, lalr_table, buf,
+                                       bootstrap_lexer_next(lexer_inst, parser_push_value(buf), NULL)),
+                     NEOAST_PUSH_ERROR);
+    assert_int_equal(buf->parsing_stack->pos, 0);
+    bootstrap_lexer_instance_free(lexer_inst);
+
+    parser_free_buffers(buf);
+}
+
+CTEST(test_parser_budget)
+{
+    const char* lexer_input = "10 ; 20 30 ;";
+
+    ParserBuffers* buf = parser_allocate_buffers(256, 256, sizeof(CodegenStruct), sizeof(CodegenUnion));
+
+    GrammarParser p_defaults = p;
+    p_defaults.default_reductions = lalr_default_reductions;
+
+    // Suspend after every step, with and without default reductions
+    const GrammarParser* parsers[] = {&p, &p_defaults};
+    for (uint32_t i = 0; i < NEOAST_ARR_LEN(parsers); i++)
+    {
+        void* lexer_inst = bootstrap_lexer_instance_new(lexer_parent, lexer_input, strlen(lexer_input));
+
+        int slices_n = 1;
+        int32_t res_idx = parser_parse_lr_budget(parsers[i], NULL, lalr_table, buf,
+                                                 lexer_inst, bootstrap_lexer_next, 1);
+        while (res_idx == NEOAST_PARSE_SUSPENDED)
+        {
+            assert_int_not_equal(buf->parsing_stack->pos, 0);
+            res_idx = parser_resume_lr(parsers[i], NULL, lalr_table, buf,
+                                       lexer_inst, bootstrap_lexer_next, 1);
+            slices_n++;
+        }
+
+        bootstrap_lexer_instance_free(lexer_inst);
+
+        // 5 shifts and at least one reduction per token
+        assert_int_equal(res_idx, 0);
+        assert_true(slices_n > 5);
+        assert_int_equal(buf->parsing_stack->pos, 0);
+    }
+
+    // A suspended parse can be dropped
+    void* lexer_inst = bootstrap_lexer_instance_new(lexer_parent, lexer_input, strlen(lexer_input));
+    assert_int_equal(parser_parse_lr_budget(&p, NULL, lalr_table, buf, lexer_inst, bootstrap_lexer_next, 3),
+                     NEOAST_PARSE_SUSPENDED);
+    parser_abort_lr(&p, buf);
+    assert_int_equal(buf->parsing_stack->pos, 0);
+    bootstrap_lexer_instance_free(lexer_inst);
+
+    // No limit runs the whole parse
+    lexer_inst = bootstrap_lexer_instance_new(lexer_parent, lexer_input, strlen(lexer_input));
+    assert_int_equal(parser_parse_lr_budget(&p, NULL, lalr_table, buf, lexer_inst, bootstrap_lexer_next, 0), 0);
+    bootstrap_lexer_instance_free(lexer_inst);
+
+    parser_free_buffers(buf);
+}
+
+CTEST(test_parser_deep)
+{
+    // A -> aA nests once per 'a'
+    const uint32_t depth = 2000;
+    char* lexer_input = malloc(depth * 2 + 3);
+    for (uint32_t i = 0; i < depth; i++)
+    {
+        lexer_input[i * 2] = '1';
+        lexer_input[i * 2 + 1] = ' ';
+    }
+    strcpy(lexer_input + depth * 2, ";;");
+
+    // Buffers start small and grow to fit the input
+    ParserBuffers* buf = parser_allocate_buffers(0, 0, sizeof(CodegenStruct), sizeof(CodegenUnion));
+    assert_true(buf->table_n < depth);
+
+    void* lexer_inst = bootstrap_lexer_instance_new(lexer_parent, lexer_input, strlen(lexer_input));
+    int32_t res_idx = parser_parse_lr(&p, NULL, lalr_table, buf, lexer_inst, bootstrap_lexer_next);
+    bootstrap_lexer_instance_free(lexer_inst);
+
+    assert_int_equal(res_idx, 0);
+    assert_true(buf->table_n > depth);
+    parser_free_buffers(buf);
+
+    // Running past the limit is a parse error
+    buf = parser_allocate_buffers(256, 0, sizeof(CodegenStruct), sizeof(CodegenUnion));
+
+    lexer_inst = bootstrap_lexer_instance_new(lexer_parent, lexer_input, strlen(lexer_input));
+    res_idx = parser_parse_lr(&p, NULL, lalr_table, buf, lexer_inst, bootstrap_lexer_next);
+    bootstrap_lexer_instance_free(lexer_inst);
+
+    assert_int_equal(res_idx, -1);
+    assert_int_equal(buf->table_n, 256);
+    parser_free_buffers(buf);
+    free(lexer_input);
+}
+
+CTEST(test_parser_validate)
+{
+    ParserBuffers* buf = parser_allocate_buffers(0, 0, sizeof(CodegenStruct), sizeof(CodegenUnion));
+    TokenPosition error_position = {0};
+
+    GrammarParser p_defaults = p;
+    p_defaults.default_reductions = lalr_default_reductions;
+    const GrammarParser* parsers[] = {&p, &p_defaults};
+
+    for (int i = 0; i < 2; i++)
+    {
+        void* lexer_inst = bootstrap_lexer_instance_new(lexer_parent, "10 ; 20 30 ;", 12);
+        assert_int_equal(parser_validate_lr(parsers[i], NULL, lalr_table, buf, lexer_inst,
+                                            bootstrap_lexer_next, &error_position), 0);
+        bootstrap_lexer_instance_free(lexer_inst);
+
+        // Second A is never finished, the lexer leaves
+        // the position of the last token at EOF
+        lexer_inst = bootstrap_lexer_instance_new(lexer_parent, "10 ; 20 30", 10);
+        assert_int_equal(parser_validate_lr(parsers[i], NULL, lalr_table, buf, lexer_inst,
+                                            bootstrap_lexer_next, &error_position), -1);
+        bootstrap_lexer_instance_free(lexer_inst);
+        assert_int_equal(error_position.offset, 8);
+        assert_int_equal(error_position.len, 2);
+    }
+
+    parser_free_buffers(buf);
+}
+
+CTEST(test_arena)
+{
+    NeoastArena* arena = neoast_arena_new();
+
+    char* first = neoast_arena_alloc(arena, 3);
+    char* second = neoast_arena_alloc(arena, 8);
+    assert_int_equal(neoast_arena_used(arena), 32);
+    assert_int_equal((uintptr_t) first % 16, 0);
+    assert_int_equal((uintptr_t) second % 16, 0);
+    assert_ptr_equal(second, first + 16);
+
+    // Larger than a block
+    char* large = neoast_arena_alloc(arena, 1024 * 1024);
+    memset(large, 1, 1024 * 1024);
+    char* after_large = neoast_arena_alloc(arena, 8);
+    memset(after_large, 1, 8);
+    assert_int_equal(neoast_arena_used(arena), 32 + 1024 * 1024 + 16);
+
+    // The blocks are handed out again in the same order
+    neoast_arena_reset(arena);
+    assert_int_equal(neoast_arena_used(arena), 0);
+    assert_ptr_equal(neoast_arena_alloc(arena, 3), first);
+    assert_ptr_equal(neoast_arena_alloc(arena, 8), second);
+    assert_ptr_equal(neoast_arena_alloc(arena, 1024 * 1024), large);
+
+    neoast_arena_free(arena);
+}
+
+CTEST(test_lines)
+{
+    // Past the 16 bit columns and lengths positions used to have
+    size_t long_n = 70000;
+    char* text = malloc(long_n + 16);
+    memcpy(text, "a\n\tb\xc3\xa9" "c\n", 8);
+    memset(text + 8, 'x', long_n);
+    memcpy(text + 8 + long_n, "\ny", 3);
+    uint64_t len = 8 + long_n + 2;
+
+    NeoastLines* lines = neoast_lines_new();
+    TokenLocation location;
+    assert_int_equal(neoast_lines_locate(lines, 0, &location), -1);
+    neoast_lines_reset(lines, text, len);
+
+    assert_int_equal(neoast_lines_locate(lines, 1, &location), 0);
+    assert_int_equal(location.line, 1);
+    assert_int_equal(location.col, 1);
+
+    // Tab stops and UTF-8 characters
+    assert_int_equal(neoast_lines_locate(lines, 6, &location), 0);
+    assert_int_equal(location.line, 2);
+    assert_int_equal(location.col, 10);
+
+    assert_int_equal(neoast_lines_locate(lines, 8 + long_n, &location), 0);
+    assert_int_equal(location.line, 3);
+    assert_int_equal(location.col, long_n);
+
+    // Offsets before the furthest one looked up
+    assert_int_equal(neoast_lines_locate(lines, 2, &location), 0);
+    assert_int_equal(location.line, 2);
+    assert_int_equal(location.col, 0);
+
+    assert_int_equal(neoast_lines_locate(lines, len, &location), 0);
+    assert_int_equal(location.line, 4);
+    assert_int_equal(location.col, 1);
+    assert_int_equal(neoast_lines_locate(lines, len + 1, &location), -1);
+
+    neoast_lines_free(lines);
+    free(text);
+}
+
+#ifdef NEOAST_STATS
+CTEST(test_parser_stats)
+{
+    ParserBuffers* buf = parser_allocate_buffers(0, 0, sizeof(CodegenStruct), sizeof(CodegenUnion));
+
+    void* lexer_inst = bootstrap_lexer_instance_new(lexer_parent, "10 ; 20 30 ;", 12);
+    assert_int_equal(parser_parse_lr(&p, NULL, lalr_table, buf, lexer_inst, bootstrap_lexer_next), 0);
+    bootstrap_lexer_instance_free(lexer_inst);
+
+    const ParserStats* stats = parser_get_stats(buf);
+    assert_int_equal(stats->tokens, 6); // a b a a b EOF
+    assert_int_equal(stats->shifts, 5);
+    assert_int_equal(stats->reduces, 6);
+    assert_int_equal(stats->rule_reduces[1], 1); // S -> AA
+    assert_int_equal(stats->rule_reduces[2], 3); // A -> aA
+    assert_int_equal(stats->rule_reduces[3], 2); // A -> b
+    assert_int_equal(stats->max_depth, 4); // A a a b
+    assert_int_equal(stats->max_token_index, 4);
+
+    // Counters add up over parses
+    lexer_inst = bootstrap_lexer_instance_new(lexer_parent, "10 ; 20 30 ;", 12);
+    assert_int_equal(parser_validate_lr(&p, NULL, lalr_table, buf, lexer_inst, bootstrap_lexer_next, NULL), 0);
+    bootstrap_lexer_instance_free(lexer_inst);
+    assert_int_equal(stats->tokens, 12);
+    assert_int_equal(stats->reduces, 12);
+
+    parser_reset_stats(buf);
+    assert_int_equal(stats->tokens, 0);
+    assert_null(stats->rule_reduces);
+    parser_free_buffers(buf);
+}
+#endif
 
 const static struct CMUnitTest left_scan_tests[] = {
+        cmocka_unit_test(test_parser_default_reductions),
+        cmocka_unit_test(test_parser_split),
+        cmocka_unit_test(test_parser_expected),
+        cmocka_unit_test(test_parser_push),
+        cmocka_unit_test(test_parser_budget),
+        cmocka_unit_test(test_parser_deep),
+        cmocka_unit_test(test_parser_validate),
+        cmocka_unit_test(test_arena),
+        cmocka_unit_test(test_lines),
+#ifdef NEOAST_STATS
+        cmocka_unit_test(test_parser_stats),
+#endif
         cmocka_unit_test(test_parser),
 };
 
@@ -0,0 +1,177 @@
+/*
+ * This file is part of the Neoast framework
+ * Copyright (c) 2021 Andrei Tumbar.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Micro-benchmark of the line and column counting behind
+ * matcher_lineno() and matcher_columno(). Every kernel is
+ * compared against the byte at a time loops they replaced.
+ *
+ *   matcher_bench [megabytes]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <lexer/matcher_priv.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_UNIT "bytes/cycle"
+static uint64_t bench_clock(void)
+{
+    return __rdtsc();
+}
+#else
+#define BENCH_UNIT "bytes/ns"
+static uint64_t bench_clock(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+#endif
+
+#define BENCH_RUNS (5)
+
+/// Lines were found one memchr() at a time
+static size_t lines_before(const char* s, const char* e)
+{
+    size_t n = 0;
+    const char* bol;
+    while (s < e && (bol = memchr(s, '\n', e - s)))
+    {
+        ++n;
+        s = bol + 1;
+    }
+    return n;
+}
+
+/// Columns were counted one byte at a time
+static size_t columns_before(const char* s, const char* e)
+{
+    size_t k = 0;
+    for (; s < e; ++s)
+    {
+        if (*s == '\t')
+            k += 1 + (~k & 7);
+        else
+            k += ((*s & 0xC0) != 0x80);
+    }
+    return k;
+}
+
+static size_t lines_after(const char* s, const char* e)
+{
+    return matcher_count_lines(s, e);
+}
+
+static size_t columns_after(const char* s, const char* e)
+{
+    return matcher_count_columns(s, e, 0, 8);
+}
+
+/// Best of a few runs to keep the noise out
+static double bench(size_t (*fn)(const char*, const char*),
+                    const char* text, size_t len, size_t* result)
+{
+    uint64_t best = UINT64_MAX;
+    for (int i = 0; i < BENCH_RUNS; i++)
+    {
+        uint64_t start = bench_clock();
+        *result = fn(text, text + len);
+        uint64_t elapsed = bench_clock() - start;
+        if (elapsed < best)
+            best = elapsed;
+    }
+
+    return (double) len / (double) (best ? best : 1);
+}
+
+static void bench_pair(const char* name,
+                       size_t (*before)(const char*, const char*),
+                       size_t (*after)(const char*, const char*),
+                       const char* text, size_t len)
+{
+    size_t expected, result;
+    double rate_before = bench(before, text, len, &expected);
+    double rate_after = bench(after, text, len, &result);
+
+    printf("%-24s %10.3f %10.3f %8.1fx%s\n", name, rate_before, rate_after,
+           rate_after / rate_before, expected == result ? "" : "  MISMATCH");
+}
+
+/// Fill with source-like text, lines of up to line_max bytes
+static void fill(char* text, size_t len, size_t line_max, int tabs)
+{
+    static const char* words[] = {"neoast", "=", "(", ")", "12", "\xc3\xa9t\xc3\xa9", "\xe2\x82\xac", ";"};
+    size_t line = 0;
+    srand(42);
+    for (size_t i = 0; i < len; i++)
+    {
+        const char* w = words[rand() % 8];
+        size_t n = strlen(w);
+        if (line_max && line + n >= line_max)
+        {
+            text[i] = '\n';
+            line = 0;
+            continue;
+        }
+
+        if (tabs && line == 0)
+        {
+            text[i] = '\t';
+            line++;
+            continue;
+        }
+
+        for (size_t j = 0; j < n && i < len; j++, i++, line++)
+            text[i] = w[j];
+        if (i < len)
+            text[i] = ' ';
+        line++;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    size_t len = (argc > 1 ? strtoul(argv[1], NULL, 10) : 64) << 20;
+    char* text = malloc(len);
+    if (!text)
+    {
+        perror("malloc()");
+        return 1;
+    }
+
+    printf("%zu MB, best of %d runs\n", len >> 20, BENCH_RUNS);
+    printf("%-24s %10s %10s %9s\n", BENCH_UNIT, "before", "after", "speedup");
+
+    fill(text, len, 40, 0);
+    bench_pair("lines, 40 byte lines", lines_before, lines_after, text, len);
+
+    fill(text, len, 200, 0);
+    bench_pair("lines, 200 byte lines", lines_before, lines_after, text, len);
+
+    fill(text, len, 0, 0);
+    bench_pair("columns, no tabs", columns_before, columns_after, text, len);
+
+    fill(text, len, 80, 1);
+    bench_pair("columns, indented", columns_before, columns_after, text, len);
+
+    free(text);
+    return 0;
+}
@@ -18,6 +18,9 @@
 #include <stdio.h>
 #include <cmocka.h>
 #include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 #include <lexer/matcher.h>
 #include <lexer/matcher_fsm.h>
 #include <lexer/input.h>
@@ -128,6 +131,93 @@ void pattern_fsm(NeoastMatcher* m)
 }
 
 
+// pattern_fsm() as generated with %option lexer_backend="table"
+static const
+uint8_t pattern_table_fsm_classes[] = {
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x01, 0x02, 0x01, 0x01, 0x01, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x03, 0x03, 0x03, 0x04, 0x00, 0x04, 0x05, 0x03,
+        0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06,
+        0x06, 0x06, 0x00, 0x00, 0x00, 0x03, 0x00, 0x00,
+        0x00, 0x07, 0x07, 0x07, 0x07, 0x08, 0x07, 0x07,
+        0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07,
+        0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07,
+        0x07, 0x07, 0x07, 0x00, 0x00, 0x00, 0x00, 0x07,
+        0x00, 0x07, 0x07, 0x07, 0x07, 0x08, 0x07, 0x07,
+        0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07,
+        0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07,
+        0x07, 0x07, 0x07, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+};
+
+static const
+uint32_t pattern_table_fsm_accept[] = {
+        0x00000000, 0x00000001, 0x00000002, 0x00000006, 0x00000003, 0x00000004, 0x00000006, 0x00000005,
+        0x00000002, 0x00000000, 0x00000002, 0x00000000, 0x00000002,
+};
+
+static const
+uint32_t pattern_table_fsm_base[] = {
+        0x00000000, 0x00000003, 0x00000007, 0x00000008, 0xFFFFFFFF, 0x00000002, 0xFFFFFFFF, 0x0000000F,
+        0x0000000C, 0x0000000F, 0x00000010, 0x00000011, 0x00000013,
+};
+
+static const
+uint16_t pattern_table_fsm_defaults[] = {
+        0x0005, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+        0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+};
+
+static const
+uint16_t pattern_table_fsm_next[] = {
+        0x0007, 0x0008, 0x0006, 0x0008, 0x0008, 0x0004, 0x0003, 0x0002,
+        0x0002, 0x0002, 0x0002, 0x0002, 0x0009, 0x0003, 0x000B, 0x000A,
+        0x0008, 0x0008, 0x000B, 0x000C, 0x000A, 0x000D, 0x000B, 0x000D,
+        0x000A, 0x000D, 0x0000, 0x0000,
+};
+
+static const
+uint16_t pattern_table_fsm_check[] = {
+        0x0000, 0x0000, 0x0000, 0x0005, 0x0005, 0x0000, 0x0000, 0x0000,
+        0x0000, 0x0001, 0x0001, 0x0001, 0x0002, 0x0002, 0x0003, 0x0002,
+        0x0007, 0x0007, 0x0008, 0x0009, 0x0008, 0x0009, 0x000A, 0x000B,
+        0x000A, 0x000C, 0xFFFF, 0xFFFF,
+};
+
+static const
+NeoastPatternTable pattern_table_fsm_table = {
+        .classes = pattern_table_fsm_classes,
+        .accept = pattern_table_fsm_accept,
+        .base = pattern_table_fsm_base,
+        .defaults = pattern_table_fsm_defaults,
+        .next = pattern_table_fsm_next,
+        .check = pattern_table_fsm_check,
+};
+
+static void pattern_table_fsm(NeoastMatcher* m)
+{
+  FSM_TABLE(m, &pattern_table_fsm_table);
+}
+
+
 CTEST(test_lexer)
 {
     static const char test_string[] = "123     + variable\n";
@@ -181,8 +271,241 @@ CTEST(test_lexer)
     matcher_free(mat);
 }
 
+CTEST(test_lexer_partial)
+{
+    NeoastInput* input = input_new_from_buffer(NULL, 0);
+    NeoastMatcher* mat = matcher_new(input);
+    matcher_set_partial(mat, TRUE);
+
+    // Number is cut off by the end of the chunk
+    input_set_buffer(input, "12", 2);
+    matcher_scan(mat, pattern_fsm);
+    assert_true(matcher_need_more(mat));
+
+    // The next chunk ends the number
+    input_set_buffer(input, "3.5 ", 4);
+    matcher_set_partial(mat, TRUE);
+    assert_int_equal(matcher_scan(mat, pattern_fsm), 2);
+    assert_false(matcher_need_more(mat));
+    assert_string_equal(matcher_text(mat), "123.5");
+
+    // Whitespace might still continue
+    matcher_scan(mat, pattern_fsm);
+    assert_true(matcher_need_more(mat));
+
+    // Last chunk
+    input_set_buffer(input, " abc", 4);
+    matcher_set_partial(mat, FALSE);
+    assert_int_equal(matcher_scan(mat, pattern_fsm), 5);
+    assert_false(matcher_need_more(mat));
+    assert_string_equal(matcher_text(mat), "  ");
+
+    assert_int_equal(matcher_scan(mat, pattern_fsm), 1);
+    assert_false(matcher_need_more(mat));
+    assert_string_equal(matcher_text(mat), "abc");
+    assert_int_equal(matcher_columno(mat), 7);
+
+    assert_int_equal(matcher_scan(mat, pattern_fsm), 0);
+
+    input_free(input);
+    matcher_free(mat);
+}
+
+CTEST(test_lexer_set_input)
+{
+    NeoastInput* input = input_new_from_buffer("abc\n12", 6);
+    NeoastMatcher* mat = matcher_new(input);
+
+    assert_int_equal(matcher_scan(mat, pattern_fsm), 1);
+    assert_int_equal(matcher_scan(mat, pattern_fsm), 4);
+    assert_int_equal(matcher_scan(mat, pattern_fsm), 2);
+    assert_int_equal(matcher_lineno(mat), 2);
+
+    // Restarting forgets everything about the last input
+    input_set_buffer(input, "variable 3", 10);
+    matcher_set_input(mat, input);
+
+    assert_int_equal(matcher_scan(mat, pattern_fsm), 1);
+    assert_string_equal(matcher_text(mat), "variable");
+    assert_int_equal(matcher_lineno(mat), 1);
+    assert_int_equal(matcher_columno(mat), 0);
+    assert_int_equal(matcher_scan(mat, pattern_fsm), 5);
+    assert_int_equal(matcher_scan(mat, pattern_fsm), 2);
+    assert_string_equal(matcher_text(mat), "3");
+    assert_int_equal(matcher_scan(mat, pattern_fsm), 0);
+
+    input_free(input);
+    matcher_free(mat);
+}
+
+CTEST(test_lexer_in_place)
+{
+    // No terminator after the input, it is never written to
+    char* text = malloc(6);
+    memcpy(text, "ab 12x", 6);
+
+    NeoastInput* input = input_new_from_buffer(text, 6);
+    NeoastMatcher* mat = matcher_new(input);
+
+    assert_int_equal(matcher_scan(mat, pattern_fsm), 1);
+    assert_ptr_equal(mat->txt_, text);
+    assert_null(mat->own_);
+    assert_string_equal(matcher_text(mat), "ab");
+    assert_int_equal(matcher_scan(mat, pattern_fsm), 5);
+    assert_int_equal(matcher_scan(mat, pattern_fsm), 2);
+    assert_string_equal(matcher_text(mat), "12");
+    assert_int_equal(matcher_offset(mat), 5);
+    assert_int_equal(matcher_scan(mat, pattern_fsm), 1);
+    assert_string_equal(matcher_text(mat), "x");
+    assert_int_equal(matcher_scan(mat, pattern_fsm), 0);
+    assert_null(mat->own_);
+
+    // Partial inputs are still copied
+    input_set_buffer(input, "12", 2);
+    matcher_set_input(mat, input);
+    matcher_set_partial(mat, TRUE);
+    matcher_scan(mat, pattern_fsm);
+    assert_true(matcher_need_more(mat));
+    assert_non_null(mat->own_);
+
+    input_free(input);
+    matcher_free(mat);
+    free(text);
+}
+
+CTEST(test_lexer_mmap)
+{
+    char path[] = "/tmp/neoast_lexer_XXXXXX";
+    int fd = mkstemp(path);
+    assert_true(fd >= 0);
+    assert_int_equal(write(fd, "\xef\xbb\xbf" "abc 12", 9), 9);
+    close(fd);
+
+    // Regular files are scanned straight from the mapping, the BOM is skipped
+    NeoastInput* input = input_new_from_path_mmap(path);
+    assert_non_null(input);
+    assert_int_equal(input->type, NEOAST_INPUT_BUFFER);
+
+    NeoastMatcher* mat = matcher_new(input);
+    assert_int_equal(matcher_scan(mat, pattern_fsm), 1);
+    assert_string_equal(matcher_text(mat), "abc");
+    assert_int_equal(matcher_scan(mat, pattern_fsm), 5);
+    assert_int_equal(matcher_scan(mat, pattern_fsm), 2);
+    assert_string_equal(matcher_text(mat), "12");
+    assert_int_equal(matcher_scan(mat, pattern_fsm), 0);
+    assert_null(mat->own_);
+    matcher_free(mat);
+    input_free(input);
+    unlink(path);
+
+    // Devices can't be mapped and are streamed
+    input = input_new_from_path_mmap("/dev/null");
+    assert_non_null(input);
+    assert_int_equal(input->type, NEOAST_INPUT_FILE);
+    mat = matcher_new(input);
+    assert_int_equal(matcher_scan(mat, pattern_fsm), 0);
+    matcher_free(mat);
+    input_free(input);
+
+    assert_null(input_new_from_path_mmap("/nonexistent/neoast"));
+}
+
+CTEST(test_lexer_count)
+{
+    // Newlines, tabs, ASCII and multi-byte UTF-8 characters
+    static const char alphabet[] = "\n\tab \xc3\xa9\xe2\x82\xac\xf0\x9f\x98\x80";
+    char text[1024];
+    srand(1);
+    for (size_t i = 0; i < sizeof(text); i++)
+    {
+        text[i] = alphabet[rand() % (sizeof(alphabet) - 1)];
+    }
+
+    // Every alignment and length around the vector widths
+    for (size_t start = 0; start < 70; start++)
+    {
+        for (size_t len = 0; start + len <= sizeof(text); len += 1 + len / 4)
+        {
+            const char* s = text + start;
+            const char* e = s + len;
+
+            size_t lines = 0, chars = 0, col = 3;
+            for (const char* c = s; c < e; c++)
+            {
+                lines += *c == '\n';
+                chars += (*c & 0xC0) != 0x80;
+                if (*c == '\t')
+                    col += 8 - col % 8;
+                else
+                    col += (*c & 0xC0) != 0x80;
+            }
+
+            assert_int_equal(matcher_count_lines(s, e), lines);
+            assert_int_equal(matcher_count_chars(s, e), chars);
+            assert_int_equal(matcher_count_columns(s, e, 3, 8), col);
+        }
+    }
+}
+
+CTEST(test_lexer_table)
+{
+    static const char alphabet[] = "aZ_09.eE+-=( \t\n\r#\x80";
+    char text[512];
+
+    srand(24);
+    for (int iter = 0; iter < 64; iter++)
+    {
+        size_t n = rand() % sizeof(text);
+        for (size_t i = 0; i < n; i++)
+            text[i] = alphabet[rand() % (sizeof(alphabet) - 1)];
+
+        NeoastInput* input_goto = input_new_from_buffer(text, n);
+        NeoastInput* input_table = input_new_from_buffer(text, n);
+        NeoastMatcher* mat_goto = matcher_new(input_goto);
+        NeoastMatcher* mat_table = matcher_new(input_table);
+
+        // Both matchers split the text into the same tokens
+        size_t tok;
+        do
+        {
+            tok = matcher_scan(mat_goto, pattern_fsm);
+            assert_int_equal(matcher_scan(mat_table, pattern_table_fsm), tok);
+            assert_int_equal(matcher_offset(mat_table), matcher_offset(mat_goto));
+            assert_int_equal(matcher_size(mat_table), matcher_size(mat_goto));
+        } while (tok);
+
+        matcher_free(mat_goto);
+        matcher_free(mat_table);
+        input_free(input_goto);
+        input_free(input_table);
+    }
+
+    // Lookahead past a partial chunk is tracked the same way
+    NeoastInput* input = input_new_from_buffer("12", 2);
+    NeoastMatcher* mat = matcher_new(input);
+    matcher_set_partial(mat, TRUE);
+    matcher_scan(mat, pattern_table_fsm);
+    assert_true(matcher_need_more(mat));
+
+    input_set_buffer(input, "3e+5+", 5);
+    matcher_set_partial(mat, FALSE);
+    assert_int_equal(matcher_scan(mat, pattern_table_fsm), 2);
+    assert_string_equal(matcher_text(mat), "123e+5");
+    assert_int_equal(matcher_scan(mat, pattern_table_fsm), 3);
+    assert_int_equal(matcher_scan(mat, pattern_table_fsm), 0);
+
+    input_free(input);
+    matcher_free(mat);
+}
+
 const static struct CMUnitTest neoast_lexer_tests[] = {
         cmocka_unit_test(test_lexer),
+        cmocka_unit_test(test_lexer_partial),
+        cmocka_unit_test(test_lexer_set_input),
+        cmocka_unit_test(test_lexer_in_place),
+        cmocka_unit_test(test_lexer_mmap),
+        cmocka_unit_test(test_lexer_count),
+        cmocka_unit_test(test_lexer_table),
 };
 
 int main()
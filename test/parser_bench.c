@@ -0,0 +1,235 @@
+/*
+ * This file is part of the Neoast framework
+ * Copyright (c) 2021 Andrei Tumbar.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Throughput of the calculator grammar built with different
+ * options, and of its copy with ASCII tokens, which the lexer
+ * maps to parser ids at runtime. Every parser reads the same
+ * long expression, the first one listed is the baseline of the
+ * speedup column.
+ *
+ * The first parser is then run on 1, 2, 4... threads at once,
+ * each parsing the whole input with its own buffers. Threads
+ * default to one per online CPU.
+ *
+ *   parser_bench [kilobytes] [threads]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#define BENCH_RUNS (10)
+
+#define FUNC(name, suffix) name ## _ ## suffix
+
+#define DEFINE_HEADER(name) \
+uint32_t FUNC(name, init)(); \
+void* FUNC(name, allocate_buffers)(); \
+void FUNC(name, free_buffers)(void* self); \
+void FUNC(name, free)(); \
+double FUNC(name, parse)(void* ctx, void* buffers, const char* input);
+
+#define BENCH_PARSER(name, description) \
+{description, FUNC(name, init), FUNC(name, allocate_buffers), \
+ FUNC(name, free_buffers), FUNC(name, free), FUNC(name, parse)}
+
+// Pretend headers
+DEFINE_HEADER(calc)
+DEFINE_HEADER(calc_direct)
+DEFINE_HEADER(calc_ascii)
+
+typedef struct
+{
+    const char* name;
+    uint32_t (*init)();
+    void* (*allocate_buffers)();
+    void (*free_buffers)(void* self);
+    void (*free)();
+    double (*parse)(void* ctx, void* buffers, const char* input);
+} BenchParser;
+
+static const BenchParser parsers[] = {
+        BENCH_PARSER(calc, "table"),
+        BENCH_PARSER(calc_direct, "backend=direct"),
+        BENCH_PARSER(calc_ascii, "ASCII tokens"),
+};
+
+static uint64_t bench_clock(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/// Best of a few runs to keep the noise out
+static double bench(const BenchParser* parser, const char* input, uint32_t token_n, double* result)
+{
+    parser->init();
+    void* buffers = parser->allocate_buffers();
+
+    uint64_t best = UINT64_MAX;
+    for (int i = 0; i < BENCH_RUNS; i++)
+    {
+        uint64_t start = bench_clock();
+        *result = parser->parse(NULL, buffers, input);
+        uint64_t elapsed = bench_clock() - start;
+        if (elapsed < best)
+            best = elapsed;
+    }
+
+    parser->free_buffers(buffers);
+    parser->free();
+    return (double) token_n * 1e3 / (double) (best ? best : 1);
+}
+
+typedef struct
+{
+    const BenchParser* parser;
+    const char* input;
+    void* buffers;
+    double result;
+    pthread_t thread;
+} BenchThread;
+
+static void* bench_thread(void* thread_)
+{
+    BenchThread* thread = thread_;
+    thread->result = thread->parser->parse(NULL, thread->buffers, thread->input);
+    return NULL;
+}
+
+/// Tokens parsed by all threads together, best of a few runs
+static double bench_threads(const BenchParser* parser, const char* input, uint32_t token_n,
+                            uint32_t thread_n, double expected, int* mismatch)
+{
+    BenchThread* threads = calloc(thread_n, sizeof(BenchThread));
+    parser->init();
+    for (uint32_t i = 0; i < thread_n; i++)
+    {
+        threads[i].parser = parser;
+        threads[i].input = input;
+        threads[i].buffers = parser->allocate_buffers();
+    }
+
+    uint64_t best = UINT64_MAX;
+    for (int run = 0; run < BENCH_RUNS; run++)
+    {
+        uint64_t start = bench_clock();
+        for (uint32_t i = 0; i < thread_n; i++)
+        {
+            if (pthread_create(&threads[i].thread, NULL, bench_thread, &threads[i]) != 0)
+            {
+                perror("pthread_create()");
+                exit(1);
+            }
+        }
+
+        for (uint32_t i = 0; i < thread_n; i++)
+        {
+            pthread_join(threads[i].thread, NULL);
+        }
+
+        uint64_t elapsed = bench_clock() - start;
+        if (elapsed < best)
+            best = elapsed;
+    }
+
+    *mismatch = 0;
+    for (uint32_t i = 0; i < thread_n; i++)
+    {
+        if (threads[i].result != expected)
+            *mismatch = 1;
+        parser->free_buffers(threads[i].buffers);
+    }
+
+    parser->free();
+    free(threads);
+    return (double) token_n * thread_n * 1e3 / (double) (best ? best : 1);
+}
+
+int main(int argc, char** argv)
+{
+    size_t len = (argc > 1 ? strtoul(argv[1], NULL, 10) : 4096) << 10;
+    long thread_n = argc > 2 ? strtol(argv[2], NULL, 10) : sysconf(_SC_NPROCESSORS_ONLN);
+    if (thread_n < 1)
+        thread_n = 1;
+
+    char* input = malloc(len + 16);
+    if (!input)
+    {
+        perror("malloc()");
+        return 1;
+    }
+
+    // Short numbers and operators, the parser does most of the work
+    uint32_t token_n = 1;
+    size_t n = 0;
+    srand(42);
+    while (n < len)
+    {
+        n += sprintf(input + n, "(%d * 2) + ", rand() % 10);
+        token_n += 6;
+    }
+    sprintf(input + n, "1");
+
+    printf("%zu KB, %u tokens, best of %d runs\n", len >> 10, token_n, BENCH_RUNS);
+    printf("%-24s %12s %9s\n", "", "Mtokens/s", "speedup");
+
+    double base = 0;
+    double expected = 0;
+    for (size_t i = 0; i < sizeof(parsers) / sizeof(parsers[0]); i++)
+    {
+        double result;
+        double rate = bench(&parsers[i], input, token_n, &result);
+        if (i == 0)
+        {
+            base = rate;
+            expected = result;
+        }
+
+        printf("%-24s %12.2f %8.2fx%s\n", parsers[i].name, rate, rate / base,
+               result == expected ? "" : "  MISMATCH");
+    }
+
+    // Threads share the parser, with linear scaling the
+    // throughput grows with the number of threads
+    printf("\n%-24s %12s %9s\n", "threads", "Mtokens/s", "scaling");
+    double single = 0;
+    for (long t = 1;; t *= 2)
+    {
+        if (t > thread_n)
+            t = thread_n;
+
+        int mismatch;
+        double rate = bench_threads(&parsers[0], input, token_n, (uint32_t) t, expected, &mismatch);
+        if (t == 1)
+            single = rate;
+
+        printf("%-24ld %12.2f %8.2fx%s\n", t, rate, rate / single,
+               mismatch ? "  MISMATCH" : "");
+        if (t == thread_n)
+            break;
+    }
+
+    free(input);
+    return 0;
+}